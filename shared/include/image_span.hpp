@@ -2,9 +2,13 @@
 
 #include "utility.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <execution>
 #include <optional>
+#include <span>
+#include <thread>
+#include <vector>
 
 #include <glm/glm.hpp>
 
@@ -29,6 +33,16 @@ public:
    auto exchange(const index_type index, const value_type new_value) noexcept
       -> value_type;
 
+   //! Convert a whole row of the image to float4. `texels` must be at least
+   //! as wide as the image.
+   void load_row(const index_type::value_type row,
+                 const std::span<value_type> texels) const noexcept;
+
+   //! Convert a whole row of float4 texels to the image's format. `texels`
+   //! must be at least as wide as the image.
+   void store_row(const index_type::value_type row,
+                  const std::span<const value_type> texels) noexcept;
+
    auto subspan(const index_type offset, const index_type length) const noexcept
       -> Image_span;
 
@@ -47,8 +61,16 @@ private:
    using Store_value = void(const glm::vec4 value, const glm::ivec2 index,
                             const std::size_t row_pitch, std::byte* const data) noexcept;
 
+   using Load_row = void(Load_value& load_value, const std::byte* const row,
+                         const std::span<glm::vec4> texels) noexcept;
+   using Store_row = void(Store_value& store_value,
+                          const std::span<const glm::vec4> texels,
+                          std::byte* const row) noexcept;
+
    Load_value& _load_func;
    Store_value& _store_func;
+   Load_row& _load_row_func;
+   Store_row& _store_row_func;
 
    const DXGI_FORMAT _format;
 };
@@ -89,4 +111,88 @@ inline void for_each(Policy&& policy, const Image_span& span, Func func) noexcep
    }
 }
 
+namespace detail {
+
+// Splits `rows` rows into one chunk per thread and calls `func` with the y
+// coordinate of each row and a scratch row `width` texels wide. The scratch row
+// is thread-local and reused across calls, its contents on entry are unspecified.
+template<typename Policy, typename Func>
+inline void for_each_row_scratch(Policy&& policy, const int rows, const int width,
+                                 Func func) noexcept
+{
+   const auto threads =
+      static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+   const auto work_size = (rows + threads - 1) / threads;
+
+   std::for_each_n(std::forward<Policy>(policy), Index_iterator{}, threads,
+                   [&func, rows, width, work_size](const auto item) {
+                      const auto begin = static_cast<int>(item) * work_size;
+                      const auto end = std::min(begin + work_size, rows);
+
+                      if (begin >= end) return;
+
+                      thread_local std::vector<glm::vec4> texels;
+
+                      texels.resize(width);
+
+                      for (auto y = begin; y < end; ++y) {
+                         func(y, std::span<glm::vec4>{texels}.first(width));
+                      }
+                   });
+}
+
+}
+
+// Helper function for processing an Image_span a row at a time across multiple threads.
+// Each row is converted to float4 with Image_span::load_row, passed to `func` along with
+// its y coordinate and then written back with Image_span::store_row.
+template<typename Policy, typename Func>
+inline void for_each_row(Policy&& policy, Image_span& span, Func func) noexcept
+{
+   detail::for_each_row_scratch(std::forward<Policy>(policy), span.size().y,
+                                span.size().x,
+                                [&](const int y, std::span<glm::vec4> texels) {
+                                   span.load_row(y, texels);
+
+                                   func(y, texels);
+
+                                   span.store_row(y, texels);
+                                });
+}
+
+// Helper function for transforming one Image_span into another of the same size a
+// row at a time across multiple threads. Rows are loaded from `src`, passed to `func`
+// and stored to `dest`.
+template<typename Policy, typename Func>
+inline void for_each_row(Policy&& policy, const Image_span& src, Image_span& dest,
+                         Func func) noexcept
+{
+   Expects(src.size() == dest.size());
+
+   detail::for_each_row_scratch(std::forward<Policy>(policy), src.size().y,
+                                src.size().x,
+                                [&](const int y, std::span<glm::vec4> texels) {
+                                   src.load_row(y, texels);
+
+                                   func(y, texels);
+
+                                   dest.store_row(y, texels);
+                                });
+}
+
+// Helper function for filling an Image_span a row at a time across multiple threads.
+// The existing contents of `dest` are not loaded, `func` must write every texel of
+// the row it is passed before it is stored with Image_span::store_row.
+template<typename Policy, typename Func>
+inline void fill_each_row(Policy&& policy, Image_span& dest, Func func) noexcept
+{
+   detail::for_each_row_scratch(std::forward<Policy>(policy), dest.size().y,
+                                dest.size().x,
+                                [&](const int y, std::span<glm::vec4> texels) {
+                                   func(y, texels);
+
+                                   dest.store_row(y, texels);
+                                });
+}
+
 }
@@ -5,33 +5,44 @@
 #include <memory>
 #include <span>
 
-namespace sp::win32 {
+namespace sp {
 
-class Memeory_mapped_file {
+//! \brief A view of a whole file mapped into memory. Backed by file mappings
+//! on Windows and mmap everywhere else.
+class Memory_mapped_file {
 public:
    enum class Mode { read, read_write };
 
-   Memeory_mapped_file() = default;
+   //! \brief How the mapping is expected to be read. Passed on to the OS as a
+   //! hint for it's read ahead, has no other effect.
+   enum class Access_hint { normal, sequential, random };
 
-   Memeory_mapped_file(const std::filesystem::path& path, const Mode mode = Mode::read);
+   Memory_mapped_file() = default;
 
-   Memeory_mapped_file(const Memeory_mapped_file&) = delete;
-   Memeory_mapped_file& operator=(const Memeory_mapped_file&) = delete;
+   Memory_mapped_file(const std::filesystem::path& path, const Mode mode = Mode::read,
+                      const Access_hint access_hint = Access_hint::normal);
 
-   Memeory_mapped_file(Memeory_mapped_file&&) = default;
-   Memeory_mapped_file& operator=(Memeory_mapped_file&&) = default;
+   Memory_mapped_file(const Memory_mapped_file&) = delete;
+   Memory_mapped_file& operator=(const Memory_mapped_file&) = delete;
 
-   ~Memeory_mapped_file() = default;
+   Memory_mapped_file(Memory_mapped_file&&) = default;
+   Memory_mapped_file& operator=(Memory_mapped_file&&) = default;
+
+   ~Memory_mapped_file() = default;
 
    auto bytes() noexcept -> std::span<std::byte>;
 
    auto bytes() const noexcept -> std::span<const std::byte>;
 
 private:
-   static void unmap(std::byte* mapping) noexcept;
+   struct Unmapper {
+      std::size_t size;
+
+      void operator()(std::byte* mapping) const noexcept;
+   };
 
-   std::unique_ptr<std::byte, decltype(&unmap)> _view{nullptr, &unmap};
-   std::uint32_t _size = 0;
+   std::unique_ptr<std::byte, Unmapper> _view{nullptr, Unmapper{0}};
+   std::size_t _size = 0;
 };
 
 }
@@ -8,6 +8,7 @@
 #include <functional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -43,6 +44,31 @@ struct Texture_data {
    std::span<const std::byte> data;
 };
 
+//! A parsed patch texture. The name and subresource data reference the bytes
+//! the texture was parsed from. Subresources are ordered by array item and then
+//! by mip level.
+struct Patch_texture {
+   std::string_view name;
+   Texture_info info;
+   std::vector<Texture_data> subresources;
+};
+
+//! Parse a patch texture's header and locate it's subresources. Does not touch
+//! D3D, throws on malformed input.
+auto parse_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader) -> Patch_texture;
+
+//! Whether the `skip_mips` most detailed mip levels can be left out of a
+//! texture. For block compressed formats the new top mip must still be a whole
+//! number of blocks.
+bool can_skip_mips(const Texture_info& info, const std::uint32_t skip_mips) noexcept;
+
+//! Create a SRV for a parsed patch texture, leaving out the `skip_mips` most
+//! detailed mip levels. At least one mip level is always kept and fewer are
+//! left out if can_skip_mips says they can't be.
+auto create_patch_texture(ID3D11Device1& device, const Patch_texture& texture,
+                          const std::uint32_t skip_mips = 0)
+   -> Com_ptr<ID3D11ShaderResourceView>;
+
 auto load_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& device)
    -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>;
 
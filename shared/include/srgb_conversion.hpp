@@ -1,9 +1,14 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <cmath>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
+#include <emmintrin.h>
+
 namespace sp {
 
 template<typename Float>
@@ -46,4 +51,163 @@ inline auto compress_srgb(const glm::vec4 color) -> glm::vec4
            compress_srgb(color.b), color.a};
 }
 
+// Fast variants of the above. 8-bit decoding goes through a table of every
+// possible value and is exact. Float encoding linearly interpolates a table
+// indexed by the exponent and top mantissa bits of the input, keeping the
+// error against compress_srgb under 5e-5 for inputs in [0, 1] (about 1/80th of
+// an 8-bit step). Inputs above 1, infinities and NaNs fall back to
+// compress_srgb.
+
+namespace detail {
+
+inline const auto srgb_unorm8_decode_table = [] {
+   std::array<float, 256> table;
+
+   for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = decompress_srgb(static_cast<float>(i) / 255.0f);
+   }
+
+   return table;
+}();
+
+// Values below 2^-9 are always in the linear part of the curve, so the table
+// only needs to cover the exponents [-9, 0).
+constexpr int srgb_encode_min_exponent = -9;
+constexpr int srgb_encode_mantissa_bits = 5;
+constexpr int srgb_encode_buckets_per_exponent = 1 << srgb_encode_mantissa_bits;
+constexpr int srgb_encode_bucket_shift = 23 - srgb_encode_mantissa_bits;
+constexpr std::uint32_t srgb_encode_min_bits =
+   static_cast<std::uint32_t>(127 + srgb_encode_min_exponent) << 23;
+constexpr std::size_t srgb_encode_table_size =
+   -srgb_encode_min_exponent * srgb_encode_buckets_per_exponent;
+
+struct Srgb_encode_bucket {
+   float base;
+   float slope;
+};
+
+inline const auto srgb_encode_table = [] {
+   std::array<Srgb_encode_bucket, srgb_encode_table_size> table;
+
+   for (std::size_t i = 0; i < table.size(); ++i) {
+      const auto begin = std::bit_cast<float>(
+         srgb_encode_min_bits +
+         (static_cast<std::uint32_t>(i) << srgb_encode_bucket_shift));
+      const auto end = std::bit_cast<float>(
+         srgb_encode_min_bits +
+         (static_cast<std::uint32_t>(i + 1) << srgb_encode_bucket_shift));
+
+      const auto curve = [](const double v) {
+         return v < 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+      };
+
+      table[i] = {static_cast<float>(curve(begin)),
+                  static_cast<float>(curve(end) - curve(begin))};
+   }
+
+   return table;
+}();
+
+inline auto srgb_encode_bucket_fraction(const std::uint32_t bits) noexcept -> float
+{
+   constexpr std::uint32_t fraction_mask = (1u << srgb_encode_bucket_shift) - 1u;
+
+   return static_cast<float>(bits & fraction_mask) *
+          (1.0f / static_cast<float>(1u << srgb_encode_bucket_shift));
+}
+
+}
+
+inline auto decompress_srgb_unorm8(const std::uint8_t v) noexcept -> float
+{
+   return detail::srgb_unorm8_decode_table[v];
+}
+
+inline auto compress_srgb_fast(const float v) noexcept -> float
+{
+   if (v < 0.0031308f) return v * 12.92f;
+   if (!(v < 1.0f)) return compress_srgb(v); // Also catches NaN.
+
+   const auto bits = std::bit_cast<std::uint32_t>(v);
+   const auto& bucket =
+      detail::srgb_encode_table[(bits - detail::srgb_encode_min_bits) >>
+                                detail::srgb_encode_bucket_shift];
+
+   return bucket.base + bucket.slope * detail::srgb_encode_bucket_fraction(bits);
+}
+
+inline auto compress_srgb_fast(const glm::vec3 color) noexcept -> glm::vec3
+{
+   return {compress_srgb_fast(color.r), compress_srgb_fast(color.g),
+           compress_srgb_fast(color.b)};
+}
+
+inline auto compress_srgb_fast(const glm::vec4 color) noexcept -> glm::vec4
+{
+   return {compress_srgb_fast(color.r), compress_srgb_fast(color.g),
+           compress_srgb_fast(color.b), color.a};
+}
+
+//! Encode four values at once. SSE2 has no gather so the table lookups are
+//! scalar, the range selection and interpolation are done four wide.
+inline auto compress_srgb_fast(const __m128 v) noexcept -> __m128
+{
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 clamped =
+      _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(std::bit_cast<float>(
+                                  detail::srgb_encode_min_bits))),
+                 _mm_set1_ps(std::bit_cast<float>(0x3f7fffffu)));
+   const __m128i bits = _mm_castps_si128(clamped);
+   const __m128i indices =
+      _mm_srli_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(static_cast<int>(
+                                            detail::srgb_encode_min_bits))),
+                     detail::srgb_encode_bucket_shift);
+
+   alignas(16) std::array<std::uint32_t, 4> index_values;
+
+   _mm_store_si128(reinterpret_cast<__m128i*>(index_values.data()), indices);
+
+   const auto& bucket_0 = detail::srgb_encode_table[index_values[0]];
+   const auto& bucket_1 = detail::srgb_encode_table[index_values[1]];
+   const auto& bucket_2 = detail::srgb_encode_table[index_values[2]];
+   const auto& bucket_3 = detail::srgb_encode_table[index_values[3]];
+
+   const __m128 base =
+      _mm_setr_ps(bucket_0.base, bucket_1.base, bucket_2.base, bucket_3.base);
+   const __m128 slope =
+      _mm_setr_ps(bucket_0.slope, bucket_1.slope, bucket_2.slope, bucket_3.slope);
+
+   const __m128i fraction_bits = _mm_and_si128(
+      bits, _mm_set1_epi32((1 << detail::srgb_encode_bucket_shift) - 1));
+   const __m128 fraction =
+      _mm_mul_ps(_mm_cvtepi32_ps(fraction_bits),
+                 _mm_set1_ps(1.0f / static_cast<float>(
+                                       1u << detail::srgb_encode_bucket_shift)));
+
+   const __m128 curve = _mm_add_ps(base, _mm_mul_ps(slope, fraction));
+   const __m128 linear = _mm_mul_ps(v, _mm_set1_ps(12.92f));
+
+   const __m128 is_linear = _mm_cmplt_ps(v, _mm_set1_ps(0.0031308f));
+   __m128 result =
+      _mm_or_ps(_mm_and_ps(is_linear, linear), _mm_andnot_ps(is_linear, curve));
+
+   // Anything at or above 1 (or NaN) takes the slow path, which is rare for
+   // colours.
+   if (const int above_one = _mm_movemask_ps(_mm_cmpnlt_ps(v, one)); above_one) {
+      alignas(16) std::array<float, 4> values;
+      alignas(16) std::array<float, 4> results;
+
+      _mm_store_ps(values.data(), v);
+      _mm_store_ps(results.data(), result);
+
+      for (int i = 0; i < 4; ++i) {
+         if (above_one & (1 << i)) results[i] = compress_srgb(values[i]);
+      }
+
+      result = _mm_load_ps(results.data());
+   }
+
+   return result;
+}
+
 }
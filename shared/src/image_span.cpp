@@ -4,9 +4,15 @@
 #include "image_span.hpp"
 #include "srgb_conversion.hpp"
 
+#include <array>
+#include <cstring>
+
 #include <glm/gtc/packing.hpp>
 #include <gsl/gsl>
 
+#include <immintrin.h>
+#include <intrin.h>
+
 namespace sp {
 
 namespace {
@@ -377,7 +383,10 @@ auto load_r8g8b8a8_unorm_srgb(const glm::ivec2 index, const std::size_t row_pitc
 
    std::memcpy(&value, texel_address(index, row_pitch, texel_size, data), texel_size);
 
-   return decompress_srgb(glm::unpackUnorm4x8(value));
+   return {decompress_srgb_unorm8(value & 0xffu),
+           decompress_srgb_unorm8((value >> 8u) & 0xffu),
+           decompress_srgb_unorm8((value >> 16u) & 0xffu),
+           static_cast<float>(value >> 24u) * (1.0f / 255.0f)};
 }
 
 void store_r8g8b8a8_unorm_srgb(const glm::vec4 value, const glm::ivec2 index,
@@ -385,7 +394,7 @@ void store_r8g8b8a8_unorm_srgb(const glm::vec4 value, const glm::ivec2 index,
 {
    constexpr auto texel_size = sizeof(glm::uint32);
 
-   const auto packed = glm::packUnorm4x8(compress_srgb(value));
+   const auto packed = glm::packUnorm4x8(compress_srgb_fast(value));
 
    std::memcpy(texel_address(index, row_pitch, texel_size, data), &packed, texel_size);
 }
@@ -844,6 +853,296 @@ auto get_bytes_per_pixel(const DXGI_FORMAT format) noexcept -> std::size_t
       std::terminate();
    }
 }
+
+// Row conversion. Formats without a dedicated kernel fall back to calling the
+// per-texel function for each texel in the row.
+
+using Load_value = auto(const glm::ivec2 index, const std::size_t row_pitch,
+                        const std::byte* const data) noexcept -> glm::vec4;
+using Store_value = void(const glm::vec4 value, const glm::ivec2 index,
+                         const std::size_t row_pitch, std::byte* const data) noexcept;
+using Load_row = void(Load_value& load_value, const std::byte* const row,
+                      const std::span<glm::vec4> texels) noexcept;
+using Store_row = void(Store_value& store_value,
+                       const std::span<const glm::vec4> texels,
+                       std::byte* const row) noexcept;
+
+auto cpu_supports_f16c() noexcept -> bool
+{
+   static const bool supported = [] {
+      std::array<int, 4> info{};
+
+      __cpuid(info.data(), 1);
+
+      return (info[2] & (1 << 29)) != 0;
+   }();
+
+   return supported;
+}
+
+void load_row_generic(Load_value& load_value, const std::byte* const row,
+                      const std::span<glm::vec4> texels) noexcept
+{
+   for (std::size_t x = 0; x < texels.size(); ++x) {
+      texels[x] = load_value({static_cast<int>(x), 0}, 0, row);
+   }
+}
+
+void store_row_generic(Store_value& store_value, const std::span<const glm::vec4> texels,
+                       std::byte* const row) noexcept
+{
+   for (std::size_t x = 0; x < texels.size(); ++x) {
+      store_value(texels[x], {static_cast<int>(x), 0}, 0, row);
+   }
+}
+
+void load_row_r32g32b32a32_float(Load_value&, const std::byte* const row,
+                                 const std::span<glm::vec4> texels) noexcept
+{
+   std::memcpy(texels.data(), row, texels.size_bytes());
+}
+
+void store_row_r32g32b32a32_float(Store_value&,
+                                  const std::span<const glm::vec4> texels,
+                                  std::byte* const row) noexcept
+{
+   std::memcpy(row, texels.data(), texels.size_bytes());
+}
+
+void load_row_r16g16b16a16_float(Load_value& load_value,
+                                 const std::byte* const row,
+                                 const std::span<glm::vec4> texels) noexcept
+{
+   if (!cpu_supports_f16c()) return load_row_generic(load_value, row, texels);
+
+   for (std::size_t x = 0; x < texels.size(); ++x) {
+      const __m128i half = _mm_loadl_epi64(
+         reinterpret_cast<const __m128i*>(row + x * sizeof(glm::uint64)));
+
+      _mm_storeu_ps(&texels[x].x, _mm_cvtph_ps(half));
+   }
+}
+
+void store_row_r16g16b16a16_float(Store_value& store_value,
+                                  const std::span<const glm::vec4> texels,
+                                  std::byte* const row) noexcept
+{
+   if (!cpu_supports_f16c()) return store_row_generic(store_value, texels, row);
+
+   for (std::size_t x = 0; x < texels.size(); ++x) {
+      const __m128i half =
+         _mm_cvtps_ph(_mm_loadu_ps(&texels[x].x), _MM_FROUND_TO_NEAREST_INT);
+
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(row + x * sizeof(glm::uint64)), half);
+   }
+}
+
+// The 8-bit UNORM kernels match glm::unpackUnorm4x8 and glm::packUnorm4x8 exactly,
+// including packUnorm4x8 rounding halfway values away from zero.
+
+constexpr float unorm8_to_float = 0.0039215686274509803921568627451f;
+
+enum class Unorm8_layout { rgba, bgra, bgrx };
+
+template<Unorm8_layout layout>
+inline auto unorm8_swizzle_load(const __m128 value) noexcept -> __m128
+{
+   if constexpr (layout == Unorm8_layout::rgba) {
+      return value;
+   }
+   else if constexpr (layout == Unorm8_layout::bgra) {
+      return _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 1, 2));
+   }
+   else {
+      const __m128 bgr1 = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 1, 2));
+
+      return _mm_or_ps(_mm_and_ps(bgr1, _mm_castsi128_ps(
+                                           _mm_setr_epi32(-1, -1, -1, 0))),
+                       _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+   }
+}
+
+template<Unorm8_layout layout>
+inline auto unorm8_swizzle_store(const __m128 value) noexcept -> __m128
+{
+   if constexpr (layout == Unorm8_layout::rgba) {
+      return value;
+   }
+   else if constexpr (layout == Unorm8_layout::bgra) {
+      return _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 1, 2));
+   }
+   else {
+      return unorm8_swizzle_load<Unorm8_layout::bgrx>(value);
+   }
+}
+
+inline auto unorm8_to_float4(const __m128i texel) noexcept -> __m128
+{
+   return _mm_mul_ps(_mm_cvtepi32_ps(texel), _mm_set1_ps(unorm8_to_float));
+}
+
+inline auto float4_to_unorm8(const __m128 value) noexcept -> __m128i
+{
+   const __m128 clamped =
+      _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   const __m128 scaled = _mm_mul_ps(clamped, _mm_set1_ps(255.0f));
+   const __m128i truncated = _mm_cvttps_epi32(scaled);
+   const __m128 fraction = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+   const __m128i round_up =
+      _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f)));
+
+   return _mm_sub_epi32(truncated, round_up);
+}
+
+template<Unorm8_layout layout>
+void load_row_unorm8(Load_value&, const std::byte* const row,
+                     const std::span<glm::vec4> texels) noexcept
+{
+   const __m128i zero = _mm_setzero_si128();
+
+   std::size_t x = 0;
+
+   for (; (x + 4) <= texels.size(); x += 4) {
+      const __m128i packed =
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * sizeof(glm::uint32)));
+      const __m128i low = _mm_unpacklo_epi8(packed, zero);
+      const __m128i high = _mm_unpackhi_epi8(packed, zero);
+
+      _mm_storeu_ps(&texels[x + 0].x, unorm8_swizzle_load<layout>(unorm8_to_float4(
+                                         _mm_unpacklo_epi16(low, zero))));
+      _mm_storeu_ps(&texels[x + 1].x, unorm8_swizzle_load<layout>(unorm8_to_float4(
+                                         _mm_unpackhi_epi16(low, zero))));
+      _mm_storeu_ps(&texels[x + 2].x, unorm8_swizzle_load<layout>(unorm8_to_float4(
+                                         _mm_unpacklo_epi16(high, zero))));
+      _mm_storeu_ps(&texels[x + 3].x, unorm8_swizzle_load<layout>(unorm8_to_float4(
+                                         _mm_unpackhi_epi16(high, zero))));
+   }
+
+   for (; x < texels.size(); ++x) {
+      glm::uint32 value;
+
+      std::memcpy(&value, row + x * sizeof(glm::uint32), sizeof(glm::uint32));
+
+      const __m128i texel = _mm_unpacklo_epi16(
+         _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(value)), zero), zero);
+
+      _mm_storeu_ps(&texels[x].x, unorm8_swizzle_load<layout>(unorm8_to_float4(texel)));
+   }
+}
+
+template<Unorm8_layout layout, bool srgb = false>
+void store_row_unorm8(Store_value&, const std::span<const glm::vec4> texels,
+                      std::byte* const row) noexcept
+{
+   const auto texel_at = [&](const std::size_t x) noexcept {
+      __m128 value = _mm_loadu_ps(&texels[x].x);
+
+      if constexpr (srgb) {
+         const __m128 rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+         value = _mm_or_ps(_mm_and_ps(rgb_mask, compress_srgb_fast(value)),
+                           _mm_andnot_ps(rgb_mask, value));
+      }
+
+      return float4_to_unorm8(unorm8_swizzle_store<layout>(value));
+   };
+
+   std::size_t x = 0;
+
+   for (; (x + 4) <= texels.size(); x += 4) {
+      const __m128i low = _mm_packs_epi32(texel_at(x + 0), texel_at(x + 1));
+      const __m128i high = _mm_packs_epi32(texel_at(x + 2), texel_at(x + 3));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * sizeof(glm::uint32)),
+                       _mm_packus_epi16(low, high));
+   }
+
+   for (; x < texels.size(); ++x) {
+      const __m128i word = _mm_packs_epi32(texel_at(x), _mm_setzero_si128());
+      const auto value =
+         static_cast<glm::uint32>(_mm_cvtsi128_si32(_mm_packus_epi16(word, word)));
+
+      std::memcpy(row + x * sizeof(glm::uint32), &value, sizeof(glm::uint32));
+   }
+}
+
+// sRGB rows are decoded through the 8-bit decode table and encoded four
+// channels at a time with compress_srgb_fast before being packed.
+
+template<Unorm8_layout layout>
+void load_row_unorm8_srgb(Load_value& load_value, const std::byte* const row,
+                          const std::span<glm::vec4> texels) noexcept
+{
+   load_row_unorm8<layout>(load_value, row, texels);
+
+   constexpr std::size_t r_offset = layout == Unorm8_layout::rgba ? 0 : 2;
+   constexpr std::size_t b_offset = layout == Unorm8_layout::rgba ? 2 : 0;
+
+   for (std::size_t x = 0; x < texels.size(); ++x) {
+      const auto* const texel_bytes =
+         reinterpret_cast<const std::uint8_t*>(row + x * sizeof(glm::uint32));
+
+      texels[x].r = decompress_srgb_unorm8(texel_bytes[r_offset]);
+      texels[x].g = decompress_srgb_unorm8(texel_bytes[1]);
+      texels[x].b = decompress_srgb_unorm8(texel_bytes[b_offset]);
+   }
+}
+
+template<Unorm8_layout layout>
+void store_row_unorm8_srgb(Store_value& store_value,
+                           const std::span<const glm::vec4> texels,
+                           std::byte* const row) noexcept
+{
+   store_row_unorm8<layout, true>(store_value, texels, row);
+}
+
+auto get_load_row_function(const DXGI_FORMAT format) noexcept -> Load_row*
+{
+   switch (format) {
+   case DXGI_FORMAT_R32G32B32A32_FLOAT:
+      return &load_row_r32g32b32a32_float;
+   case DXGI_FORMAT_R16G16B16A16_FLOAT:
+      return &load_row_r16g16b16a16_float;
+   case DXGI_FORMAT_R8G8B8A8_UNORM:
+      return &load_row_unorm8<Unorm8_layout::rgba>;
+   case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+      return &load_row_unorm8_srgb<Unorm8_layout::rgba>;
+   case DXGI_FORMAT_B8G8R8A8_UNORM:
+      return &load_row_unorm8<Unorm8_layout::bgra>;
+   case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+      return &load_row_unorm8_srgb<Unorm8_layout::bgra>;
+   case DXGI_FORMAT_B8G8R8X8_UNORM:
+      return &load_row_unorm8<Unorm8_layout::bgrx>;
+   case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+      return &load_row_unorm8_srgb<Unorm8_layout::bgrx>;
+   default:
+      return &load_row_generic;
+   }
+}
+
+auto get_store_row_function(const DXGI_FORMAT format) noexcept -> Store_row*
+{
+   switch (format) {
+   case DXGI_FORMAT_R32G32B32A32_FLOAT:
+      return &store_row_r32g32b32a32_float;
+   case DXGI_FORMAT_R16G16B16A16_FLOAT:
+      return &store_row_r16g16b16a16_float;
+   case DXGI_FORMAT_R8G8B8A8_UNORM:
+      return &store_row_unorm8<Unorm8_layout::rgba>;
+   case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+      return &store_row_unorm8_srgb<Unorm8_layout::rgba>;
+   case DXGI_FORMAT_B8G8R8A8_UNORM:
+      return &store_row_unorm8<Unorm8_layout::bgra>;
+   case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+      return &store_row_unorm8_srgb<Unorm8_layout::bgra>;
+   case DXGI_FORMAT_B8G8R8X8_UNORM:
+      return &store_row_unorm8<Unorm8_layout::bgrx>;
+   case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+      return &store_row_unorm8_srgb<Unorm8_layout::bgrx>;
+   default:
+      return &store_row_generic;
+   }
+}
 }
 
 Image_span::Image_span(const glm::ivec2 size, const std::size_t row_pitch,
@@ -853,6 +1152,8 @@ Image_span::Image_span(const glm::ivec2 size, const std::size_t row_pitch,
      _data{data},
      _load_func{*get_load_function(format)},
      _store_func{*get_store_function(format)},
+     _load_row_func{*get_load_row_function(format)},
+     _store_row_func{*get_store_row_function(format)},
      _format{format}
 {
 }
@@ -891,6 +1192,28 @@ auto Image_span::exchange(const index_type index, const value_type new_value) no
    return old_value;
 }
 
+void Image_span::load_row(const index_type::value_type row,
+                          const std::span<value_type> texels) const noexcept
+{
+   Expects(texels.size() >= static_cast<std::size_t>(size().x));
+
+   const auto clamped_row = glm::clamp(row, 0, _bounds.y);
+
+   _load_row_func(_load_func, _data + (_row_pitch * clamped_row),
+                  texels.first(static_cast<std::size_t>(size().x)));
+}
+
+void Image_span::store_row(const index_type::value_type row,
+                           const std::span<const value_type> texels) noexcept
+{
+   Expects(texels.size() >= static_cast<std::size_t>(size().x));
+
+   const auto clamped_row = glm::clamp(row, 0, _bounds.y);
+
+   _store_row_func(_store_func, texels.first(static_cast<std::size_t>(size().x)),
+                   _data + (_row_pitch * clamped_row));
+}
+
 auto Image_span::subspan(const index_type offset, const index_type length) const
    noexcept -> Image_span
 {
@@ -1,18 +1,27 @@
 
 #include "memory_mapped_file.hpp"
-#include "smart_win32_handle.hpp"
 
 #include <cstddef>
 #include <filesystem>
+#include <limits>
 #include <memory>
-#include <tuple>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include "smart_win32_handle.hpp"
 
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-namespace sp::win32 {
+namespace sp {
 
-Memeory_mapped_file::Memeory_mapped_file(const std::filesystem::path& path,
-                                         const Mode mode)
+namespace {
+
+auto checked_file_size(const std::filesystem::path& path) -> std::size_t
 {
    if (!std::filesystem::exists(path) || std::filesystem::is_directory(path)) {
       throw std::runtime_error{"File does not exist."};
@@ -20,26 +29,79 @@ Memeory_mapped_file::Memeory_mapped_file(const std::filesystem::path& path,
 
    const auto file_size = std::filesystem::file_size(path);
 
-   if (file_size > std::numeric_limits<std::uint32_t>::max()) {
+   if (file_size > std::numeric_limits<std::size_t>::max()) {
       throw std::runtime_error{"File too large."};
    }
 
-   _size = static_cast<std::uint32_t>(file_size);
+   return static_cast<std::size_t>(file_size);
+}
+
+#ifndef _WIN32
+
+class Unique_fd {
+public:
+   explicit Unique_fd(const int fd) noexcept : _fd{fd} {}
+
+   ~Unique_fd()
+   {
+      if (_fd != -1) close(_fd);
+   }
+
+   Unique_fd(const Unique_fd&) = delete;
+   Unique_fd& operator=(const Unique_fd&) = delete;
+
+   Unique_fd(Unique_fd&&) = delete;
+   Unique_fd& operator=(Unique_fd&&) = delete;
+
+   auto get() const noexcept -> int
+   {
+      return _fd;
+   }
+
+private:
+   int _fd = -1;
+};
+
+#endif
+
+}
+
+#ifdef _WIN32
+
+Memory_mapped_file::Memory_mapped_file(const std::filesystem::path& path,
+                                       const Mode mode, const Access_hint access_hint)
+{
+   _size = checked_file_size(path);
 
    const auto desired_access =
       mode == Mode::read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
 
-   const auto file = Unique_handle{
-      CreateFileW(path.wstring().c_str(), desired_access, FILE_SHARE_READ,
-                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+   const auto flags = [&]() -> DWORD {
+      switch (access_hint) {
+      case Access_hint::sequential:
+         return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+      case Access_hint::random:
+         return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS;
+      default:
+         return FILE_ATTRIBUTE_NORMAL;
+      }
+   }();
+
+   const auto file =
+      win32::Unique_handle{CreateFileW(path.wstring().c_str(), desired_access,
+                                       FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                       flags, nullptr)};
 
    if (file.get() == INVALID_HANDLE_VALUE) {
       throw std::invalid_argument{"Unable to open file."};
    }
 
+   // Empty files can not be mapped, leave them as an empty view.
+   if (_size == 0) return;
+
    const auto page_access = mode == Mode::read ? PAGE_READONLY : PAGE_READWRITE;
 
-   const auto file_mapping = Unique_handle{
+   const auto file_mapping = win32::Unique_handle{
       CreateFileMappingW(file.get(), nullptr, page_access, 0, 0, nullptr)};
 
    if (file_mapping == nullptr) {
@@ -51,26 +113,72 @@ Memeory_mapped_file::Memeory_mapped_file(const std::filesystem::path& path,
 
    _view = {static_cast<std::byte*>(
                MapViewOfFile(file_mapping.get(), file_map_desired_access, 0, 0, 0)),
-            &unmap};
+            Unmapper{_size}};
 
    if (_view == nullptr) {
       throw std::runtime_error{"Unable to create view of file mapping."};
    }
 }
 
-auto Memeory_mapped_file::bytes() noexcept -> std::span<std::byte>
+void Memory_mapped_file::Unmapper::operator()(std::byte* mapping) const noexcept
 {
-   return std::span{_view.get(), _size};
+   if (mapping) UnmapViewOfFile(mapping);
 }
 
-auto Memeory_mapped_file::bytes() const noexcept -> std::span<const std::byte>
+#else
+
+Memory_mapped_file::Memory_mapped_file(const std::filesystem::path& path,
+                                       const Mode mode, const Access_hint access_hint)
+{
+   _size = checked_file_size(path);
+
+   // The mapping keeps it's own reference to the file.
+   const Unique_fd file{open(path.c_str(), mode == Mode::read ? O_RDONLY : O_RDWR)};
+
+   if (file.get() == -1) {
+      throw std::invalid_argument{"Unable to open file."};
+   }
+
+   // Empty files can not be mapped, leave them as an empty view.
+   if (_size == 0) return;
+
+   const int protection = mode == Mode::read ? PROT_READ : PROT_READ | PROT_WRITE;
+
+   void* const mapping = mmap(nullptr, _size, protection, MAP_SHARED, file.get(), 0);
+
+   if (mapping == MAP_FAILED) {
+      throw std::runtime_error{"Unable to create view of file mapping."};
+   }
+
+   _view = {static_cast<std::byte*>(mapping), Unmapper{_size}};
+
+   switch (access_hint) {
+   case Access_hint::sequential:
+      madvise(mapping, _size, MADV_SEQUENTIAL);
+      break;
+   case Access_hint::random:
+      madvise(mapping, _size, MADV_RANDOM);
+      break;
+   default:
+      break;
+   }
+}
+
+void Memory_mapped_file::Unmapper::operator()(std::byte* mapping) const noexcept
+{
+   if (mapping) munmap(mapping, size);
+}
+
+#endif
+
+auto Memory_mapped_file::bytes() noexcept -> std::span<std::byte>
 {
    return std::span{_view.get(), _size};
 }
 
-void Memeory_mapped_file::unmap(std::byte* mapping) noexcept
+auto Memory_mapped_file::bytes() const noexcept -> std::span<const std::byte>
 {
-   if (mapping) UnmapViewOfFile(mapping);
+   return std::span{_view.get(), _size};
 }
 
 }
@@ -36,23 +36,20 @@ enum class Texture_version : std::uint32_t { v_1, current = v_1 };
 
 namespace {
 inline namespace v_1 {
-auto load_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& device)
-   -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>;
-
-void load_patch_texture_impl(
-   ucfb::Reader_strict<"sptx"_mn> reader,
-   std::function<void(const Texture_info info)> info_callback,
-   std::function<void(const std::uint32_t item, const std::uint32_t mip, const Texture_data data)> data_callback);
+auto parse_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader) -> Patch_texture;
 }
 
+auto create_patch_texture_srv(ID3D11Device1& device, const Patch_texture& texture,
+                              const std::uint32_t skip_mips)
+   -> Com_ptr<ID3D11ShaderResourceView>;
+
 void write_sptx(ucfb::File_writer& writer, const std::string_view name,
                 const Texture_info& texture_info,
                 const std::vector<Texture_data>& texture_data);
 
 }
 
-auto load_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& device)
-   -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>
+auto parse_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader) -> Patch_texture
 {
    const auto version =
       reader.read_child_strict<"VER_"_mn>().read<Texture_version>();
@@ -61,28 +58,55 @@ auto load_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& de
 
    switch (version) {
    case Texture_version::current:
-      return load_patch_texture_impl(reader, device);
+      return parse_patch_texture_impl(reader);
    default:
       throw std::runtime_error{"texture has unknown version"};
    }
 }
 
+bool can_skip_mips(const Texture_info& info, const std::uint32_t skip_mips) noexcept
+{
+   if (skip_mips >= info.mip_count) return false;
+   if (!DirectX::IsCompressed(info.format)) return true;
+
+   return (std::max(info.width >> skip_mips, 1u) % 4) == 0 &&
+          (std::max(info.height >> skip_mips, 1u) % 4) == 0;
+}
+
+auto create_patch_texture(ID3D11Device1& device, const Patch_texture& texture,
+                          const std::uint32_t skip_mips) -> Com_ptr<ID3D11ShaderResourceView>
+{
+   auto usable_skip_mips = std::min(skip_mips, texture.info.mip_count - 1);
+
+   while (usable_skip_mips > 0 && !can_skip_mips(texture.info, usable_skip_mips)) {
+      usable_skip_mips -= 1;
+   }
+
+   return create_patch_texture_srv(device, texture, usable_skip_mips);
+}
+
+auto load_patch_texture(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& device)
+   -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>
+{
+   const auto texture = parse_patch_texture(reader);
+
+   return {create_patch_texture_srv(device, texture, 0), std::string{texture.name}};
+}
+
 void load_patch_texture(
    ucfb::Reader_strict<"sptx"_mn> reader,
    std::function<void(const Texture_info info)> info_callback,
    std::function<void(const std::uint32_t item, const std::uint32_t mip, const Texture_data data)> data_callback)
 {
-   const auto version =
-      reader.read_child_strict<"VER_"_mn>().read<Texture_version>();
+   const auto texture = parse_patch_texture(reader);
 
-   reader.reset_head();
+   info_callback(texture.info);
 
-   switch (version) {
-   case Texture_version::current:
-      return load_patch_texture_impl(reader, std::move(info_callback),
-                                     std::move(data_callback));
-   default:
-      throw std::runtime_error{"texture has unknown version"};
+   for (std::uint32_t item = 0; item < texture.info.array_size; ++item) {
+      for (std::uint32_t mip = 0; mip < texture.info.mip_count; ++mip) {
+         data_callback(item, mip,
+                       texture.subresources[item * texture.info.mip_count + mip]);
+      }
    }
 }
 
@@ -273,8 +297,7 @@ auto create_texturecube(ID3D11Device1& device, const Texture_info& info,
    return create_srv(device, *texture, name);
 }
 
-auto load_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device1& device)
-   -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>
+auto parse_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader) -> Patch_texture
 {
    using namespace std::literals;
 
@@ -283,18 +306,23 @@ auto load_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device
 
    Ensures(version == Texture_version::v_1);
 
-   const auto name = reader.read_child_strict<"NAME"_mn>().read_string();
+   Patch_texture texture;
 
-   const auto info = reader.read_child_strict<"INFO"_mn>().read<Texture_info>();
+   texture.name = reader.read_child_strict<"NAME"_mn>().read_string();
+   texture.info = reader.read_child_strict<"INFO"_mn>().read<Texture_info>();
 
-   const auto sub_res_count = info.array_size * info.mip_count;
+   if (texture.info.mip_count == 0 || texture.info.array_size == 0) {
+      throw compose_exception<std::runtime_error>("texture "sv, std::quoted(texture.name),
+                                                  " has no subresources."sv);
+   }
 
-   std::vector<D3D11_SUBRESOURCE_DATA> init_data;
-   init_data.reserve(sub_res_count);
+   const auto sub_res_count = texture.info.array_size * texture.info.mip_count;
+
+   texture.subresources.reserve(sub_res_count);
 
    auto data = reader.read_child_strict<"DATA"_mn>();
 
-   for (auto i = 0; i < sub_res_count; ++i) {
+   for (auto i = 0u; i < sub_res_count; ++i) {
       auto sub = data.read_child_strict<"SUB_"_mn>();
 
       const auto [pitch, slice_pitch, sub_data_size, data_offset] =
@@ -304,70 +332,53 @@ auto load_patch_texture_impl(ucfb::Reader_strict<"sptx"_mn> reader, ID3D11Device
 
       const auto sub_data = sub.read_array_unaligned<std::byte>(sub_data_size);
 
-      D3D11_SUBRESOURCE_DATA subres_data{};
-
-      init_data.push_back({sub_data.data(), pitch, slice_pitch});
+      texture.subresources.push_back({pitch, slice_pitch, sub_data});
    }
 
-   Com_ptr<ID3D11ShaderResourceView> srv;
+   return texture;
+}
 
-   switch (info.type) {
-   case Texture_type::texture1d:
-   case Texture_type::texture1darray:
-      return {create_texture1d(device, info, init_data, name), std::string{name}};
-   case Texture_type::texture2d:
-   case Texture_type::texture2darray:
-      return {create_texture2d(device, info, init_data, name), std::string{name}};
-   case Texture_type::texture3d:
-      return {create_texture3d(device, info, init_data, name), std::string{name}};
-   case Texture_type::texturecube:
-   case Texture_type::texturecubearray:
-      return {create_texturecube(device, info, init_data, name), std::string{name}};
-   default:
-      std::terminate();
-   }
 }
 
-void load_patch_texture_impl(
-   ucfb::Reader_strict<"sptx"_mn> reader,
-   std::function<void(const Texture_info info)> info_callback,
-   std::function<void(const std::uint32_t item, const std::uint32_t mip, const Texture_data data)> data_callback)
+auto create_patch_texture_srv(ID3D11Device1& device, const Patch_texture& texture,
+                              const std::uint32_t skip_mips)
+   -> Com_ptr<ID3D11ShaderResourceView>
 {
-   using namespace std::literals;
-
-   const auto version =
-      reader.read_child_strict<"VER_"_mn>().read<Texture_version>();
-
-   Ensures(version == Texture_version::v_1);
-
-   const auto name = reader.read_child_strict<"NAME"_mn>().read_string();
+   Expects(skip_mips < texture.info.mip_count);
 
-   const auto info = reader.read_child_strict<"INFO"_mn>().read<Texture_info>();
+   Texture_info info = texture.info;
 
-   info_callback(info);
-
-   const auto sub_res_count = info.array_size * info.mip_count;
+   info.width = std::max(info.width >> skip_mips, 1u);
+   info.height = std::max(info.height >> skip_mips, 1u);
+   info.depth = std::max(info.depth >> skip_mips, 1u);
+   info.mip_count -= skip_mips;
 
    std::vector<D3D11_SUBRESOURCE_DATA> init_data;
-   init_data.reserve(sub_res_count);
-
-   auto data = reader.read_child_strict<"DATA"_mn>();
-
-   for (auto item = 0; item < info.array_size; ++item) {
-      for (auto mip = 0; mip < info.mip_count; ++mip) {
-         auto sub = data.read_child_strict<"SUB_"_mn>();
-
-         const auto [pitch, slice_pitch, sub_data_size, data_offset] =
-            sub.read_multi<UINT, UINT, std::uint32_t, std::uint32_t>();
+   init_data.reserve(info.array_size * info.mip_count);
 
-         sub.consume_unaligned(data_offset);
+   for (auto item = 0u; item < info.array_size; ++item) {
+      for (auto mip = skip_mips; mip < texture.info.mip_count; ++mip) {
+         const auto& sub = texture.subresources[item * texture.info.mip_count + mip];
 
-         const auto sub_data = sub.read_array_unaligned<std::byte>(sub_data_size);
-
-         data_callback(item, mip, {pitch, slice_pitch, sub_data});
+         init_data.push_back({sub.data.data(), sub.pitch, sub.slice_pitch});
       }
    }
-}
+
+   switch (info.type) {
+   case Texture_type::texture1d:
+   case Texture_type::texture1darray:
+      return create_texture1d(device, info, init_data, texture.name);
+   case Texture_type::texture2d:
+   case Texture_type::texture2darray:
+      return create_texture2d(device, info, init_data, texture.name);
+   case Texture_type::texture3d:
+      return create_texture3d(device, info, init_data, texture.name);
+   case Texture_type::texturecube:
+   case Texture_type::texturecubearray:
+      return create_texturecube(device, info, init_data, texture.name);
+   default:
+      std::terminate();
+   }
 }
 
 void write_sptx(ucfb::File_writer& writer, const std::string_view name,
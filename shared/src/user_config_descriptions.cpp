@@ -219,6 +219,18 @@ R"(Like Enable User Effects Config except SP will automatically check for a conf
 R"(Force using Direct3D 11 on 12 instead of the any native Direct3D 11 driver. This can workaround bugs in the D3D11 driver. It is likely that turning this on will cost some performance however. CMAA2 is also broken while using this (unsure why, there are no debug layer errors from D3D11 or D3D12 about it).)"sv
 },
 
+{
+"Stream Textures"sv,      
+R"(Load Shader Patch textures in the background instead of while the game waits on them. Low resolution versions of textures are shown until the full resolution ones have loaded, which can noticeably cut load times for maps and mods with many high resolution textures.)"sv
+},
+
+{
+"Screenshot Format"sv,      
+R"(File format to save screenshots in. Can be "PNG" or "QOI".
+
+"QOI" screenshots are saved many times faster than "PNG" ones but are larger and fewer programs can open them. Both are lossless. Screenshots are saved in the background either way.)"sv
+},
+
 {
 "Effects"sv,      
 R"(Settings for the Effects system, which allows modders to apply various effects to their mods at their discretion and configuration. Below are options provided to tweak the performance of this system for low-end/older GPUs.)"sv
@@ -309,6 +321,15 @@ Even if this flag is true the debug layer will only be enabled if a debugger is
 R"(Limit Shader Patch to using a DXGI 1.2 factory to work around a crash in the Visual Studio Graphics Debugger. This also bypasses all GPU selection logic.)"sv
 },
 
+{
+"Log Flush Policy"sv,      
+R"(Controls how often Shader Patch writes its log out to disk. Messages are always written from a background thread.
+
+Every Message - Flush each time the background writer picks up new messages. Messages logged just before a crash may still be lost.
+Errors - Flush straight away for warnings and errors and otherwise once a second.
+Periodic - Flush once a second.)"sv
+},
+
 {
 "Shader Cache Path"sv,      
 R"(Path for shader cache file.)"sv
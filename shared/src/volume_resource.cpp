@@ -138,7 +138,8 @@ auto load_volume_resource(const std::filesystem::path& path)
    -> std::pair<Volume_resource_header, std::vector<std::byte>>
 {
    const auto file_mapping =
-      win32::Memeory_mapped_file{path, win32::Memeory_mapped_file::Mode::read};
+      Memory_mapped_file{path, Memory_mapped_file::Mode::read,
+                         Memory_mapped_file::Access_hint::sequential};
 
    ucfb::Reader reader{file_mapping.bytes()};
 
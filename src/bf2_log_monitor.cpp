@@ -1,11 +1,16 @@
 
 #include "bf2_log_monitor.hpp"
-#include "file_helpers.hpp"
-#include "string_utilities.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <string_view>
+#include <utility>
+
+#include <gsl/gsl>
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_stdlib.h"
@@ -18,39 +23,104 @@ namespace sp {
 
 const auto log_name = L"BFront2.log";
 
+// Entries that are tested against the filter in a single frame. Keeps the
+// frame a new filter is entered on from stalling on large logs.
+constexpr std::size_t filter_entries_per_frame = 8192;
+
+// A range of text in the log, stored as offsets because the log's contents are
+// reallocated as they grow.
+struct BF2_log_text {
+   std::uint32_t offset = 0;
+   std::uint32_t length = 0;
+};
+
 struct BF2_log_entry {
-   std::string_view severity;
-   std::string_view file;
-   std::string_view message;
+   BF2_log_text severity;
+   BF2_log_text file;
+   BF2_log_text message;
+};
+
+enum class BF2_log_row_style : std::uint8_t { severity, file, message };
+
+// A single line of the displayed log.
+struct BF2_log_row {
+   BF2_log_text text;
+   BF2_log_row_style style = BF2_log_row_style::message;
 };
 
 namespace {
 
-auto parse_log_file(const std::string_view log_file) noexcept
-   -> std::vector<BF2_log_entry>
+auto get_text(const std::string_view log, const BF2_log_text text) noexcept
+   -> std::string_view
 {
-   std::vector<BF2_log_entry> results;
-   results.reserve(2048);
+   return log.substr(text.offset, text.length);
+}
 
-   for (auto line_rest = split_string_on(log_file, "\r\n"sv); !line_rest[1].empty();
-        line_rest = split_string_on(line_rest[1], "\r\n"sv)) {
-      if (line_rest[0].starts_with("Message Severity"sv)) {
-         const auto [file, message_rest] = split_string_on(line_rest[1], "\r\n"sv);
-         const auto [message, remainder] = split_string_on(message_rest, "\r\n"sv);
+// Parses the entries at the start of `text`, which starts `base_offset` bytes
+// into the log. Entries are only parsed once all their lines are complete, the
+// number of bytes parsed is returned and anything after that should be parsed
+// again once more of the log has been read.
+auto parse_log_text(const std::string_view text, const std::size_t base_offset,
+                    std::vector<BF2_log_entry>& entries) noexcept -> std::size_t
+{
+   std::size_t parsed = 0;
 
-         line_rest[1] = remainder;
+   const auto next_line = [&](std::size_t& position) -> std::optional<BF2_log_text> {
+      const auto line_end = text.find("\r\n"sv, position);
 
-         results.push_back({.severity = line_rest[0], .file = file, .message = message});
-      }
-      else if (line_rest[0].empty()) {
-         results.push_back({.message = "\n"sv});
+      if (line_end == text.npos) return std::nullopt;
+
+      const BF2_log_text line{
+         .offset = static_cast<std::uint32_t>(base_offset + position),
+         .length = static_cast<std::uint32_t>(line_end - position)};
+
+      position = line_end + 2;
+
+      return line;
+   };
+
+   while (true) {
+      std::size_t position = parsed;
+
+      const auto line = next_line(position);
+
+      if (!line) break;
+
+      const auto line_text = text.substr(line->offset - base_offset, line->length);
+
+      if (line_text.starts_with("Message Severity"sv)) {
+         const auto file = next_line(position);
+         const auto message = file ? next_line(position) : std::nullopt;
+
+         if (!message) break;
+
+         entries.push_back({.severity = *line, .file = *file, .message = *message});
       }
       else {
-         results.push_back({.message = line_rest[0]});
+         entries.push_back({.message = *line});
       }
+
+      parsed = position;
    }
 
-   return results;
+   return parsed;
+}
+
+void append_rows(const BF2_log_entry& entry, std::vector<BF2_log_row>& rows) noexcept
+{
+   if (entry.severity.length != 0) {
+      rows.push_back({.text = entry.severity, .style = BF2_log_row_style::severity});
+   }
+
+   if (entry.file.length != 0) {
+      rows.push_back({.text = entry.file, .style = BF2_log_row_style::file});
+   }
+
+   // Blank lines in the log are kept as empty rows.
+   if (entry.message.length != 0 ||
+       (entry.severity.length == 0 && entry.file.length == 0)) {
+      rows.push_back({.text = entry.message, .style = BF2_log_row_style::message});
+   }
 }
 
 auto get_severity_color(const std::string_view severity) -> ImVec4
@@ -65,11 +135,16 @@ auto get_severity_color(const std::string_view severity) -> ImVec4
    return {1.0f, 1.0f, 1.0f, 1.0f};
 }
 
-bool test_filter(const BF2_log_entry& entry, const std::regex& filter) noexcept
+bool test_filter(const BF2_log_entry& entry, const std::string_view log,
+                 const std::regex& filter) noexcept
 {
-   return std::regex_search(entry.severity.cbegin(), entry.severity.cend(), filter) ||
-          std::regex_search(entry.file.cbegin(), entry.file.cend(), filter) ||
-          std::regex_search(entry.message.cbegin(), entry.message.cend(), filter);
+   const auto search = [&](const BF2_log_text text) {
+      const auto string = get_text(log, text);
+
+      return std::regex_search(string.cbegin(), string.cend(), filter);
+   };
+
+   return search(entry.severity) || search(entry.file) || search(entry.message);
 }
 
 }
@@ -102,6 +177,9 @@ void BF2_log_monitor::show_imgui(const bool input_enabled) noexcept
 
    if (input_enabled) {
       if (ImGui::InputText("Regex Filter", &_regex_str)) {
+         _filtered_rows.clear();
+         _filtered_entry_count = 0;
+
          if (!_regex_str.empty()) {
             try {
                _regex = std::regex{_regex_str, std::regex::icase};
@@ -125,25 +203,39 @@ void BF2_log_monitor::show_imgui(const bool input_enabled) noexcept
       ImGui::Checkbox("Pin", &_overlay);
    }
 
-   ImGui::BeginChild("Entries");
+   update_filter();
 
-   for (const auto& entry : _log_entries) {
-      if (_regex && !test_filter(entry, *_regex)) continue;
+   if (_regex && _filtered_entry_count < _log_entries.size()) {
+      ImGui::Text("Filtering... %.0f%%", _filtered_entry_count * 100.0 /
+                                            _log_entries.size());
+   }
 
-      if (!entry.severity.empty()) {
-         ImGui::PushStyleColor(ImGuiCol_Text, get_severity_color(entry.severity));
-         ImGui::TextUnformatted(&entry.severity.front(), &entry.severity.back() + 1);
-         ImGui::PopStyleColor();
-      }
+   ImGui::BeginChild("Entries");
 
-      if (!entry.file.empty()) {
-         ImGui::PushStyleColor(ImGuiCol_Text, {0.25f, 0.75f, 1.0f, 1.0f});
-         ImGui::TextUnformatted(&entry.file.front(), &entry.file.back() + 1);
-         ImGui::PopStyleColor();
-      }
+   const auto& rows = _regex ? _filtered_rows : _log_rows;
+
+   ImGuiListClipper clipper;
+   clipper.Begin(static_cast<int>(rows.size()), ImGui::GetTextLineHeightWithSpacing());
+
+   while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+         const auto& row = rows[i];
+         const auto text = get_text(_file_contents, row.text);
+
+         switch (row.style) {
+         case BF2_log_row_style::severity:
+            ImGui::PushStyleColor(ImGuiCol_Text, get_severity_color(text));
+            break;
+         case BF2_log_row_style::file:
+            ImGui::PushStyleColor(ImGuiCol_Text, {0.25f, 0.75f, 1.0f, 1.0f});
+            break;
+         case BF2_log_row_style::message:
+            break;
+         }
+
+         ImGui::TextUnformatted(text.data(), text.data() + text.size());
 
-      if (!entry.message.empty()) {
-         ImGui::TextUnformatted(&entry.message.front(), &entry.message.back() + 1);
+         if (row.style != BF2_log_row_style::message) ImGui::PopStyleColor();
       }
    }
 
@@ -158,6 +250,27 @@ void BF2_log_monitor::show_imgui(const bool input_enabled) noexcept
    ImGui::End();
 }
 
+void BF2_log_monitor::update_filter() noexcept
+{
+   if (std::exchange(_entries_reset, false)) {
+      _filtered_rows.clear();
+      _filtered_entry_count = 0;
+   }
+
+   if (!_regex) return;
+
+   const std::size_t end = std::min(_log_entries.size(),
+                                    _filtered_entry_count + filter_entries_per_frame);
+
+   for (; _filtered_entry_count < end; ++_filtered_entry_count) {
+      const auto& entry = _log_entries[_filtered_entry_count];
+
+      if (test_filter(entry, _file_contents, *_regex)) {
+         append_rows(entry, _filtered_rows);
+      }
+   }
+}
+
 bool BF2_log_monitor::overlay() const noexcept
 {
    return _overlay;
@@ -177,6 +290,70 @@ void BF2_log_monitor::run() noexcept
 
    const auto log_path = std::filesystem::current_path() /= log_name;
 
+   std::uintmax_t read_offset = 0;
+   std::string unparsed;
+
+   // Only this thread modifies the log's contents so it does not need to lock
+   // to read them, only to change them.
+   const auto read_appended = [&] {
+      std::error_code error;
+
+      const auto file_size = std::filesystem::file_size(log_path, error);
+
+      if (error) return;
+
+      // The log was recreated, likely by the game being restarted.
+      if (file_size < read_offset) {
+         read_offset = 0;
+         unparsed.clear();
+
+         std::lock_guard lock{_mutex};
+
+         _file_contents.clear();
+         _log_entries.clear();
+         _log_rows.clear();
+         _entries_reset = true;
+      }
+
+      if (file_size == read_offset) return;
+
+      std::ifstream file{log_path, std::ios::binary};
+
+      if (!file.seekg(read_offset)) return;
+
+      const std::size_t unparsed_size = unparsed.size();
+
+      unparsed.resize(unparsed_size + (file_size - read_offset));
+      file.read(unparsed.data() + unparsed_size, file_size - read_offset);
+      unparsed.resize(unparsed_size + file.gcount());
+
+      read_offset += file.gcount();
+
+      std::vector<BF2_log_entry> entries;
+
+      const std::size_t parsed =
+         parse_log_text(unparsed, _file_contents.size(), entries);
+
+      if (parsed == 0) return;
+
+      std::vector<BF2_log_row> rows;
+      rows.reserve(entries.size());
+
+      for (const auto& entry : entries) append_rows(entry, rows);
+
+      {
+         std::lock_guard lock{_mutex};
+
+         _file_contents.append(unparsed, 0, parsed);
+         _log_entries.insert(_log_entries.end(), entries.begin(), entries.end());
+         _log_rows.insert(_log_rows.end(), rows.begin(), rows.end());
+      }
+
+      unparsed.erase(0, parsed);
+   };
+
+   read_appended();
+
    while (true) {
       const auto wait_objects = std::array{_join_event.get(), file_notify};
       const auto wait_status =
@@ -187,13 +364,7 @@ void BF2_log_monitor::run() noexcept
       case WAIT_OBJECT_0:
          return;
       case WAIT_OBJECT_0 + 1:
-         if (std::filesystem::exists(log_path) &&
-             std::filesystem::is_regular_file(log_path)) {
-            std::lock_guard lock{_mutex};
-
-            _file_contents = load_string_file(log_path);
-            _log_entries = parse_log_file(_file_contents);
-         }
+         read_appended();
 
          if (!FindNextChangeNotification(file_notify)) {
             std::terminate();
@@ -2,6 +2,7 @@
 
 #include "smart_win32_handle.hpp"
 
+#include <cstddef>
 #include <mutex>
 #include <optional>
 #include <regex>
@@ -12,7 +13,13 @@
 namespace sp {
 
 struct BF2_log_entry;
+struct BF2_log_row;
 
+//! \brief Watches BFront2.log and displays it in an ImGui window.
+//!
+//! Only the bytes appended to the log since it was last read are parsed.
+//! Filter results are kept between frames and only new entries are tested
+//! against the filter.
 class BF2_log_monitor {
 public:
    BF2_log_monitor();
@@ -31,11 +38,18 @@ public:
 private:
    void run() noexcept;
 
+   void update_filter() noexcept;
+
    std::thread _thread;
    win32::Unique_handle _join_event{CreateEventW(nullptr, true, false, nullptr)};
    mutable std::mutex _mutex;
    std::string _file_contents;
    std::vector<BF2_log_entry> _log_entries;
+   std::vector<BF2_log_row> _log_rows;
+   bool _entries_reset = false;
+
+   std::vector<BF2_log_row> _filtered_rows;
+   std::size_t _filtered_entry_count = 0;
 
    std::string _regex_str = "";
    std::optional<std::regex> _regex = std::nullopt;
@@ -44,4 +58,4 @@ private:
    float _transparency = 1.0f;
 };
 
-}
\ No newline at end of file
+}
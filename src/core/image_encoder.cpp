@@ -0,0 +1,317 @@
+
+#include "image_encoder.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <execution>
+#include <stdexcept>
+
+#include <gsl/gsl>
+
+#include <zlib.h>
+
+namespace sp::core {
+
+namespace {
+
+// Size of the filtered image data deflated by each task of encode_png. Large
+// enough that restarting the deflate window for each chunk costs next to
+// nothing in compression.
+constexpr std::size_t png_chunk_size = 1024 * 1024;
+
+struct Rgb8 {
+   std::uint8_t r = 0;
+   std::uint8_t g = 0;
+   std::uint8_t b = 0;
+
+   bool operator==(const Rgb8&) const noexcept = default;
+};
+
+auto load_rgb(const Image_rgba8_view& image, const std::uint32_t x,
+              const std::uint32_t y) noexcept -> Rgb8
+{
+   const auto* const pixel = reinterpret_cast<const std::uint8_t*>(
+      image.pixels.data() + y * image.row_pitch + x * 4);
+
+   if (image.bgra) return {pixel[2], pixel[1], pixel[0]};
+
+   return {pixel[0], pixel[1], pixel[2]};
+}
+
+void append_u32_be(std::vector<std::byte>& output, const std::uint32_t value) noexcept
+{
+   output.push_back(static_cast<std::byte>(value >> 24));
+   output.push_back(static_cast<std::byte>(value >> 16));
+   output.push_back(static_cast<std::byte>(value >> 8));
+   output.push_back(static_cast<std::byte>(value));
+}
+
+void append_bytes(std::vector<std::byte>& output, const std::span<const std::byte> bytes)
+{
+   output.insert(output.end(), bytes.begin(), bytes.end());
+}
+
+void append_png_chunk(std::vector<std::byte>& output, const std::array<char, 4> type,
+                      const std::span<const std::byte> data)
+{
+   append_u32_be(output, gsl::narrow<std::uint32_t>(data.size()));
+
+   const std::size_t crc_begin = output.size();
+
+   append_bytes(output, std::as_bytes(std::span{type}));
+   append_bytes(output, data);
+
+   // The CRC covers the chunk type and data. Computed from output as zlib's
+   // crc32 treats a null buffer (empty data) as a request for the initial value.
+   const auto crc = crc32(0, reinterpret_cast<const Bytef*>(output.data() + crc_begin),
+                          static_cast<uInt>(output.size() - crc_begin));
+
+   append_u32_be(output, static_cast<std::uint32_t>(crc));
+}
+
+struct Deflated_chunk {
+   std::vector<std::byte> data;
+   uLong adler = 1;
+   std::size_t uncompressed_size = 0;
+};
+
+// Filters the rows and deflates them as raw deflate data. Every chunk but the
+// last ends on a byte boundary (Z_SYNC_FLUSH) so they can be concatenated into
+// one stream.
+auto deflate_rows(const Image_rgba8_view& image, const std::uint32_t first_row,
+                  const std::uint32_t row_count, const int compression_level,
+                  const bool last) -> Deflated_chunk
+{
+   const std::size_t filtered_row_size = 1 + std::size_t{image.width} * 3;
+
+   std::vector<std::uint8_t> filtered;
+   filtered.resize(filtered_row_size * row_count);
+
+   for (std::uint32_t row = 0; row < row_count; ++row) {
+      auto* const out = filtered.data() + row * filtered_row_size;
+
+      out[0] = 1; // Sub filter, each byte minus the one from the pixel to the left.
+
+      Rgb8 left{};
+
+      for (std::uint32_t x = 0; x < image.width; ++x) {
+         const Rgb8 pixel = load_rgb(image, x, first_row + row);
+
+         out[1 + x * 3 + 0] = static_cast<std::uint8_t>(pixel.r - left.r);
+         out[1 + x * 3 + 1] = static_cast<std::uint8_t>(pixel.g - left.g);
+         out[1 + x * 3 + 2] = static_cast<std::uint8_t>(pixel.b - left.b);
+
+         left = pixel;
+      }
+   }
+
+   z_stream stream{};
+
+   if (deflateInit2(&stream, compression_level, Z_DEFLATED, -15, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) {
+      throw std::runtime_error{"Failed to initialize zlib deflate stream."};
+   }
+
+   auto stream_end = gsl::finally([&] { deflateEnd(&stream); });
+
+   Deflated_chunk chunk;
+
+   // deflateBound covers Z_FINISH, leave room for the sync flush marker too.
+   chunk.data.resize(deflateBound(&stream, static_cast<uLong>(filtered.size())) + 16);
+   chunk.adler = adler32(1, filtered.data(), static_cast<uInt>(filtered.size()));
+   chunk.uncompressed_size = filtered.size();
+
+   stream.next_in = filtered.data();
+   stream.avail_in = static_cast<uInt>(filtered.size());
+   stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data());
+   stream.avail_out = static_cast<uInt>(chunk.data.size());
+
+   const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+   if ((last && result != Z_STREAM_END) || (!last && result != Z_OK) ||
+       stream.avail_in != 0) {
+      throw std::runtime_error{"Failed to deflate PNG image data."};
+   }
+
+   chunk.data.resize(stream.total_out);
+
+   return chunk;
+}
+
+}
+
+auto encode_png(const Image_rgba8_view& image, const int compression_level)
+   -> std::vector<std::byte>
+{
+   Expects(image.width != 0 && image.height != 0);
+   Expects(image.pixels.size() >= (image.height - 1) * image.row_pitch + image.width * 4);
+
+   const std::size_t filtered_row_size = 1 + std::size_t{image.width} * 3;
+   const auto rows_per_chunk = static_cast<std::uint32_t>(
+      std::max(png_chunk_size / filtered_row_size, std::size_t{1}));
+   const std::uint32_t chunk_count = (image.height + rows_per_chunk - 1) / rows_per_chunk;
+
+   std::vector<Deflated_chunk> chunks;
+   chunks.resize(chunk_count);
+
+   std::for_each_n(std::execution::par, Index_iterator{}, chunk_count,
+                   [&](const std::uint32_t i) {
+                      const std::uint32_t first_row = i * rows_per_chunk;
+
+                      chunks[i] = deflate_rows(image, first_row,
+                                               std::min(rows_per_chunk,
+                                                        image.height - first_row),
+                                               compression_level,
+                                               (i + 1) == chunk_count);
+                   });
+
+   std::vector<std::byte> zlib_stream;
+
+   std::size_t deflated_size = 0;
+
+   for (const auto& chunk : chunks) deflated_size += chunk.data.size();
+
+   zlib_stream.reserve(2 + deflated_size + 4);
+
+   // Deflate with a 32K window, default compression level.
+   zlib_stream.push_back(std::byte{0x78});
+   zlib_stream.push_back(std::byte{0x9c});
+
+   uLong adler = 1;
+
+   for (const auto& chunk : chunks) {
+      append_bytes(zlib_stream, chunk.data);
+
+      adler = adler32_combine(adler, chunk.adler,
+                              static_cast<z_off_t>(chunk.uncompressed_size));
+   }
+
+   append_u32_be(zlib_stream, static_cast<std::uint32_t>(adler));
+
+   std::vector<std::byte> png;
+   png.reserve(zlib_stream.size() + 64);
+
+   constexpr std::array<std::uint8_t, 8> signature{0x89, 'P',  'N',  'G',
+                                                   '\r', '\n', 0x1a, '\n'};
+
+   append_bytes(png, std::as_bytes(std::span{signature}));
+
+   std::vector<std::byte> header;
+
+   append_u32_be(header, image.width);
+   append_u32_be(header, image.height);
+   header.push_back(std::byte{8}); // bit depth
+   header.push_back(std::byte{2}); // colour type, RGB
+   header.push_back(std::byte{0}); // compression method
+   header.push_back(std::byte{0}); // filter method
+   header.push_back(std::byte{0}); // interlace method
+
+   append_png_chunk(png, {'I', 'H', 'D', 'R'}, header);
+   append_png_chunk(png, {'I', 'D', 'A', 'T'}, zlib_stream);
+   append_png_chunk(png, {'I', 'E', 'N', 'D'}, {});
+
+   return png;
+}
+
+auto encode_qoi(const Image_rgba8_view& image) -> std::vector<std::byte>
+{
+   Expects(image.width != 0 && image.height != 0);
+   Expects(image.pixels.size() >= (image.height - 1) * image.row_pitch + image.width * 4);
+
+   constexpr std::uint8_t op_index = 0x00;
+   constexpr std::uint8_t op_diff = 0x40;
+   constexpr std::uint8_t op_luma = 0x80;
+   constexpr std::uint8_t op_run = 0xc0;
+   constexpr std::uint8_t op_rgb = 0xfe;
+   constexpr int max_run = 62;
+
+   std::vector<std::byte> output;
+
+   // Worst case is every pixel being an RGB op.
+   output.reserve(14 + std::size_t{image.width} * image.height * 4 + 8);
+
+   append_bytes(output, std::as_bytes(std::span{"qoif", 4}));
+   append_u32_be(output, image.width);
+   append_u32_be(output, image.height);
+   output.push_back(std::byte{3}); // channels, RGB
+   output.push_back(std::byte{0}); // colour space, sRGB with linear alpha
+
+   const auto emit = [&](const auto value) {
+      output.push_back(static_cast<std::byte>(value));
+   };
+
+   // Alpha is always 255 so it's folded into the constant in the hash.
+   const auto hash = [](const Rgb8 pixel) noexcept {
+      return (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + 255 * 11) % 64;
+   };
+
+   // Decoders start with an index of transparent black which no opaque pixel
+   // can match, so entries are only used once they have been written.
+   std::array<Rgb8, 64> index{};
+   std::array<bool, 64> index_valid{};
+   Rgb8 previous{};
+   int run = 0;
+
+   for (std::uint32_t y = 0; y < image.height; ++y) {
+      for (std::uint32_t x = 0; x < image.width; ++x) {
+         const Rgb8 pixel = load_rgb(image, x, y);
+
+         if (pixel == previous) {
+            if (++run == max_run) {
+               emit(op_run | (run - 1));
+               run = 0;
+            }
+
+            continue;
+         }
+
+         if (run > 0) {
+            emit(op_run | (run - 1));
+            run = 0;
+         }
+
+         const auto index_position = hash(pixel);
+
+         if (index_valid[index_position] && index[index_position] == pixel) {
+            emit(op_index | index_position);
+         }
+         else {
+            index[index_position] = pixel;
+            index_valid[index_position] = true;
+
+            const auto vr = static_cast<std::int8_t>(pixel.r - previous.r);
+            const auto vg = static_cast<std::int8_t>(pixel.g - previous.g);
+            const auto vb = static_cast<std::int8_t>(pixel.b - previous.b);
+            const int vg_r = vr - vg;
+            const int vg_b = vb - vg;
+
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+               emit(op_diff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+            }
+            else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 &&
+                     vg_b < 8) {
+               emit(op_luma | (vg + 32));
+               emit((vg_r + 8) << 4 | (vg_b + 8));
+            }
+            else {
+               emit(op_rgb);
+               emit(pixel.r);
+               emit(pixel.g);
+               emit(pixel.b);
+            }
+         }
+
+         previous = pixel;
+      }
+   }
+
+   if (run > 0) emit(op_run | (run - 1));
+
+   append_bytes(output, std::as_bytes(std::span{"\0\0\0\0\0\0\0\1", 8}));
+
+   return output;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sp::core {
+
+//! \brief A view of 8-bit per channel RGBA or BGRA pixels.
+struct Image_rgba8_view {
+   std::uint32_t width = 0;
+   std::uint32_t height = 0;
+   std::size_t row_pitch = 0;
+   bool bgra = false;
+   std::span<const std::byte> pixels;
+};
+
+//! \brief Encode an image as an RGB PNG. Alpha is dropped.
+//!
+//! Rows are filtered and deflated in parallel chunks which are then joined into
+//! a single zlib stream, the output is a standard PNG.
+//!
+//! \param image The image to encode.
+//! \param compression_level The zlib compression level to use, from 1 to 9.
+//! \return The PNG file's contents.
+auto encode_png(const Image_rgba8_view& image, const int compression_level = 6)
+   -> std::vector<std::byte>;
+
+//! \brief Encode an image as an RGB QOI (https://qoiformat.org/). Alpha is
+//! dropped.
+//!
+//! QOI is lossless like PNG and encodes many times faster, at the cost of
+//! larger files and less software being able to open them.
+//!
+//! \param image The image to encode.
+//! \return The QOI file's contents.
+auto encode_qoi(const Image_rgba8_view& image) -> std::vector<std::byte>;
+
+}
@@ -1,19 +1,18 @@
-#pragma once
 
+#include "screenshot.hpp"
+#include "../logger.hpp"
+#include "image_encoder.hpp"
+
+#include <algorithm>
+#include <cstring>
 #include <ctime>
-#include <execution>
-#include <filesystem>
+#include <exception>
+#include <fstream>
 #include <iomanip>
-#include <span>
+#include <limits>
 #include <sstream>
 
-#include "../logger.hpp"
-#include "swapchain.hpp"
-#include "utility.hpp"
-
-#include <DirectXTex.h>
-#include <d3d11_2.h>
-#include <wincodec.h>
+#include <gsl/gsl>
 
 #pragma warning(disable : 4996) // std::localtime use
 
@@ -23,6 +22,18 @@ using namespace std::literals;
 
 namespace {
 
+static_assert(Swapchain::format == DXGI_FORMAT_R8G8B8A8_UNORM ||
+                 Swapchain::format == DXGI_FORMAT_B8G8R8A8_UNORM,
+              "Screenshot encoding expects an 8-bit RGBA or BGRA swapchain.");
+
+// Frames to wait after copying the backbuffer before trying to read it back.
+// Mapping any sooner would stall the render thread until the GPU catches up.
+constexpr std::uint64_t map_delay_frames = 2;
+
+// Encoding a PNG already spreads across cores, a second thread lets a QOI or
+// a file write overlap with it.
+constexpr std::size_t worker_count = 2;
+
 auto date_time_string() -> std::string
 {
    const auto time = std::time(nullptr);
@@ -34,95 +45,224 @@ auto date_time_string() -> std::string
    return stream.str();
 }
 
-auto pick_save_file(const std::filesystem::path& save_folder) noexcept
-   -> std::filesystem::path
+auto extension(const Screenshot_format format) noexcept -> std::string_view
 {
-   const auto date_time = date_time_string();
-
-   for (std::uint32_t i = 0; i < std::numeric_limits<std::uint32_t>::max(); ++i) {
-      std::filesystem::path path{save_folder};
-      path += date_time;
-
-      if (i != 0) path += "#"s + std::to_string(i);
-
-      path += ".png"s;
-
-      if (!std::filesystem::exists(path)) return path;
+   switch (format) {
+   case Screenshot_format::png:
+      return ".png"sv;
+   case Screenshot_format::qoi:
+      return ".qoi"sv;
    }
 
-   log_and_terminate("Failed to find free file for screenshot!");
+   std::terminate();
 }
 
-void make_opaque(const DirectX::Image image) noexcept
-{
-   Expects(image.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
-           image.format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
-
-   std::for_each_n(std::execution::par_unseq, Index_iterator{}, image.height,
-                   [&](const auto y) {
-                      const std::span<std::uint8_t> row{image.pixels + y * image.rowPitch,
-                                                        image.rowPitch};
-
-                      for (auto x = 0; x < image.width; ++x) {
-                         row[x * 4 + 3] = 0xff;
-                      }
-                   });
 }
 
-void save_screenshot(const std::filesystem::path& save_file, const Swapchain& swapchain,
-                     const D3D11_MAPPED_SUBRESOURCE mapped_cpu_texture) noexcept
+Screenshot_capturer::Screenshot_capturer(Com_ptr<ID3D11Device5> device) noexcept
+   : _device{std::move(device)}
 {
-   DirectX::Image image;
-   image.format = DirectX::MakeSRGB(swapchain.format);
-   image.width = swapchain.width();
-   image.height = swapchain.height();
-   image.rowPitch = mapped_cpu_texture.RowPitch;
-   image.slicePitch = mapped_cpu_texture.DepthPitch;
-   image.pixels = static_cast<std::uint8_t*>(mapped_cpu_texture.pData);
-
-   make_opaque(image);
-
-   if (FAILED(DirectX::SaveToWICFile(image, DirectX::WIC_FLAGS_NONE,
-                                     GUID_ContainerFormatPng, save_file.c_str())))
-      log(Log_level::error, "Failed to save screenshot ", save_file, ".");
-   else
-      log(Log_level::info, "Saved screenshot ", save_file, ".");
-}
+   _threads.reserve(worker_count);
+
+   for (auto i = 0u; i < worker_count; ++i) {
+      _threads.emplace_back([this](std::stop_token stop) { run(stop); });
+   }
 }
 
-void screenshot(ID3D11Device2& device, ID3D11DeviceContext2& dc,
-                const Swapchain& swapchain,
-                const std::filesystem::path& save_folder) noexcept
+Screenshot_capturer::~Screenshot_capturer() = default;
+
+void Screenshot_capturer::capture(ID3D11DeviceContext2& dc, const Swapchain& swapchain,
+                                  const std::filesystem::path& save_folder,
+                                  const Screenshot_format format) noexcept
 {
    Expects(!std::filesystem::exists(save_folder) ||
            std::filesystem::is_directory(save_folder));
 
    std::filesystem::create_directory(save_folder);
 
-   const auto cpu_texture = [&] {
-      Com_ptr<ID3D11Texture2D> texture;
+   auto staging = std::find_if(_staging_textures.begin(), _staging_textures.end(),
+                               [](const Staging_texture& staging) {
+                                  return !staging.busy;
+                               });
+
+   if (staging == _staging_textures.end()) {
+      log(Log_level::warning,
+          "Too many screenshots are waiting on the GPU, skipping screenshot."sv);
 
-      const CD3D11_TEXTURE2D_DESC desc{swapchain.format,
+      return;
+   }
+
+   if (!staging->texture || staging->width != swapchain.width() ||
+       staging->height != swapchain.height()) {
+      const CD3D11_TEXTURE2D_DESC desc{Swapchain::format,
                                        swapchain.width(),
                                        swapchain.height(),
                                        1,
                                        1,
                                        0,
                                        D3D11_USAGE_STAGING,
-                                       D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE};
+                                       D3D11_CPU_ACCESS_READ};
+
+      if (FAILED(_device->CreateTexture2D(&desc, nullptr,
+                                          staging->texture.clear_and_assign()))) {
+         log(Log_level::error, "Failed to create texture for screenshot."sv);
+
+         return;
+      }
+
+      staging->width = swapchain.width();
+      staging->height = swapchain.height();
+   }
+
+   dc.CopyResource(staging->texture.get(), swapchain.texture());
+
+   staging->busy = true;
+   staging->copy_frame = _frame;
+   staging->job = {.save_folder = save_folder,
+                   .date_time = date_time_string(),
+                   .format = format,
+                   .width = staging->width,
+                   .height = staging->height};
+}
+
+void Screenshot_capturer::update(ID3D11DeviceContext2& dc) noexcept
+{
+   _frame += 1;
+
+   for (auto& staging : _staging_textures) {
+      if (!staging.busy || (_frame - staging.copy_frame) < map_delay_frames) continue;
+
+      D3D11_MAPPED_SUBRESOURCE mapped;
+
+      const HRESULT result = dc.Map(staging.texture.get(), 0, D3D11_MAP_READ,
+                                    D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+      if (result == DXGI_ERROR_WAS_STILL_DRAWING) continue;
+
+      staging.busy = false;
+
+      if (FAILED(result)) {
+         log(Log_level::error, "Failed to read back screenshot."sv);
+
+         staging.job = {};
+
+         continue;
+      }
+
+      Job job = std::move(staging.job);
+
+      // Copied out so the staging texture is free for the next capture while
+      // the (much slower) encode runs.
+      const std::size_t row_size = std::size_t{job.width} * 4;
 
-      device.CreateTexture2D(&desc, nullptr, texture.clear_and_assign());
+      job.pixels.resize(row_size * job.height);
 
-      return texture;
-   }();
+      for (std::uint32_t y = 0; y < job.height; ++y) {
+         std::memcpy(job.pixels.data() + y * row_size,
+                     static_cast<const std::byte*>(mapped.pData) + y * mapped.RowPitch,
+                     row_size);
+      }
 
-   dc.CopyResource(cpu_texture.get(), swapchain.texture());
+      dc.Unmap(staging.texture.get(), 0);
 
-   D3D11_MAPPED_SUBRESOURCE mapped_texture;
-   dc.Map(cpu_texture.get(), 0, D3D11_MAP_READ_WRITE, 0, &mapped_texture);
+      {
+         std::scoped_lock lock{_mutex};
 
-   save_screenshot(pick_save_file(save_folder), swapchain, mapped_texture);
+         _queue.push_back(std::move(job));
+      }
 
-   dc.Unmap(cpu_texture.get(), 0);
+      _queue_changed.notify_one();
+   }
+}
+
+void Screenshot_capturer::run(std::stop_token stop) noexcept
+{
+   std::unique_lock lock{_mutex};
+
+   // Keeps going after a stop is requested until the queue is empty so no
+   // screenshots are lost on exit.
+   while (true) {
+      if (!_queue_changed.wait(lock, stop, [this] { return !_queue.empty(); })) {
+         return;
+      }
+
+      Job job = std::move(_queue.front());
+      _queue.pop_front();
+
+      lock.unlock();
+
+      save(job);
+
+      lock.lock();
+   }
+}
+
+void Screenshot_capturer::save(Job& job) noexcept
+{
+   const Image_rgba8_view image{.width = job.width,
+                                .height = job.height,
+                                .row_pitch = std::size_t{job.width} * 4,
+                                .bgra = Swapchain::format == DXGI_FORMAT_B8G8R8A8_UNORM,
+                                .pixels = job.pixels};
+
+   std::vector<std::byte> file_data;
+
+   try {
+      file_data = job.format == Screenshot_format::qoi ? encode_qoi(image)
+                                                       : encode_png(image);
+   }
+   catch (std::exception& e) {
+      log(Log_level::error, "Failed to encode screenshot: "sv, e.what());
+
+      return;
+   }
+
+   job.pixels = {};
+
+   const auto save_file = reserve_save_file(job);
+
+   {
+      std::ofstream file{save_file, std::ios::binary};
+
+      file.write(reinterpret_cast<const char*>(file_data.data()), file_data.size());
+
+      if (!file)
+         log(Log_level::error, "Failed to save screenshot ", save_file, ".");
+      else
+         log(Log_level::info, "Saved screenshot ", save_file, ".");
+   }
+
+   std::scoped_lock lock{_mutex};
+
+   std::erase(_reserved_save_files, save_file);
 }
+
+auto Screenshot_capturer::reserve_save_file(const Job& job) noexcept
+   -> std::filesystem::path
+{
+   std::scoped_lock lock{_mutex};
+
+   for (std::uint32_t i = 0; i < std::numeric_limits<std::uint32_t>::max(); ++i) {
+      std::filesystem::path path{job.save_folder};
+      path += job.date_time;
+
+      if (i != 0) path += "#"s + std::to_string(i);
+
+      path += extension(job.format);
+
+      // Screenshots taken within the same second can still be encoding and so
+      // not be on disk yet.
+      if (std::filesystem::exists(path) ||
+          std::ranges::find(_reserved_save_files, path) != _reserved_save_files.end()) {
+         continue;
+      }
+
+      _reserved_save_files.push_back(path);
+
+      return path;
+   }
+
+   log_and_terminate("Failed to find free file for screenshot!");
+}
+
 }
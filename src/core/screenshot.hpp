@@ -1,12 +1,90 @@
 #pragma once
 
+#include "../user_config.hpp"
+#include "com_ptr.hpp"
 #include "swapchain.hpp"
 
-#include <d3d11_2.h>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <d3d11_4.h>
 
 namespace sp::core {
 
-void screenshot(ID3D11Device2& device, ID3D11DeviceContext2& dc,
-                const Swapchain& swapchain,
-                const std::filesystem::path& save_folder) noexcept;
+//! \brief Takes screenshots without stalling the render thread.
+//!
+//! The backbuffer is copied into one of a small ring of staging textures and is
+//! only read back a few frames later once the GPU has finished with it. The
+//! pixels are then encoded and written to disk by worker threads.
+class Screenshot_capturer {
+public:
+   explicit Screenshot_capturer(Com_ptr<ID3D11Device5> device) noexcept;
+
+   ~Screenshot_capturer();
+
+   Screenshot_capturer(const Screenshot_capturer&) = delete;
+   Screenshot_capturer& operator=(const Screenshot_capturer&) = delete;
+
+   Screenshot_capturer(Screenshot_capturer&&) = delete;
+   Screenshot_capturer& operator=(Screenshot_capturer&&) = delete;
+
+   //! Copy the swapchain's contents to be saved into save_folder. The capture
+   //! is dropped (with a warning) if too many are already waiting on the GPU.
+   void capture(ID3D11DeviceContext2& dc, const Swapchain& swapchain,
+                const std::filesystem::path& save_folder,
+                const Screenshot_format format) noexcept;
+
+   //! Read back captures the GPU has finished and queue them to be saved. Must
+   //! be called once per frame.
+   void update(ID3D11DeviceContext2& dc) noexcept;
+
+private:
+   struct Job {
+      std::filesystem::path save_folder;
+      std::string date_time;
+      Screenshot_format format = Screenshot_format::png;
+
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+      std::vector<std::byte> pixels;
+   };
+
+   struct Staging_texture {
+      Com_ptr<ID3D11Texture2D> texture;
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+
+      bool busy = false;
+      std::uint64_t copy_frame = 0;
+      Job job;
+   };
+
+   void run(std::stop_token stop) noexcept;
+
+   void save(Job& job) noexcept;
+
+   auto reserve_save_file(const Job& job) noexcept -> std::filesystem::path;
+
+   Com_ptr<ID3D11Device5> _device;
+
+   std::array<Staging_texture, 3> _staging_textures;
+   std::uint64_t _frame = 0;
+
+   std::mutex _mutex;
+   std::condition_variable_any _queue_changed;
+   std::deque<Job> _queue;
+   std::vector<std::filesystem::path> _reserved_save_files;
+
+   // Declared last so the threads are joined before anything they use is destroyed.
+   std::vector<std::jthread> _threads;
+};
+
 }
@@ -2,6 +2,7 @@
 #include "shader_patch.hpp"
 #include "../bf2_log_monitor.hpp"
 #include "../effects/color_helpers.hpp"
+#include "../effects/cpu_profiler.hpp"
 #include "../game_support/memory_hacks.hpp"
 #include "../input_config.hpp"
 #include "../logger.hpp"
@@ -10,7 +11,6 @@
 #include "../user_config.hpp"
 #include "patch_material_io.hpp"
 #include "patch_texture_io.hpp"
-#include "screenshot.hpp"
 #include "utility.hpp"
 
 #include "../imgui/imgui_impl_dx11.h"
@@ -192,6 +192,7 @@ Shader_patch::Shader_patch(IDXGIAdapter4& adapter, const HWND window,
    update_refraction_target();
 
    _basic_builtin_textures.add_to_database(_shader_resource_database);
+   _shader_resource_database.track_changes();
 
    _cb_scene.input_color_srgb = false;
    _cb_draw_ps.additive_blending = false;
@@ -275,6 +276,7 @@ void Shader_patch::reset(const Reset_flags flags, const UINT render_width,
 
    update_rendertargets();
    update_refraction_target();
+   _material_resource_tracker.mark_all_dirty();
    update_material_resources();
    restore_all_game_state();
 }
@@ -291,7 +293,13 @@ void Shader_patch::set_expected_aspect_ratio(const float expected_aspect_ratio)
 
 void Shader_patch::present() noexcept
 {
+   static const auto profile_section =
+      effects::cpu_profiler().section("Shader_patch::present"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
    _effects.profiler.end_frame(*_device_context);
+   effects::cpu_profiler().end_frame();
+   effects::cpu_profiler().show_imgui();
    _game_postprocessing.end_frame();
 
    if (_game_rendertargets[0].type != Game_rt_type::presentation) {
@@ -300,8 +308,12 @@ void Shader_patch::present() noexcept
 
    update_imgui();
 
-   if (std::exchange(_screenshot_requested, false))
-      screenshot(*_device, *_device_context, _swapchain, screenshots_folder);
+   if (std::exchange(_screenshot_requested, false)) {
+      _screenshot_capturer.capture(*_device_context, _swapchain, screenshots_folder,
+                                   user_config.graphics.screenshot_format);
+   }
+
+   _screenshot_capturer.update(*_device_context);
 
    if (_swapchain.present() == Present_status::needs_reset) {
       const bool reset_game_rendertarget =
@@ -317,11 +329,15 @@ void Shader_patch::present() noexcept
 
    _shader_database.cache_update();
 
-   if (_font_atlas_builder &&
-       _font_atlas_builder->update_srv_database(_shader_resource_database)) {
-      update_material_resources();
+   if (_font_atlas_builder) {
+      _font_atlas_builder->update_srv_database(_shader_resource_database);
    }
 
+   _texture_streamer.update_srv_database(_shader_resource_database);
+   _rendertarget_allocator.end_frame();
+
+   update_material_resources();
+
    if (_set_aspect_ratio_on_present) {
       game_support::set_aspect_ratio(static_cast<float>(_render_height) /
                                      static_cast<float>(_render_width));
@@ -744,7 +760,9 @@ auto Shader_patch::create_patch_texture(const std::span<const std::byte> texture
 {
    try {
       auto [srv, name] =
-         load_patch_texture(ucfb::Reader_strict<"sptx"_mn>{texture_data}, *_device);
+         user_config.graphics.stream_textures
+            ? _texture_streamer.stream(texture_data)
+            : load_patch_texture(ucfb::Reader_strict<"sptx"_mn>{texture_data}, *_device);
 
       auto* raw_srv = srv.get();
 
@@ -753,6 +771,13 @@ auto Shader_patch::create_patch_texture(const std::span<const std::byte> texture
       _shader_resource_database.insert(std::move(srv), name);
 
       const auto texture_deleter = [this](ID3D11ShaderResourceView* srv) noexcept {
+         // Streamed textures may have had their placeholder swapped out. The
+         // reference keeps the current SRV (and so its address) alive until
+         // it has been looked up.
+         const auto current = _texture_streamer.release(srv);
+
+         if (current) srv = current.get();
+
          const auto [exists, name] = _shader_resource_database.reverse_lookup(srv);
 
          if (!exists) return; // Texture has already been replaced.
@@ -774,6 +799,10 @@ auto Shader_patch::create_patch_texture(const std::span<const std::byte> texture
 auto Shader_patch::create_patch_material(const std::span<const std::byte> material_data) noexcept
    -> Material_handle
 {
+   static const auto profile_section =
+      effects::cpu_profiler().section("Shader_patch::create_patch_material"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
    try {
       const auto config =
          read_patch_material(ucfb::Reader_strict<"matl"_mn>{material_data});
@@ -785,6 +814,8 @@ auto Shader_patch::create_patch_material(const std::span<const std::byte> materi
 
       log(Log_level::info, "Loaded material "sv, std::quoted(material->name));
 
+      _material_resource_tracker.track(*material);
+
       const auto material_deleter = [this](material::Material* material) noexcept {
          if (_patch_material == material) set_patch_material(nullptr);
 
@@ -793,6 +824,7 @@ auto Shader_patch::create_patch_material(const std::span<const std::byte> materi
 
             log(Log_level::info, "Destroying material "sv, std::quoted(material->name));
 
+            _material_resource_tracker.untrack(*material);
             _materials.erase(it);
 
             return;
@@ -1849,6 +1881,10 @@ void Shader_patch::game_rendertype_changed() noexcept
 
 void Shader_patch::update_dirty_state(const D3D11_PRIMITIVE_TOPOLOGY draw_primitive_topology) noexcept
 {
+   static const auto profile_section =
+      effects::cpu_profiler().section("Shader_patch::update_dirty_state"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
    if (std::exchange(_shader_rendertype_changed, false))
       game_rendertype_changed();
 
@@ -2083,7 +2119,9 @@ void Shader_patch::update_imgui() noexcept
       user_config.show_imgui();
       _effects.show_imgui(_window);
 
-      material::show_editor(_material_factory, _materials);
+      for (auto* material : material::show_editor(_material_factory, _materials)) {
+         _material_resource_tracker.retrack(*material);
+      }
 
       if (_bf2_log_monitor) _bf2_log_monitor->show_imgui(true);
 
@@ -2093,6 +2131,26 @@ void Shader_patch::update_imgui() noexcept
       if (ImGui::Begin("Dev Tools")) {
          ImGui::Checkbox("Pixel Inspector", &_pixel_inspector.enabled);
 
+         const auto material_stats = _material_resource_tracker.stats();
+
+         ImGui::Text("Materials Rebound Last Frame: %zu",
+                     material_stats.rebound_last_update);
+         ImGui::Text("Materials Rebound Total: %zu", material_stats.rebound_total);
+         ImGui::Text("Textures Streaming: %zu", _texture_streamer.pending());
+
+         _rendertarget_allocator.request_plan();
+
+         const auto rendertarget_stats = _rendertarget_allocator.stats();
+
+         ImGui::Text("Effects Rendertargets Pooled: %zu (%.1f MB)",
+                     rendertarget_stats.pooled_count,
+                     rendertarget_stats.pooled_size / 1048576.0);
+         ImGui::Text("Effects Rendertargets Planned: %.1f MB (%.1f MB unaliased)",
+                     rendertarget_stats.planned_size / 1048576.0,
+                     rendertarget_stats.unaliased_size / 1048576.0);
+         ImGui::Text("Effects Rendertargets Evicted: %zu",
+                     rendertarget_stats.evicted_total);
+
          if (_pixel_inspector.enabled) {
             _pixel_inspector.show(*_device_context, _swapchain, _window);
          }
@@ -2105,7 +2163,7 @@ void Shader_patch::update_imgui() noexcept
       ImGui::Render();
       ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
    }
-   else if (_effects.profiler.enabled ||
+   else if (_effects.profiler.enabled || effects::cpu_profiler().enabled() ||
             (_bf2_log_monitor && _bf2_log_monitor->overlay())) {
       if (_bf2_log_monitor) _bf2_log_monitor->show_imgui(false);
 
@@ -2318,9 +2376,15 @@ void Shader_patch::update_team_colors() noexcept
 
 void Shader_patch::update_material_resources() noexcept
 {
-   for (auto& mat : _materials) {
-      mat->update_resources(_shader_resource_database);
+   static const auto profile_section =
+      effects::cpu_profiler().section("Shader_patch::update_material_resources"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
+   for (const auto& name : _shader_resource_database.take_changed_names()) {
+      _material_resource_tracker.mark_dirty(name);
    }
+
+   _material_resource_tracker.update(_shader_resource_database);
 }
 
 void Shader_patch::recreate_patch_backbuffer() noexcept
@@ -5,6 +5,7 @@
 #include "../effects/rendertarget_allocator.hpp"
 #include "../material/factory.hpp"
 #include "../material/material.hpp"
+#include "../material/resource_tracker.hpp"
 #include "../material/shader_factory.hpp"
 #include "../shader/database.hpp"
 #include "../user_config.hpp"
@@ -28,11 +29,13 @@
 #include "patch_effects_config_handle.hpp"
 #include "postprocessing/backbuffer_resolver.hpp"
 #include "sampler_states.hpp"
+#include "screenshot.hpp"
 #include "small_function.hpp"
 #include "swapchain.hpp"
 #include "text/font_atlas_builder.hpp"
 #include "texture_database.hpp"
 #include "texture_loader.hpp"
+#include "texture_streamer.hpp"
 #include "tools/pixel_inspector.hpp"
 
 #include <span>
@@ -564,6 +567,8 @@ private:
    Sampler_states _sampler_states{*_device};
    Shader_resource_database _shader_resource_database{
       load_texture_lvl(L"data/shaderpatch/textures.lvl", *_device)};
+   Texture_streamer _texture_streamer{_device};
+   Screenshot_capturer _screenshot_capturer{_device};
    Game_alt_postprocessing _game_postprocessing{*_device, _shader_database};
    postprocessing::Backbuffer_resolver _backbuffer_resolver{_device, _shader_database};
 
@@ -573,6 +578,7 @@ private:
    material::Factory _material_factory{_device, _shader_rendertypes_database,
                                        _shader_resource_database};
    std::vector<std::unique_ptr<material::Material>> _materials;
+   material::Resource_tracker _material_resource_tracker;
 
    glm::mat4 _informal_projection_matrix;
    glm::mat4 _postprocess_projection_matrix;
@@ -9,8 +9,12 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <execution>
 #include <filesystem>
+#include <fstream>
+#include <limits>
 #include <numeric>
 #include <optional>
 #include <span>
@@ -62,17 +66,133 @@ auto copy_freetype_bitmap(FT_Bitmap bitmap) -> Rendered_glyph
    return glyph;
 }
 
-struct Pack_target {
-   std::uint32_t pitch;
-   std::span<std::byte> data;
-   float width;
-   float height;
-   std::span<Glyph_location, glyph_count> locations;
+struct Glyph_placement {
+   std::uint32_t x;
+   std::uint32_t y;
 };
 
-auto pack_glyphs(const std::array<Rendered_glyph, glyph_count>& rendered_glyphs,
-                 std::optional<Pack_target> output)
-   -> std::pair<std::uint32_t, std::uint32_t>
+// Bottom-left skyline packer. The skyline is the top edge of everything packed
+// so far, each glyph goes wherever it would end up lowest.
+class Skyline_packer {
+public:
+   explicit Skyline_packer(const std::uint32_t width) noexcept : _width{width}
+   {
+      _skyline.push_back({.x = 0, .y = 0, .width = width});
+   }
+
+   auto pack(const std::uint32_t width, const std::uint32_t height) noexcept
+      -> std::optional<Glyph_placement>
+   {
+      std::size_t best_node = _skyline.size();
+      std::uint32_t best_y = std::numeric_limits<std::uint32_t>::max();
+      std::uint32_t best_bottom = std::numeric_limits<std::uint32_t>::max();
+      std::uint32_t best_node_width = std::numeric_limits<std::uint32_t>::max();
+
+      for (std::size_t i = 0; i < _skyline.size(); ++i) {
+         const auto y = fit(i, width);
+
+         if (!y) continue;
+
+         const std::uint32_t bottom = *y + height;
+
+         if (bottom < best_bottom ||
+             (bottom == best_bottom && _skyline[i].width < best_node_width)) {
+            best_node = i;
+            best_y = *y;
+            best_bottom = bottom;
+            best_node_width = _skyline[i].width;
+         }
+      }
+
+      if (best_node == _skyline.size()) return std::nullopt;
+
+      const Glyph_placement placement{.x = _skyline[best_node].x, .y = best_y};
+
+      insert(best_node, {.x = placement.x, .y = best_bottom, .width = width});
+
+      _height = std::max(_height, best_bottom);
+
+      return placement;
+   }
+
+   auto height() const noexcept -> std::uint32_t
+   {
+      return _height;
+   }
+
+private:
+   struct Node {
+      std::uint32_t x;
+      std::uint32_t y;
+      std::uint32_t width;
+   };
+
+   // The lowest y a rect of `width` can sit at when its left edge is at node `index`.
+   auto fit(const std::size_t index, const std::uint32_t width) const noexcept
+      -> std::optional<std::uint32_t>
+   {
+      if (_skyline[index].x + width > _width) return std::nullopt;
+
+      std::uint32_t y = 0;
+      std::uint32_t remaining = width;
+
+      for (std::size_t i = index; remaining > 0; ++i) {
+         y = std::max(y, _skyline[i].y);
+         remaining -= std::min(remaining, _skyline[i].width);
+      }
+
+      return y;
+   }
+
+   void insert(const std::size_t index, const Node node) noexcept
+   {
+      _skyline.insert(_skyline.begin() + index, node);
+
+      const std::uint32_t right = node.x + node.width;
+
+      // Trim or remove the nodes now underneath the new one.
+      for (auto it = _skyline.begin() + index + 1; it != _skyline.end();) {
+         if (it->x >= right) break;
+
+         const std::uint32_t shrink = std::min(right - it->x, it->width);
+
+         it->x += shrink;
+         it->width -= shrink;
+
+         if (it->width == 0) {
+            it = _skyline.erase(it);
+         }
+         else {
+            break;
+         }
+      }
+
+      // Merge neighbours at the same height.
+      for (std::size_t i = 0; (i + 1) < _skyline.size();) {
+         if (_skyline[i].y == _skyline[i + 1].y) {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+         }
+         else {
+            ++i;
+         }
+      }
+   }
+
+   const std::uint32_t _width;
+   std::uint32_t _height = 0;
+   std::vector<Node> _skyline;
+};
+
+struct Packed_atlas {
+   std::uint32_t width;
+   std::uint32_t height;
+   std::vector<std::byte> data;
+   std::array<Glyph_location, glyph_count> locations;
+};
+
+auto pack_glyphs(const std::array<Rendered_glyph, glyph_count>& rendered_glyphs)
+   -> Packed_atlas
 {
    static_assert(glyph_count <= std::numeric_limits<std::uint8_t>::max());
    std::array<std::uint8_t, glyph_count> pack_order;
@@ -80,63 +200,224 @@ auto pack_glyphs(const std::array<Rendered_glyph, glyph_count>& rendered_glyphs,
    std::iota(pack_order.begin(), pack_order.end(), std::uint8_t{0});
 
    std::ranges::sort(pack_order, [&](const std::uint8_t l, const std::uint8_t r) {
-      return rendered_glyphs[l].height < rendered_glyphs[r].height;
+      const auto& left = rendered_glyphs[l];
+      const auto& right = rendered_glyphs[r];
+
+      if (left.height != right.height) return left.height > right.height;
+
+      return left.width > right.width;
    });
 
    constexpr std::uint32_t atlas_max_width = 8192;
    constexpr std::uint32_t atlas_max_height = 8192;
+   constexpr std::uint32_t glyph_padding = 1;
+
+   // Aim for a roughly square atlas, leaving a little slack for the packing
+   // not being perfect.
+   std::uint64_t padded_area = 0;
+   std::uint32_t widest_glyph = 0;
+
+   for (const auto& glyph : rendered_glyphs) {
+      padded_area += std::uint64_t{glyph.width + glyph_padding} *
+                     (glyph.height + glyph_padding);
+      widest_glyph = std::max(widest_glyph, glyph.width + glyph_padding);
+   }
+
+   const std::uint32_t atlas_width = std::clamp(
+      next_multiple_of<4u>(static_cast<std::uint32_t>(
+         std::ceil(std::sqrt(static_cast<double>(padded_area) * 1.05)))),
+      std::max(widest_glyph, 1u), atlas_max_width);
 
-   std::uint32_t max_row_height = 0;
-   std::uint32_t pack_head_x = 0;
-   std::uint32_t pack_head_y = 0;
-   bool multiple_rows = false;
+   Skyline_packer packer{atlas_width};
+   std::array<Glyph_placement, glyph_count> placements;
 
    for (auto i : pack_order) {
-      auto& glyph = rendered_glyphs[i];
+      const auto& glyph = rendered_glyphs[i];
 
-      if ((pack_head_x + glyph.width) >= atlas_max_width) {
-         if ((pack_head_y += (std::exchange(max_row_height, 0) + 1)) >= atlas_max_height) {
-            log_and_terminate("Required font atlas is too big!"sv);
-         }
+      const auto placement =
+         packer.pack(glyph.width + glyph_padding, glyph.height + glyph_padding);
+
+      if (!placement) log_and_terminate("Required font atlas is too big!"sv);
+
+      placements[i] = *placement;
+   }
+
+   const std::uint32_t atlas_height = std::max(packer.height(), 1u);
+
+   if (atlas_height > atlas_max_height) {
+      log_and_terminate("Required font atlas is too big!"sv);
+   }
 
-         multiple_rows = true;
-         pack_head_x = 0;
+   Packed_atlas atlas{.width = atlas_width, .height = atlas_height};
+
+   atlas.data.resize(std::size_t{atlas_width} * atlas_height);
+
+   const float width = static_cast<float>(atlas_width);
+   const float height = static_cast<float>(atlas_height);
+
+   for (std::size_t i = 0; i < glyph_count; ++i) {
+      const auto& glyph = rendered_glyphs[i];
+      const auto [x, y] = placements[i];
+
+      for (std::uint32_t row = 0; row < glyph.height; ++row) {
+         std::memcpy(&atlas.data[(y + row) * std::size_t{atlas_width} + x],
+                     glyph.data.data() + (row * glyph.width), glyph.width);
       }
 
-      if (output) {
-         for (std::uint32_t y = 0; y < glyph.height; ++y) {
-            auto* const dest_row = &output->data[(pack_head_y + y) * output->pitch];
-            auto* const dest = dest_row + pack_head_x;
-            auto* const src = glyph.data.data() + (y * glyph.width);
+      atlas.locations[i] = {.left = (x + 0.5f) / width,
+                            .right = (x + glyph.width + 0.5f) / width,
+                            .top = (y + 0.5f) / height,
+                            .bottom = (y + glyph.height + 0.5f) / height};
+   }
+
+   return atlas;
+}
+
+auto fnv_1a_64(const std::span<const std::byte> bytes,
+               std::uint64_t hash = 14695981039346656037) noexcept -> std::uint64_t
+{
+   constexpr std::uint64_t fnv_prime = 1099511628211;
+
+   for (auto b : bytes) hash = (hash ^ static_cast<std::uint64_t>(b)) * fnv_prime;
+
+   return hash;
+}
+
+// Rasterized glyphs are cached on disk so changing DPI back and forth (moving
+// between monitors or changing resolution) does not have to go through
+// FreeType again. Files are named after the hash of the font file, the pixel
+// size and the hash of the glyph set.
+struct Glyph_cache_header {
+   std::uint32_t magic;
+   std::uint32_t version;
+   std::uint32_t glyph_count;
+   std::uint32_t data_size;
+};
+
+constexpr std::uint32_t glyph_cache_magic = 0x43475053; // "SPGC"
+constexpr std::uint32_t glyph_cache_version = 1;
+constexpr auto glyph_cache_extension = ".glyphs"sv;
+
+auto glyph_cache_directory() noexcept -> std::filesystem::path
+{
+   return user_config.developer.shader_cache_path.parent_path() / L".glyph_cache"sv;
+}
+
+auto glyph_set_hash() noexcept -> std::uint32_t
+{
+   return static_cast<std::uint32_t>(fnv_1a_64(std::as_bytes(std::span{game_glyphs})));
+}
+
+auto glyph_cache_path(const std::uint64_t font_hash, const std::uint32_t pixel_size) noexcept
+   -> std::filesystem::path
+{
+   return glyph_cache_directory() /
+          fmt::format("{:016x}-{}-{:08x}{}"sv, font_hash, pixel_size,
+                      glyph_set_hash(), glyph_cache_extension);
+}
+
+auto load_cached_glyphs(const std::filesystem::path& path) noexcept
+   -> std::optional<std::array<Rendered_glyph, glyph_count>>
+{
+   std::ifstream file{path, std::ios::binary};
+
+   if (!file) return std::nullopt;
+
+   Glyph_cache_header header{};
+   std::array<std::array<std::uint32_t, 2>, glyph_count> sizes{};
+
+   file.read(reinterpret_cast<char*>(&header), sizeof(header));
+   file.read(reinterpret_cast<char*>(sizes.data()), sizeof(sizes));
+
+   if (!file || header.magic != glyph_cache_magic ||
+       header.version != glyph_cache_version || header.glyph_count != glyph_count) {
+      return std::nullopt;
+   }
+
+   std::array<Rendered_glyph, glyph_count> glyphs;
+   std::uint64_t data_size = 0;
 
-            std::memcpy(dest, src, glyph.width);
+   for (std::size_t i = 0; i < glyph_count; ++i) {
+      glyphs[i].width = sizes[i][0];
+      glyphs[i].height = sizes[i][1];
+
+      data_size += std::uint64_t{glyphs[i].width} * glyphs[i].height;
+   }
+
+   if (data_size != header.data_size) return std::nullopt;
+
+   for (auto& glyph : glyphs) {
+      glyph.data.resize(std::size_t{glyph.width} * glyph.height);
+
+      file.read(reinterpret_cast<char*>(glyph.data.data()), glyph.data.size());
+   }
+
+   if (!file) return std::nullopt;
+
+   return glyphs;
+}
+
+void save_cached_glyphs(const std::filesystem::path& path,
+                        const std::array<Rendered_glyph, glyph_count>& glyphs) noexcept
+{
+   try {
+      std::filesystem::create_directories(path.parent_path());
+
+      const auto write_path = std::filesystem::path{path} += L".TEMP"sv;
+
+      {
+         std::ofstream file{write_path, std::ios::binary};
+
+         if (!file) {
+            log(Log_level::warning, "Failed to open glyph cache file "sv, write_path,
+                " for writing."sv);
+
+            return;
+         }
+
+         Glyph_cache_header header{.magic = glyph_cache_magic,
+                                   .version = glyph_cache_version,
+                                   .glyph_count = glyph_count};
+         std::array<std::array<std::uint32_t, 2>, glyph_count> sizes;
+
+         for (std::size_t i = 0; i < glyph_count; ++i) {
+            sizes[i] = {glyphs[i].width, glyphs[i].height};
+            header.data_size += static_cast<std::uint32_t>(glyphs[i].data.size());
          }
 
-         const float atlas_left = (pack_head_x + 0.5f) / output->width;
-         const float atlas_right = (pack_head_x + glyph.width + 0.5f) / output->width;
-         const float atlas_top = (pack_head_y + 0.5f) / output->height;
-         const float atlas_bottom =
-            (pack_head_y + glyph.height + 0.5f) / output->height;
+         file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+         file.write(reinterpret_cast<const char*>(sizes.data()), sizeof(sizes));
 
-         output->locations[i] = {.left = atlas_left,
-                                 .right = atlas_right,
-                                 .top = atlas_top,
-                                 .bottom = atlas_bottom};
+         for (const auto& glyph : glyphs) {
+            file.write(reinterpret_cast<const char*>(glyph.data.data()),
+                       glyph.data.size());
+         }
       }
 
-      pack_head_x += glyph.width + 1;
-      max_row_height = std::max(glyph.height, max_row_height);
+      std::filesystem::rename(write_path, path);
    }
-
-   if ((pack_head_y += max_row_height) >= atlas_max_height) {
-      log_and_terminate("Required font atlas is too big!"sv);
+   catch (std::exception& e) {
+      log(Log_level::warning, "Failed to save glyph cache file "sv, path,
+          ". reason: "sv, e.what());
    }
+}
+
+// Cache files are only kept for the current font.
+void remove_stale_glyph_cache_files(const std::uint64_t font_hash) noexcept
+{
+   const auto prefix =
+      std::filesystem::path{fmt::format("{:016x}-"sv, font_hash)}.wstring();
 
-   const std::uint32_t atlas_width =
-      multiple_rows ? atlas_max_width : (pack_head_x - 1);
-   const std::uint32_t atlas_height = pack_head_y;
+   std::error_code error;
 
-   return {atlas_width, atlas_height};
+   for (const auto& entry :
+        std::filesystem::directory_iterator{glyph_cache_directory(), error}) {
+      if (!entry.is_regular_file(error)) continue;
+      if (entry.path().extension() != glyph_cache_extension) continue;
+      if (entry.path().filename().wstring().starts_with(prefix)) continue;
+
+      std::filesystem::remove(entry.path(), error);
+   }
 }
 
 }
@@ -151,6 +432,7 @@ struct Freetype_state {
    }
 
    std::vector<FT_Byte> font_data;
+   std::uint64_t font_hash = fnv_1a_64(std::as_bytes(std::span{font_data}));
    Freetype_ptr<FT_Library, FT_Done_FreeType> library = make_freetype_library();
    std::array<Freetype_ptr<FT_Face, FT_Done_Face>, atlas_count> faces;
 };
@@ -160,6 +442,8 @@ Font_atlas_builder::Font_atlas_builder(Com_ptr<ID3D11Device5> device) noexcept
 {
    _freetype_state = std::make_unique<Freetype_state>(load_font_data(
       windows_fonts_folder() / user_config.developer.scalable_font_name));
+
+   remove_stale_glyph_cache_files(_freetype_state->font_hash);
 }
 
 Font_atlas_builder::~Font_atlas_builder()
@@ -218,39 +502,55 @@ void Font_atlas_builder::build_atlases(const std::uint32_t dpi) noexcept
 void Font_atlas_builder::build_atlas(const std::size_t atlas_index,
                                      const std::uint32_t dpi) noexcept
 {
-   FT_Face face = _freetype_state->faces[atlas_index].get();
+   const auto start_time = std::chrono::steady_clock::now();
+   const std::uint32_t pixel_size = atlas_font_sizes[atlas_index] * dpi / base_dpi;
+   const auto cache_path = glyph_cache_path(_freetype_state->font_hash, pixel_size);
+
+   auto glyphs = load_cached_glyphs(cache_path);
+   const bool cache_hit = glyphs.has_value();
 
-   FT_Set_Pixel_Sizes(face, 0, atlas_font_sizes[atlas_index] * dpi / base_dpi);
+   if (!glyphs) {
+      FT_Face face = _freetype_state->faces[atlas_index].get();
 
-   std::array<Rendered_glyph, glyph_count> rendered_glyphs;
+      FT_Set_Pixel_Sizes(face, 0, pixel_size);
 
-   for (std::size_t i = 0; i < rendered_glyphs.size(); ++i) {
-      if (_cancel_build.load(std::memory_order_relaxed)) return;
+      auto& rendered_glyphs = glyphs.emplace();
 
-      auto glyph_index = FT_Get_Char_Index(face, game_glyphs[i]);
+      for (std::size_t i = 0; i < rendered_glyphs.size(); ++i) {
+         if (_cancel_build.load(std::memory_order_relaxed)) return;
 
-      freetype_checked_call(FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_BITMAP));
+         auto glyph_index = FT_Get_Char_Index(face, game_glyphs[i]);
 
-      freetype_checked_call(FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL));
+         freetype_checked_call(FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_BITMAP));
 
-      auto& bitmap = face->glyph->bitmap;
+         freetype_checked_call(FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL));
 
-      rendered_glyphs[i] = copy_freetype_bitmap(bitmap);
+         auto& bitmap = face->glyph->bitmap;
+
+         rendered_glyphs[i] = copy_freetype_bitmap(bitmap);
+      }
+
+      save_cached_glyphs(cache_path, rendered_glyphs);
    }
 
-   const auto [atlas_width, atlas_height] = pack_glyphs(rendered_glyphs, std::nullopt);
+   const auto [atlas_width, atlas_height, atlas_data, atlas_locations] =
+      pack_glyphs(*glyphs);
 
-   std::vector<std::byte> atlas_data;
-   atlas_data.resize(atlas_width * atlas_height);
+   std::uint64_t glyph_area = 0;
 
-   std::array<Glyph_location, glyph_count> atlas_locations;
+   for (const auto& glyph : *glyphs) {
+      glyph_area += std::uint64_t{glyph.width} * glyph.height;
+   }
 
-   pack_glyphs(rendered_glyphs,
-               Pack_target{.pitch = atlas_width,
-                           .data = atlas_data,
-                           .width = static_cast<float>(atlas_width),
-                           .height = static_cast<float>(atlas_height),
-                           .locations = atlas_locations});
+   log_fmt(Log_level::info,
+           "Built font atlas {} ({}px, glyphs {}) in {:.2f}ms. Size {}x{}, "
+           "{:.1f}% occupied."sv,
+           atlas_names[atlas_index], pixel_size, cache_hit ? "cached"sv : "rendered"sv,
+           std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() -
+                                                     start_time}
+              .count(),
+           atlas_width, atlas_height,
+           glyph_area * 100.0 / (std::uint64_t{atlas_width} * atlas_height));
 
    if (_cancel_build.load(std::memory_order_relaxed)) return;
 
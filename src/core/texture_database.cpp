@@ -3,6 +3,7 @@
 #include "../logger.hpp"
 #include "string_utilities.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 #include "../imgui/imgui.h"
@@ -11,6 +12,8 @@ namespace sp::core {
 
 namespace {
 
+constexpr std::string_view builtin_prefix = "_SP_BUILTIN_"sv;
+
 auto unknown_resource_name(ID3D11ShaderResourceView& srv) noexcept -> std::string
 {
    D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
@@ -76,14 +79,13 @@ auto Shader_resource_database::at_if(const std::string_view name) const noexcept
 auto Shader_resource_database::reverse_lookup(ID3D11ShaderResourceView* srv) noexcept
    -> Reverse_lookup_result
 {
-   auto it = std::find_if(_resources.cbegin(), _resources.cend(),
-                          [srv](const auto& res) { return res.first == srv; });
+   auto it = _srv_index.find(srv);
 
-   if (it == _resources.cend()) {
+   if (it == _srv_index.end()) {
       return {.found = false};
    }
 
-   return {.found = true, .name = it->second};
+   return {.found = true, .name = _resources[it->second.front()].name};
 }
 
 void Shader_resource_database::insert(Com_ptr<ID3D11ShaderResourceView> srv,
@@ -91,28 +93,66 @@ void Shader_resource_database::insert(Com_ptr<ID3D11ShaderResourceView> srv,
 {
    std::string name_str{name.empty() ? unknown_resource_name(*srv) : name};
 
-   if (auto it =
-          std::find_if(_resources.begin(), _resources.end(),
-                       [&](const auto& res) { return res.second == name_str; });
-       it != _resources.end()) {
-      it->first = std::move(srv);
+   if (auto it = _name_index.find(name_str); it != _name_index.end()) {
+      auto& resource = _resources[it->second];
+
+      remove_srv_slot(resource.srv.get(), it->second);
+      add_srv_slot(srv.get(), it->second);
+
+      resource.srv = std::move(srv);
+
+      if (_track_changes) _changed_names.push_back(resource.name);
 
       return;
    }
 
-   _resources.emplace_back(std::move(srv), std::move(name_str));
+   Slot_index slot;
+
+   if (!_free_slots.empty()) {
+      slot = _free_slots.back();
+      _free_slots.pop_back();
+   }
+   else {
+      slot = static_cast<Slot_index>(_resources.size());
+      _resources.emplace_back();
+   }
+
+   if (name_str.starts_with(builtin_prefix)) {
+      _builtin_index.emplace(name_str.substr(builtin_prefix.size()), slot);
+   }
+
+   _name_index.emplace(name_str, slot);
+   add_srv_slot(srv.get(), slot);
+
+   if (_track_changes) _changed_names.push_back(name_str);
+
+   _resources[slot] = {.srv = std::move(srv), .name = std::move(name_str)};
 }
 
 void Shader_resource_database::erase(ID3D11ShaderResourceView* srv) noexcept
 {
-   auto it = std::find_if(_resources.cbegin(), _resources.cend(),
-                          [srv](const auto& res) { return res.first == srv; });
+   auto it = _srv_index.find(srv);
 
-   if (it == _resources.cend()) {
+   if (it == _srv_index.end()) {
       log_and_terminate("Attempt to erase shader resource not present in database!"sv);
    }
 
-   _resources.erase(it);
+   const Slot_index slot = it->second.front();
+   auto& resource = _resources[slot];
+
+   remove_srv_slot(srv, slot);
+
+   if (resource.name.starts_with(builtin_prefix)) {
+      _builtin_index.erase(
+         std::string_view{resource.name}.substr(builtin_prefix.size()));
+   }
+
+   _name_index.erase(resource.name);
+
+   if (_track_changes) _changed_names.push_back(std::move(resource.name));
+
+   resource = {};
+   _free_slots.push_back(slot);
 }
 
 auto Shader_resource_database::imgui_resource_picker() noexcept -> Imgui_pick_result
@@ -124,28 +164,29 @@ auto Shader_resource_database::imgui_resource_picker() noexcept -> Imgui_pick_re
    ImGui::BeginChild("Resource List", {400.f, 64.0f * 10.0f});
 
    for (const auto& res : _resources) {
-      if (!_imgui_filter.empty() && !contains(res.second, _imgui_filter))
-         continue;
+      if (!res.srv) continue;
+
+      if (!_imgui_filter.empty() && !contains(res.name, _imgui_filter)) continue;
 
-      auto* srv = res.first.get();
+      auto* srv = res.srv.get();
 
       D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
       srv->GetDesc(&desc);
 
       if (desc.ViewDimension == D3D11_SRV_DIMENSION_TEXTURE2D ||
           desc.ViewDimension == D3D11_SRV_DIMENSION_TEXTURE2DARRAY) {
-         if (ImGui::ImageButton(res.second.c_str(),
+         if (ImGui::ImageButton(res.name.c_str(),
                                 reinterpret_cast<ImTextureID>(srv), {64, 64})) {
-            result = {.srv = srv, .name = res.second};
+            result = {.srv = srv, .name = res.name};
             break;
          }
 
          ImGui::SameLine();
-         ImGui::Text(res.second.c_str());
+         ImGui::Text(res.name.c_str());
       }
       else {
-         if (ImGui::Button(res.second.c_str())) {
-            result = {.srv = srv, .name = res.second};
+         if (ImGui::Button(res.name.c_str())) {
+            result = {.srv = srv, .name = res.name};
             break;
          }
       }
@@ -156,15 +197,25 @@ auto Shader_resource_database::imgui_resource_picker() noexcept -> Imgui_pick_re
    return result;
 }
 
+void Shader_resource_database::track_changes() noexcept
+{
+   _track_changes = true;
+}
+
+auto Shader_resource_database::take_changed_names() noexcept
+   -> std::vector<std::string>
+{
+   return std::exchange(_changed_names, {});
+}
+
 auto Shader_resource_database::lookup(const std::string_view name) const noexcept
    -> ID3D11ShaderResourceView*
 {
    if (name.front() == '$') return builtin_lookup(name);
 
-   auto it = std::find_if(_resources.cbegin(), _resources.cend(),
-                          [name](const auto& res) { return res.second == name; });
+   auto it = _name_index.find(name);
 
-   return (it != _resources.cend()) ? it->first.get() : nullptr;
+   return (it != _name_index.end()) ? _resources[it->second].srv.get() : nullptr;
 }
 
 auto Shader_resource_database::builtin_lookup(const std::string_view name) const noexcept
@@ -172,11 +223,28 @@ auto Shader_resource_database::builtin_lookup(const std::string_view name) const
 {
    Expects(!name.empty());
 
-   using namespace std::literals;
+   auto it = _builtin_index.find(name.substr(1));
+
+   return (it != _builtin_index.end()) ? _resources[it->second].srv.get() : nullptr;
+}
+
+void Shader_resource_database::add_srv_slot(ID3D11ShaderResourceView* srv,
+                                            const Slot_index slot) noexcept
+{
+   _srv_index[srv].push_back(slot);
+}
+
+void Shader_resource_database::remove_srv_slot(ID3D11ShaderResourceView* srv,
+                                               const Slot_index slot) noexcept
+{
+   auto it = _srv_index.find(srv);
+
+   if (it == _srv_index.end()) return;
+
+   auto& slots = it->second;
 
-   auto builtin_name = "_SP_BUILTIN_"s;
-   builtin_name.append(name.cbegin() + 1, name.cend());
+   slots.erase(std::find(slots.begin(), slots.end(), slot));
 
-   return lookup(builtin_name);
+   if (slots.empty()) _srv_index.erase(it);
 }
 }
@@ -2,11 +2,14 @@
 
 #include "com_ptr.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/inlined_vector.h>
 #include <gsl/gsl>
 
 #include <d3d11_1.h>
@@ -37,19 +40,53 @@ public:
 
    auto imgui_resource_picker() noexcept -> Imgui_pick_result;
 
+   //! Start recording the names of resources inserted, replaced or erased for
+   //! take_changed_names. Off by default so databases nothing takes the
+   //! changes from don't collect them.
+   void track_changes() noexcept;
+
+   //! Get the names of resources inserted, replaced or erased since the last
+   //! call. Always empty unless track_changes has been called.
+   auto take_changed_names() noexcept -> std::vector<std::string>;
+
 private:
+   struct Resource {
+      Com_ptr<ID3D11ShaderResourceView> srv;
+      std::string name;
+   };
+
+   using Slot_index = std::uint32_t;
+
    auto lookup(const std::string_view name) const noexcept
       -> ID3D11ShaderResourceView*;
 
    auto builtin_lookup(const std::string_view name) const noexcept
       -> ID3D11ShaderResourceView*;
 
-   std::vector<std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>> _resources = [] {
-      std::vector<std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>> res;
+   void add_srv_slot(ID3D11ShaderResourceView* srv, const Slot_index slot) noexcept;
+
+   void remove_srv_slot(ID3D11ShaderResourceView* srv, const Slot_index slot) noexcept;
+
+   // Resources live in stable slots so the indices below never need fixing
+   // up. Erased slots are left empty (null srv) and reused by later inserts.
+   std::vector<Resource> _resources = [] {
+      std::vector<Resource> res;
       res.reserve(1024);
 
       return res;
    }();
+   std::vector<Slot_index> _free_slots;
+   std::vector<std::string> _changed_names;
+   bool _track_changes = false;
+
+   absl::flat_hash_map<std::string, Slot_index> _name_index;
+   // Builtins ("_SP_BUILTIN_<name>") indexed by <name> so "$<name>" lookups
+   // don't need to build the full name.
+   absl::flat_hash_map<std::string, Slot_index> _builtin_index;
+   // The same SRV may be registered under multiple names.
+   absl::flat_hash_map<ID3D11ShaderResourceView*, absl::InlinedVector<Slot_index, 1>>
+      _srv_index;
+
    std::string _imgui_filter;
 };
 }
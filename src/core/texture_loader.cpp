@@ -10,7 +10,7 @@ auto load_texture_lvl(const std::filesystem::path lvl_path,
                       ID3D11Device1& device) noexcept -> Shader_resource_database
 {
    try {
-      win32::Memeory_mapped_file file{lvl_path};
+      Memory_mapped_file file{lvl_path};
       ucfb::Reader reader{file.bytes()};
       Shader_resource_database database;
 
@@ -0,0 +1,230 @@
+
+#include "texture_streamer.hpp"
+#include "../logger.hpp"
+#include "patch_texture_io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+
+#include <absl/container/inlined_vector.h>
+
+namespace sp::core {
+
+namespace {
+
+// Largest dimension of the placeholder handed back by Texture_streamer::stream.
+// Textures that are already this small are not streamed.
+constexpr std::uint32_t placeholder_max_size = 64;
+
+// Texture creation is mostly the driver copying data so a couple of threads is
+// plenty.
+constexpr std::size_t worker_count = 2;
+
+auto placeholder_skip_mips(const Texture_info& info) noexcept -> std::uint32_t
+{
+   const auto largest_dimension = std::max({info.width, info.height, info.depth});
+
+   std::uint32_t skip_mips = 0;
+
+   // Stops at the first level that can't be skipped to (a block compressed
+   // texture whose mip isn't a whole number of blocks) so that every stage
+   // between the placeholder and the full texture can be created.
+   while ((largest_dimension >> skip_mips) > placeholder_max_size &&
+          can_skip_mips(info, skip_mips + 1)) {
+      skip_mips += 1;
+   }
+
+   return skip_mips;
+}
+
+}
+
+struct Texture_streamer::Job {
+   std::string name;
+   std::vector<std::byte> data;
+   Patch_texture texture;
+
+   // Mips to skip for each texture created by the workers, least detailed first.
+   absl::InlinedVector<std::uint32_t, 2> stages;
+
+   // Only touched by the thread calling update_srv_database and release.
+   Com_ptr<ID3D11ShaderResourceView> current;
+
+   // Jobs are keyed by the placeholder's address, holding a reference to it
+   // stops the address being reused by another SRV while the job exists.
+   Com_ptr<ID3D11ShaderResourceView> placeholder;
+   bool complete = false;
+
+   std::atomic_bool cancelled = false;
+};
+
+Texture_streamer::Texture_streamer(Com_ptr<ID3D11Device5> device) noexcept
+   : _device{std::move(device)}
+{
+   _threads.reserve(worker_count);
+
+   for (auto i = 0u; i < worker_count; ++i) {
+      _threads.emplace_back([this](std::stop_token stop) { run(stop); });
+   }
+}
+
+Texture_streamer::~Texture_streamer()
+{
+   std::scoped_lock lock{_mutex};
+
+   for (auto& job : _queue) job->cancelled = true;
+   for (auto& [placeholder, job] : _jobs) job->cancelled = true;
+
+   _queue.clear();
+}
+
+auto Texture_streamer::stream(const std::span<const std::byte> texture_data)
+   -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>
+{
+   auto job = std::make_shared<Job>();
+
+   job->data.assign(texture_data.begin(), texture_data.end());
+   job->texture = parse_patch_texture(ucfb::Reader_strict<"sptx"_mn>{job->data});
+   job->name = job->texture.name;
+
+   const auto skip_mips = placeholder_skip_mips(job->texture.info);
+
+   if (skip_mips == 0) {
+      return {create_patch_texture(*_device, job->texture), std::move(job->name)};
+   }
+
+   auto placeholder = create_patch_texture(*_device, job->texture, skip_mips);
+
+   if (skip_mips > 1) job->stages.push_back(1);
+
+   job->stages.push_back(0);
+   job->current = placeholder;
+   job->placeholder = placeholder;
+
+   _jobs.emplace(placeholder.get(), job);
+
+   {
+      std::scoped_lock lock{_mutex};
+
+      _queue.push_back(job);
+   }
+
+   _queue_changed.notify_one();
+
+   return {std::move(placeholder), job->name};
+}
+
+void Texture_streamer::update_srv_database(Shader_resource_database& database) noexcept
+{
+   std::vector<Finished_stage> finished;
+
+   {
+      std::scoped_lock lock{_mutex};
+
+      if (_finished.empty()) return;
+
+      finished.swap(_finished);
+   }
+
+   for (auto& stage : finished) {
+      auto& job = *stage.job;
+
+      if (job.cancelled) continue;
+
+      if (stage.last) {
+         job.complete = true;
+         job.texture = {};
+         job.data = {};
+      }
+
+      if (!stage.srv) continue;
+
+      // Something else has taken the texture's name since it was queued,
+      // leave it be and stop streaming.
+      if (database.at_if(job.name) != job.current) {
+         job.cancelled = true;
+
+         continue;
+      }
+
+      job.current = stage.srv;
+
+      database.insert(std::move(stage.srv), job.name);
+   }
+}
+
+auto Texture_streamer::release(ID3D11ShaderResourceView* placeholder) noexcept
+   -> Com_ptr<ID3D11ShaderResourceView>
+{
+   auto it = _jobs.find(placeholder);
+
+   if (it == _jobs.end()) return nullptr;
+
+   auto job = std::move(it->second);
+
+   _jobs.erase(it);
+
+   job->cancelled = true;
+   job->placeholder = nullptr;
+
+   // Moved out before the job goes away, the job can hold the only reference
+   // to it once the texture has been replaced in the database.
+   return std::move(job->current);
+}
+
+auto Texture_streamer::pending() const noexcept -> std::size_t
+{
+   return std::count_if(_jobs.begin(), _jobs.end(), [](const auto& placeholder_job) {
+      return !placeholder_job.second->complete && !placeholder_job.second->cancelled;
+   });
+}
+
+void Texture_streamer::run(std::stop_token stop) noexcept
+{
+   std::unique_lock lock{_mutex};
+
+   while (true) {
+      if (!_queue_changed.wait(lock, stop, [this] { return !_queue.empty(); })) {
+         return;
+      }
+
+      auto job = std::move(_queue.front());
+      _queue.pop_front();
+
+      lock.unlock();
+
+      load(job);
+
+      lock.lock();
+   }
+}
+
+void Texture_streamer::load(const std::shared_ptr<Job>& job) noexcept
+{
+   for (std::size_t i = 0; i < job->stages.size(); ++i) {
+      if (job->cancelled.load(std::memory_order_relaxed)) return;
+
+      const bool last = (i + 1) == job->stages.size();
+
+      try {
+         auto srv = create_patch_texture(*_device, job->texture, job->stages[i]);
+
+         std::scoped_lock lock{_mutex};
+
+         _finished.push_back({.job = job, .srv = std::move(srv), .last = last});
+      }
+      catch (std::exception& e) {
+         log(Log_level::error, "Failed to stream texture "sv, std::quoted(job->name),
+             "! reason: "sv, e.what());
+
+         std::scoped_lock lock{_mutex};
+
+         _finished.push_back({.job = job, .srv = nullptr, .last = true});
+
+         return;
+      }
+   }
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "com_ptr.hpp"
+#include "texture_database.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <d3d11_4.h>
+
+namespace sp::core {
+
+//! \brief Loads patch textures in the background.
+//!
+//! A texture built from only the smallest mips of a patch texture is returned
+//! straight away to act as a placeholder. Worker threads then create the
+//! texture without its most detailed mip and finally the complete texture,
+//! each is swapped into the resource database by update_srv_database as it
+//! becomes ready.
+class Texture_streamer {
+public:
+   explicit Texture_streamer(Com_ptr<ID3D11Device5> device) noexcept;
+
+   ~Texture_streamer();
+
+   Texture_streamer(const Texture_streamer&) = delete;
+   Texture_streamer& operator=(const Texture_streamer&) = delete;
+
+   Texture_streamer(Texture_streamer&&) = delete;
+   Texture_streamer& operator=(Texture_streamer&&) = delete;
+
+   //! Start loading a patch texture. Returns the texture to register under the
+   //! returned name now, which is the complete texture when it is small enough
+   //! to not be worth streaming. The texture's data is copied. Throws on
+   //! malformed textures.
+   auto stream(const std::span<const std::byte> texture_data)
+      -> std::pair<Com_ptr<ID3D11ShaderResourceView>, std::string>;
+
+   //! Swap textures that have finished loading into the database. Must be
+   //! called from the thread that owns the database.
+   void update_srv_database(Shader_resource_database& database) noexcept;
+
+   //! Stop streaming the texture that `placeholder` was returned for. Returns
+   //! the SRV that currently represents the texture in the database, or null
+   //! for textures that were not streamed.
+   auto release(ID3D11ShaderResourceView* placeholder) noexcept
+      -> Com_ptr<ID3D11ShaderResourceView>;
+
+   //! The number of textures still loading.
+   auto pending() const noexcept -> std::size_t;
+
+private:
+   struct Job;
+
+   struct Finished_stage {
+      std::shared_ptr<Job> job;
+      Com_ptr<ID3D11ShaderResourceView> srv;
+      bool last = false;
+   };
+
+   void run(std::stop_token stop) noexcept;
+
+   void load(const std::shared_ptr<Job>& job) noexcept;
+
+   Com_ptr<ID3D11Device5> _device;
+
+   absl::flat_hash_map<ID3D11ShaderResourceView*, std::shared_ptr<Job>> _jobs;
+
+   mutable std::mutex _mutex;
+   std::condition_variable_any _queue_changed;
+   std::deque<std::shared_ptr<Job>> _queue;
+   std::vector<Finished_stage> _finished;
+
+   // Declared last so the threads are joined before anything they use is destroyed.
+   std::vector<std::jthread> _threads;
+};
+
+}
@@ -4,7 +4,7 @@
 #include "../logger.hpp"
 #include "debug_trace.hpp"
 #include "resource.hpp"
-#include "upload_scratch_buffer.hpp"
+#include "upload_arena.hpp"
 
 #include <type_traits>
 #include <utility>
@@ -153,7 +153,7 @@ public:
 
       _lock_offset = lock_offset;
       _lock_size = lock_size;
-      _lock_data = upload_scratch_buffer.lock(_size - lock_offset);
+      _lock_data = upload_arena.allocate(_size - lock_offset);
 
       *data = _lock_data;
 
@@ -168,11 +168,12 @@ public:
          log_and_terminate("Unexpected buffer unlock!");
       }
 
+      auto* const lock_data = std::exchange(_lock_data, nullptr);
+
       _shader_patch.update_ia_buffer(*_buffer, std::exchange(_lock_offset, 0),
-                                     std::exchange(_lock_size, 0),
-                                     std::exchange(_lock_data, nullptr));
+                                     std::exchange(_lock_size, 0), lock_data);
 
-      upload_scratch_buffer.unlock();
+      upload_arena.deallocate(lock_data);
 
       return S_OK;
    }
@@ -1,5 +1,6 @@
 
 #include "device.hpp"
+#include "../effects/cpu_profiler.hpp"
 #include "../game_support/memory_hacks.hpp"
 #include "../user_config.hpp"
 #include "../window_helpers.hpp"
@@ -1478,6 +1479,10 @@ auto Device::create_vertex_declaration(const D3DVERTEXELEMENT9* const vertex_ele
 
 void Device::draw_common() noexcept
 {
+   static const auto profile_section =
+      effects::cpu_profiler().section("Device::draw_common"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
    if (_fixed_func_active) {
       _texture_stage_manager.update(_shader_patch,
                                     _render_state_manager.texture_factor(), _viewport);
@@ -1,7 +1,7 @@
 
 #include "format_patcher.hpp"
 #include "../logger.hpp"
-#include "upload_scratch_buffer.hpp"
+#include "upload_arena.hpp"
 #include "utility.hpp"
 
 #include <array>
@@ -16,7 +16,7 @@ namespace sp::d3d9 {
 
 namespace {
 
-Upload_scratch_buffer patchup_scratch_buffer{524288u, 524288u};
+Upload_arena patchup_arena{524288u, 524288u};
 
 class Format_patcher_l8 final : public Format_patcher {
 public:
@@ -28,7 +28,7 @@ public:
       Expects(format == DXGI_FORMAT_R8_UNORM);
 
       auto patched_texture =
-         std::make_unique<Upload_texture>(patchup_scratch_buffer,
+         std::make_unique<Upload_texture>(patchup_arena,
                                           DXGI_FORMAT_R8G8B8A8_UNORM, width,
                                           height, 1, mip_levels, array_size);
 
@@ -54,7 +54,7 @@ public:
       _dynamic_height = glm::max(height >> mip_level, 1u);
 
       _dynamic_patch_texture =
-         std::make_unique<Upload_texture>(patchup_scratch_buffer, format,
+         std::make_unique<Upload_texture>(patchup_arena, format,
                                           _dynamic_width, _dynamic_height, 1, 1, 1);
 
       return _dynamic_patch_texture->subresource(0, 0);
@@ -115,7 +115,7 @@ public:
       Expects(format == DXGI_FORMAT_R8G8_UNORM);
 
       auto patched_texture =
-         std::make_unique<Upload_texture>(patchup_scratch_buffer,
+         std::make_unique<Upload_texture>(patchup_arena,
                                           DXGI_FORMAT_R8G8B8A8_UNORM, width,
                                           height, 1, mip_levels, array_size);
 
@@ -141,7 +141,7 @@ public:
       _dynamic_height = glm::max(height >> mip_level, 1u);
 
       _dynamic_patch_texture =
-         std::make_unique<Upload_texture>(patchup_scratch_buffer, format,
+         std::make_unique<Upload_texture>(patchup_arena, format,
                                           _dynamic_width, _dynamic_height, 1, 1, 1);
 
       return _dynamic_patch_texture->subresource(0, 0);
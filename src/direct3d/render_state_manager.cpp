@@ -3,10 +3,191 @@
 #include "helpers.hpp"
 #include "utility.hpp"
 
-#include <algorithm>
+#include <array>
+#include <cstddef>
 
 namespace sp::d3d9 {
 
+namespace {
+
+// D3D9 -> D3D11 enum translations. The switches below are the reference
+// conversions, tables indexed by the (bitfield) D3D9 value are generated from
+// them at compile time and used for the actual lookups.
+
+constexpr auto map_blend_value(const unsigned int d3d9_blend) noexcept -> D3D11_BLEND
+{
+   switch (d3d9_blend) {
+   case D3DBLEND_ZERO:
+      return D3D11_BLEND_ZERO;
+   case D3DBLEND_ONE:
+      return D3D11_BLEND_ONE;
+   case D3DBLEND_SRCCOLOR:
+      return D3D11_BLEND_SRC_COLOR;
+   case D3DBLEND_INVSRCCOLOR:
+      return D3D11_BLEND_INV_SRC_COLOR;
+   case D3DBLEND_SRCALPHA:
+      return D3D11_BLEND_SRC_ALPHA;
+   case D3DBLEND_INVSRCALPHA:
+      return D3D11_BLEND_INV_SRC_ALPHA;
+   case D3DBLEND_DESTALPHA:
+      return D3D11_BLEND_DEST_ALPHA;
+   case D3DBLEND_INVDESTALPHA:
+      return D3D11_BLEND_INV_DEST_ALPHA;
+   case D3DBLEND_DESTCOLOR:
+      return D3D11_BLEND_DEST_COLOR;
+   case D3DBLEND_INVDESTCOLOR:
+      return D3D11_BLEND_INV_DEST_COLOR;
+   case D3DBLEND_SRCALPHASAT:
+      return D3D11_BLEND_SRC_ALPHA_SAT;
+   case D3DBLEND_BLENDFACTOR:
+      return D3D11_BLEND_BLEND_FACTOR;
+   case D3DBLEND_INVBLENDFACTOR:
+      return D3D11_BLEND_INV_BLEND_FACTOR;
+   default:
+      return D3D11_BLEND_ZERO;
+   }
+}
+
+constexpr auto map_alpha_blend_value(const unsigned int d3d9_blend) noexcept
+   -> D3D11_BLEND
+{
+   switch (d3d9_blend) {
+   case D3DBLEND_ZERO:
+      return D3D11_BLEND_ZERO;
+   case D3DBLEND_ONE:
+      return D3D11_BLEND_ONE;
+   case D3DBLEND_SRCCOLOR:
+   case D3DBLEND_SRCALPHA:
+      return D3D11_BLEND_SRC_ALPHA;
+   case D3DBLEND_INVSRCCOLOR:
+   case D3DBLEND_INVSRCALPHA:
+      return D3D11_BLEND_INV_SRC_ALPHA;
+   case D3DBLEND_DESTALPHA:
+   case D3DBLEND_DESTCOLOR:
+      return D3D11_BLEND_DEST_ALPHA;
+   case D3DBLEND_INVDESTALPHA:
+   case D3DBLEND_INVDESTCOLOR:
+      return D3D11_BLEND_INV_DEST_ALPHA;
+   case D3DBLEND_SRCALPHASAT:
+      return D3D11_BLEND_SRC_ALPHA_SAT;
+   case D3DBLEND_BLENDFACTOR:
+      return D3D11_BLEND_BLEND_FACTOR;
+   case D3DBLEND_INVBLENDFACTOR:
+      return D3D11_BLEND_INV_BLEND_FACTOR;
+   default:
+      return D3D11_BLEND_ZERO;
+   }
+}
+
+constexpr auto map_blendop_value(const unsigned int d3d9_blendop) noexcept
+   -> D3D11_BLEND_OP
+{
+   switch (d3d9_blendop) {
+   case D3DBLENDOP_ADD:
+      return D3D11_BLEND_OP_ADD;
+   case D3DBLENDOP_SUBTRACT:
+      return D3D11_BLEND_OP_SUBTRACT;
+   case D3DBLENDOP_REVSUBTRACT:
+      return D3D11_BLEND_OP_REV_SUBTRACT;
+   case D3DBLENDOP_MIN:
+      return D3D11_BLEND_OP_MIN;
+   case D3DBLENDOP_MAX:
+      return D3D11_BLEND_OP_MAX;
+   default:
+      return D3D11_BLEND_OP_ADD;
+   }
+}
+
+constexpr auto map_cmp_func_value(const unsigned int func) noexcept
+   -> D3D11_COMPARISON_FUNC
+{
+   switch (func) {
+   case D3DCMP_NEVER:
+      return D3D11_COMPARISON_NEVER;
+   case D3DCMP_LESS:
+      return D3D11_COMPARISON_LESS;
+   case D3DCMP_EQUAL:
+      return D3D11_COMPARISON_EQUAL;
+   case D3DCMP_LESSEQUAL:
+      return D3D11_COMPARISON_LESS_EQUAL;
+   case D3DCMP_GREATER:
+      return D3D11_COMPARISON_GREATER;
+   case D3DCMP_NOTEQUAL:
+      return D3D11_COMPARISON_NOT_EQUAL;
+   case D3DCMP_GREATEREQUAL:
+      return D3D11_COMPARISON_GREATER_EQUAL;
+   case D3DCMP_ALWAYS:
+      return D3D11_COMPARISON_ALWAYS;
+   default:
+      return D3D11_COMPARISON_ALWAYS;
+   }
+}
+
+constexpr auto map_stencil_op_value(const unsigned int op) noexcept -> D3D11_STENCIL_OP
+{
+   switch (op) {
+   case D3DSTENCILOP_KEEP:
+      return D3D11_STENCIL_OP_KEEP;
+   case D3DSTENCILOP_ZERO:
+      return D3D11_STENCIL_OP_ZERO;
+   case D3DSTENCILOP_REPLACE:
+      return D3D11_STENCIL_OP_REPLACE;
+   case D3DSTENCILOP_INCRSAT:
+      return D3D11_STENCIL_OP_INCR_SAT;
+   case D3DSTENCILOP_DECRSAT:
+      return D3D11_STENCIL_OP_DECR_SAT;
+   case D3DSTENCILOP_INVERT:
+      return D3D11_STENCIL_OP_INVERT;
+   case D3DSTENCILOP_INCR:
+      return D3D11_STENCIL_OP_INCR;
+   case D3DSTENCILOP_DECR:
+      return D3D11_STENCIL_OP_DECR;
+   default:
+      return D3D11_STENCIL_OP_KEEP;
+   }
+}
+
+constexpr auto map_cull_mode(const unsigned int mode) noexcept -> D3D11_CULL_MODE
+{
+   switch (mode) {
+   case D3DCULL_NONE:
+      return D3D11_CULL_NONE;
+   case D3DCULL_CW:
+      return D3D11_CULL_FRONT;
+   case D3DCULL_CCW:
+      return D3D11_CULL_BACK;
+   default:
+      return D3D11_CULL_NONE;
+   }
+}
+
+template<std::size_t bits, typename Func>
+consteval auto make_translation_table(Func func) noexcept
+{
+   std::array<decltype(func(0u)), std::size_t{1} << bits> table{};
+
+   for (unsigned int i = 0; i < table.size(); ++i) table[i] = func(i);
+
+   return table;
+}
+
+// Tables are sized from the same constants as the bitfields that index them,
+// so every value a bitfield can hold has an entry.
+constexpr auto blend_table =
+   make_translation_table<Render_state_manager::blend_bits>(map_blend_value);
+constexpr auto alpha_blend_table =
+   make_translation_table<Render_state_manager::blend_bits>(map_alpha_blend_value);
+constexpr auto blendop_table =
+   make_translation_table<Render_state_manager::blendop_bits>(map_blendop_value);
+constexpr auto cmp_func_table =
+   make_translation_table<Render_state_manager::cmp_func_bits>(map_cmp_func_value);
+constexpr auto stencil_op_table =
+   make_translation_table<Render_state_manager::stencil_op_bits>(map_stencil_op_value);
+constexpr auto cull_mode_table =
+   make_translation_table<Render_state_manager::cull_mode_bits>(map_cull_mode);
+
+}
+
 void Render_state_manager::set(const D3DRENDERSTATETYPE state, const DWORD value) noexcept
 {
    switch (state) {
@@ -161,23 +342,11 @@ void Render_state_manager::update_blend_state(core::Shader_patch& shader_patch)
 {
    const bool additive_blending = _current_blend_state.dest_blend == D3DBLEND_ONE;
 
-   if (const auto blend_state =
-          std::find_if(_blend_states.cbegin(), _blend_states.cend(),
-                       [current_blend_state{_current_blend_state}](const auto& pair) {
-                          return (current_blend_state == pair.first);
-                       });
-       blend_state != _blend_states.cend()) {
-      shader_patch.set_blend_state(*blend_state->second, additive_blending);
-
-      return;
-   }
+   auto& blend_state = _blend_states[bit_cast<std::uint32_t>(_current_blend_state)];
 
-   ID3D11BlendState1& blend_state =
-      *_blend_states
-          .emplace_back(_current_blend_state, create_current_blend_state(shader_patch))
-          .second;
+   if (!blend_state) blend_state = create_current_blend_state(shader_patch);
 
-   shader_patch.set_blend_state(blend_state, additive_blending);
+   shader_patch.set_blend_state(*blend_state, additive_blending);
 }
 
 void Render_state_manager::update_depthstencil_state(core::Shader_patch& shader_patch) noexcept
@@ -189,52 +358,28 @@ void Render_state_manager::update_depthstencil_state(core::Shader_patch& shader_
        (_current_depthstencil_state.stencil_doublesided_enabled == 0));
    const bool readonly_depthstencil = depth_readonly & stencil_readonly;
 
-   if (const auto depthstencil_state =
-          std::find_if(_depthstencil_states.cbegin(), _depthstencil_states.cend(),
-                       [current_depthstencil_state{_current_depthstencil_state}](
-                          const auto& pair) {
-                          return (current_depthstencil_state == pair.first);
-                       });
-       depthstencil_state != _depthstencil_states.cend()) {
-      shader_patch.set_depthstencil_state(*depthstencil_state->second,
-                                          _current_depthstencil_state.stencil_ref,
-                                          readonly_depthstencil);
-
-      return;
-   }
+   auto& depthstencil_state =
+      _depthstencil_states[bit_cast<std::uint64_t>(_current_depthstencil_state)];
 
-   ID3D11DepthStencilState& depthstencil_state =
-      *_depthstencil_states
-          .emplace_back(_current_depthstencil_state,
-                        create_current_depthstencil_state(shader_patch))
-          .second;
+   if (!depthstencil_state) {
+      depthstencil_state = create_current_depthstencil_state(shader_patch);
+   }
 
-   shader_patch.set_depthstencil_state(depthstencil_state,
+   shader_patch.set_depthstencil_state(*depthstencil_state,
                                        _current_depthstencil_state.stencil_ref,
                                        readonly_depthstencil);
 }
 
 void Render_state_manager::update_rasterizer_state(core::Shader_patch& shader_patch) noexcept
 {
-   if (const auto rasterizer_state =
-          std::find_if(_rasterizer_states.cbegin(), _rasterizer_states.cend(),
-                       [current_rasterizer_state{_current_rasterizer_state}](
-                          const auto& pair) {
-                          return (current_rasterizer_state == pair.first);
-                       });
-       rasterizer_state != _rasterizer_states.cend()) {
-      shader_patch.set_rasterizer_state(*rasterizer_state->second);
-
-      return;
-   }
+   auto& rasterizer_state =
+      _rasterizer_states[bit_cast<std::uint32_t>(_current_rasterizer_state)];
 
-   ID3D11RasterizerState& rasterizer_state =
-      *_rasterizer_states
-          .emplace_back(_current_rasterizer_state,
-                        create_current_rasterizer_state(shader_patch))
-          .second;
+   if (!rasterizer_state) {
+      rasterizer_state = create_current_rasterizer_state(shader_patch);
+   }
 
-   shader_patch.set_rasterizer_state(rasterizer_state);
+   shader_patch.set_rasterizer_state(*rasterizer_state);
 }
 
 void Render_state_manager::update_fog_state(core::Shader_patch& shader_patch) noexcept
@@ -247,96 +392,14 @@ auto Render_state_manager::create_current_blend_state(core::Shader_patch& shader
 {
    D3D11_RENDER_TARGET_BLEND_DESC1 desc{true, false};
 
-   const auto map_blend_value = [](const unsigned int d3d9_blend) noexcept
-   {
-      switch (d3d9_blend) {
-      case D3DBLEND_ZERO:
-         return D3D11_BLEND_ZERO;
-      case D3DBLEND_ONE:
-         return D3D11_BLEND_ONE;
-      case D3DBLEND_SRCCOLOR:
-         return D3D11_BLEND_SRC_COLOR;
-      case D3DBLEND_INVSRCCOLOR:
-         return D3D11_BLEND_INV_SRC_COLOR;
-      case D3DBLEND_SRCALPHA:
-         return D3D11_BLEND_SRC_ALPHA;
-      case D3DBLEND_INVSRCALPHA:
-         return D3D11_BLEND_INV_SRC_ALPHA;
-      case D3DBLEND_DESTALPHA:
-         return D3D11_BLEND_DEST_ALPHA;
-      case D3DBLEND_INVDESTALPHA:
-         return D3D11_BLEND_INV_DEST_ALPHA;
-      case D3DBLEND_DESTCOLOR:
-         return D3D11_BLEND_DEST_COLOR;
-      case D3DBLEND_INVDESTCOLOR:
-         return D3D11_BLEND_INV_DEST_COLOR;
-      case D3DBLEND_SRCALPHASAT:
-         return D3D11_BLEND_SRC_ALPHA_SAT;
-      case D3DBLEND_BLENDFACTOR:
-         return D3D11_BLEND_BLEND_FACTOR;
-      case D3DBLEND_INVBLENDFACTOR:
-         return D3D11_BLEND_INV_BLEND_FACTOR;
-      default:
-         return D3D11_BLEND_ZERO;
-      }
-   };
-
-   const auto map_alpha_blend_value = [](const unsigned int d3d9_blend) noexcept
-   {
-      switch (d3d9_blend) {
-      case D3DBLEND_ZERO:
-         return D3D11_BLEND_ZERO;
-      case D3DBLEND_ONE:
-         return D3D11_BLEND_ONE;
-      case D3DBLEND_SRCCOLOR:
-      case D3DBLEND_SRCALPHA:
-         return D3D11_BLEND_SRC_ALPHA;
-      case D3DBLEND_INVSRCCOLOR:
-      case D3DBLEND_INVSRCALPHA:
-         return D3D11_BLEND_INV_SRC_ALPHA;
-      case D3DBLEND_DESTALPHA:
-      case D3DBLEND_DESTCOLOR:
-         return D3D11_BLEND_DEST_ALPHA;
-      case D3DBLEND_INVDESTALPHA:
-      case D3DBLEND_INVDESTCOLOR:
-         return D3D11_BLEND_INV_DEST_ALPHA;
-      case D3DBLEND_SRCALPHASAT:
-         return D3D11_BLEND_SRC_ALPHA_SAT;
-      case D3DBLEND_BLENDFACTOR:
-         return D3D11_BLEND_BLEND_FACTOR;
-      case D3DBLEND_INVBLENDFACTOR:
-         return D3D11_BLEND_INV_BLEND_FACTOR;
-      default:
-         return D3D11_BLEND_ZERO;
-      }
-   };
-
-   const auto map_blendop_value = [](const unsigned int d3d9_blendop) noexcept
-   {
-      switch (d3d9_blendop) {
-      case D3DBLENDOP_ADD:
-         return D3D11_BLEND_OP_ADD;
-      case D3DBLENDOP_SUBTRACT:
-         return D3D11_BLEND_OP_SUBTRACT;
-      case D3DBLENDOP_REVSUBTRACT:
-         return D3D11_BLEND_OP_REV_SUBTRACT;
-      case D3DBLENDOP_MIN:
-         return D3D11_BLEND_OP_MIN;
-      case D3DBLENDOP_MAX:
-         return D3D11_BLEND_OP_MAX;
-      default:
-         return D3D11_BLEND_OP_ADD;
-      }
-   };
-
    desc.BlendEnable = _current_blend_state.blend_enable;
 
    if (_current_blend_state.blend_enable) {
-      desc.SrcBlend = map_blend_value(_current_blend_state.src_blend);
-      desc.DestBlend = map_blend_value(_current_blend_state.dest_blend);
-      desc.BlendOp = map_blendop_value(_current_blend_state.blendop);
-      desc.SrcBlendAlpha = map_alpha_blend_value(_current_blend_state.src_blend);
-      desc.DestBlendAlpha = map_alpha_blend_value(_current_blend_state.dest_blend);
+      desc.SrcBlend = blend_table[_current_blend_state.src_blend];
+      desc.DestBlend = blend_table[_current_blend_state.dest_blend];
+      desc.BlendOp = blendop_table[_current_blend_state.blendop];
+      desc.SrcBlendAlpha = alpha_blend_table[_current_blend_state.src_blend];
+      desc.DestBlendAlpha = alpha_blend_table[_current_blend_state.dest_blend];
       desc.BlendOpAlpha = desc.BlendOp;
    }
    else {
@@ -359,82 +422,33 @@ auto Render_state_manager::create_current_depthstencil_state(core::Shader_patch&
 {
    D3D11_DEPTH_STENCIL_DESC desc{};
 
-   const auto map_cmp_func_value = [](const unsigned int func) noexcept->D3D11_COMPARISON_FUNC
-   {
-      switch (func) {
-      case D3DCMP_NEVER:
-         return D3D11_COMPARISON_NEVER;
-      case D3DCMP_LESS:
-         return D3D11_COMPARISON_LESS;
-      case D3DCMP_EQUAL:
-         return D3D11_COMPARISON_EQUAL;
-      case D3DCMP_LESSEQUAL:
-         return D3D11_COMPARISON_LESS_EQUAL;
-      case D3DCMP_GREATER:
-         return D3D11_COMPARISON_GREATER;
-      case D3DCMP_NOTEQUAL:
-         return D3D11_COMPARISON_NOT_EQUAL;
-      case D3DCMP_GREATEREQUAL:
-         return D3D11_COMPARISON_GREATER_EQUAL;
-      case D3DCMP_ALWAYS:
-         return D3D11_COMPARISON_ALWAYS;
-      default:
-         return D3D11_COMPARISON_ALWAYS;
-      }
-   };
-
-   const auto map_stencil_op_value = [](const unsigned int op) noexcept->D3D11_STENCIL_OP
-   {
-      switch (op) {
-      case D3DSTENCILOP_KEEP:
-         return D3D11_STENCIL_OP_KEEP;
-      case D3DSTENCILOP_ZERO:
-         return D3D11_STENCIL_OP_ZERO;
-      case D3DSTENCILOP_REPLACE:
-         return D3D11_STENCIL_OP_REPLACE;
-      case D3DSTENCILOP_INCRSAT:
-         return D3D11_STENCIL_OP_INCR_SAT;
-      case D3DSTENCILOP_DECRSAT:
-         return D3D11_STENCIL_OP_DECR_SAT;
-      case D3DSTENCILOP_INVERT:
-         return D3D11_STENCIL_OP_INVERT;
-      case D3DSTENCILOP_INCR:
-         return D3D11_STENCIL_OP_INCR;
-      case D3DSTENCILOP_DECR:
-         return D3D11_STENCIL_OP_DECR;
-      default:
-         return D3D11_STENCIL_OP_KEEP;
-      }
-   };
-
    desc.DepthEnable = _current_depthstencil_state.depth_enable;
    desc.DepthWriteMask = _current_depthstencil_state.depth_write_enable
                             ? D3D11_DEPTH_WRITE_MASK_ALL
                             : D3D11_DEPTH_WRITE_MASK_ZERO;
-   desc.DepthFunc = map_cmp_func_value(_current_depthstencil_state.depth_func);
+   desc.DepthFunc = cmp_func_table[_current_depthstencil_state.depth_func];
 
    desc.StencilEnable = _current_depthstencil_state.stencil_enabled;
    desc.StencilReadMask = _current_depthstencil_state.stencil_read_mask;
    desc.StencilWriteMask = _current_depthstencil_state.stencil_write_mask;
 
    desc.FrontFace.StencilFailOp =
-      map_stencil_op_value(_current_depthstencil_state.stencil_fail_op);
+      stencil_op_table[_current_depthstencil_state.stencil_fail_op];
    desc.FrontFace.StencilDepthFailOp =
-      map_stencil_op_value(_current_depthstencil_state.stencil_depth_fail_op);
+      stencil_op_table[_current_depthstencil_state.stencil_depth_fail_op];
    desc.FrontFace.StencilPassOp =
-      map_stencil_op_value(_current_depthstencil_state.stencil_pass_op);
-   desc.FrontFace.StencilFunc =
-      map_cmp_func_value(_current_depthstencil_state.stencil_func);
+      stencil_op_table[_current_depthstencil_state.stencil_pass_op];
+   desc.FrontFace.StencilFunc = cmp_func_table[_current_depthstencil_state.stencil_func];
 
    if (_current_depthstencil_state.stencil_doublesided_enabled) {
       desc.BackFace.StencilFailOp =
-         map_stencil_op_value(_current_depthstencil_state.stencil_ccw_fail_op);
+         stencil_op_table[_current_depthstencil_state.stencil_ccw_fail_op];
       desc.BackFace.StencilDepthFailOp =
-         map_stencil_op_value(_current_depthstencil_state.stencil_ccw_depth_fail_op);
+         stencil_op_table[_current_depthstencil_state.stencil_ccw_depth_fail_op];
       desc.BackFace.StencilPassOp =
-         map_stencil_op_value(_current_depthstencil_state.stencil_ccw_pass_op);
+         stencil_op_table[_current_depthstencil_state.stencil_ccw_pass_op];
       desc.BackFace.StencilFunc =
-         map_cmp_func_value(_current_depthstencil_state.stencil_ccw_func);
+         cmp_func_table[_current_depthstencil_state.stencil_ccw_func];
    }
    else {
       desc.BackFace = desc.FrontFace;
@@ -448,24 +462,10 @@ auto Render_state_manager::create_current_rasterizer_state(core::Shader_patch& s
 {
    D3D11_RASTERIZER_DESC desc{};
 
-   const auto map_cull_mode = [](const unsigned int mode) noexcept->D3D11_CULL_MODE
-   {
-      switch (mode) {
-      case D3DCULL_NONE:
-         return D3D11_CULL_NONE;
-      case D3DCULL_CW:
-         return D3D11_CULL_FRONT;
-      case D3DCULL_CCW:
-         return D3D11_CULL_BACK;
-      default:
-         return D3D11_CULL_NONE;
-      }
-   };
-
    desc.FillMode = _current_rasterizer_state.fill_mode == D3DFILL_WIREFRAME
                       ? D3D11_FILL_WIREFRAME
                       : D3D11_FILL_SOLID;
-   desc.CullMode = map_cull_mode(_current_rasterizer_state.cull_mode);
+   desc.CullMode = cull_mode_table[_current_rasterizer_state.cull_mode];
    desc.FrontCounterClockwise = false;
    desc.DepthBias = 0;
    desc.DepthBiasClamp = 0.0f;
@@ -478,31 +478,4 @@ auto Render_state_manager::create_current_rasterizer_state(core::Shader_patch& s
    return shader_patch.create_rasterizer_state(desc);
 }
 
-bool operator==(const Render_state_manager::Blend_state left,
-                const Render_state_manager::Blend_state right) noexcept
-{
-   static_assert(sizeof(Render_state_manager::Blend_state) <= sizeof(int));
-   static_assert(std::is_trivially_copyable_v<Render_state_manager::Blend_state>);
-
-   return bit_cast<std::int32_t>(left) == bit_cast<std::int32_t>(right);
-}
-
-bool operator==(const Render_state_manager::Depthstencil_state left,
-                const Render_state_manager::Depthstencil_state right) noexcept
-{
-   static_assert(sizeof(Render_state_manager::Blend_state) <= sizeof(int));
-   static_assert(std::is_trivially_copyable_v<Render_state_manager::Blend_state>);
-
-   return bit_cast<std::int64_t>(left) == bit_cast<std::int64_t>(right);
-}
-
-bool operator==(const Render_state_manager::Rasterizer_state left,
-                const Render_state_manager::Rasterizer_state right) noexcept
-{
-   static_assert(sizeof(Render_state_manager::Rasterizer_state) <= sizeof(int));
-   static_assert(std::is_trivially_copyable_v<Render_state_manager::Rasterizer_state>);
-
-   return bit_cast<std::int32_t>(left) == bit_cast<std::int32_t>(right);
-}
-
 }
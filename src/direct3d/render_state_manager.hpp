@@ -2,9 +2,10 @@
 
 #include "../core/shader_patch.hpp"
 
+#include <bit>
 #include <cstdint>
-#include <utility>
-#include <vector>
+
+#include <absl/container/flat_hash_map.h>
 
 #include <d3d9.h>
 
@@ -20,6 +21,20 @@ public:
 
    auto texture_factor() const noexcept -> DWORD;
 
+   //! Widths of the bitfields D3D9 enums are stored in. The translation tables
+   //! to D3D11 have an entry for every value each can hold.
+   constexpr static int blend_bits = 4;
+   constexpr static int blendop_bits = 3;
+   constexpr static int cmp_func_bits = 4;
+   constexpr static int stencil_op_bits = 4;
+   constexpr static int cull_mode_bits = 2;
+
+   static_assert(std::bit_width(unsigned{D3DBLEND_INVBLENDFACTOR}) <= blend_bits);
+   static_assert(std::bit_width(unsigned{D3DBLENDOP_MAX}) <= blendop_bits);
+   static_assert(std::bit_width(unsigned{D3DCMP_ALWAYS}) <= cmp_func_bits);
+   static_assert(std::bit_width(unsigned{D3DSTENCILOP_DECR}) <= stencil_op_bits);
+   static_assert(std::bit_width(unsigned{D3DCULL_CCW}) <= cull_mode_bits);
+
 private:
    void update_blend_state(core::Shader_patch& shader_patch) noexcept;
 
@@ -39,9 +54,9 @@ private:
       -> Com_ptr<ID3D11RasterizerState>;
 
    struct alignas(std::int32_t) Blend_state {
-      unsigned int src_blend : 4;
-      unsigned int dest_blend : 4;
-      unsigned int blendop : 2;
+      unsigned int src_blend : blend_bits;
+      unsigned int dest_blend : blend_bits;
+      unsigned int blendop : blendop_bits;
       unsigned int writemask : 4;
       unsigned int blend_enable : 1;
 
@@ -53,23 +68,21 @@ private:
 
    static_assert(sizeof(Blend_state) == sizeof(std::int32_t));
 
-   friend bool operator==(const Blend_state left, const Blend_state right) noexcept;
-
 #pragma pack(push, 1)
    struct alignas(std::int64_t) Depthstencil_state {
       unsigned int depth_enable : 1;
       unsigned int depth_write_enable : 1;
       unsigned int stencil_enabled : 1;
       unsigned int stencil_doublesided_enabled : 1;
-      unsigned int depth_func : 4;
-      unsigned int stencil_func : 4;
-      unsigned int stencil_ccw_func : 4;
-      unsigned int stencil_pass_op : 4;
-      unsigned int stencil_fail_op : 4;
-      unsigned int stencil_depth_fail_op : 4;
-      unsigned int stencil_ccw_pass_op : 4;
-      unsigned int stencil_ccw_fail_op : 4;
-      unsigned int stencil_ccw_depth_fail_op : 4;
+      unsigned int depth_func : cmp_func_bits;
+      unsigned int stencil_func : cmp_func_bits;
+      unsigned int stencil_ccw_func : cmp_func_bits;
+      unsigned int stencil_pass_op : stencil_op_bits;
+      unsigned int stencil_fail_op : stencil_op_bits;
+      unsigned int stencil_depth_fail_op : stencil_op_bits;
+      unsigned int stencil_ccw_pass_op : stencil_op_bits;
+      unsigned int stencil_ccw_fail_op : stencil_op_bits;
+      unsigned int stencil_ccw_depth_fail_op : stencil_op_bits;
       unsigned int stencil_read_mask : 8;
       unsigned int stencil_write_mask : 8;
       unsigned int stencil_ref : 8;
@@ -98,12 +111,9 @@ private:
 
    static_assert(sizeof(Depthstencil_state) == sizeof(std::int64_t));
 
-   friend bool operator==(const Depthstencil_state left,
-                          const Depthstencil_state right) noexcept;
-
    struct alignas(std::int32_t) Rasterizer_state {
       unsigned int fill_mode : 2;
-      unsigned int cull_mode : 2;
+      unsigned int cull_mode : cull_mode_bits;
 
       Rasterizer_state() noexcept
          : fill_mode{D3DFILL_SOLID}, cull_mode{D3DCULL_CCW}
@@ -113,9 +123,6 @@ private:
 
    static_assert(sizeof(Rasterizer_state) == sizeof(std::int32_t));
 
-   friend bool operator==(const Rasterizer_state left,
-                          const Rasterizer_state right) noexcept;
-
    struct Fog_state {
       D3DCOLOR color = 0x0;
       bool enable = false;
@@ -126,14 +133,16 @@ private:
    bool _rasterizer_state_dirty = true;
    bool _fog_state_dirty = true;
 
+   // State object caches are keyed by the packed bits of the state structs.
+
    Blend_state _current_blend_state;
-   std::vector<std::pair<Blend_state, Com_ptr<ID3D11BlendState1>>> _blend_states;
+   absl::flat_hash_map<std::uint32_t, Com_ptr<ID3D11BlendState1>> _blend_states;
 
    Depthstencil_state _current_depthstencil_state;
-   std::vector<std::pair<Depthstencil_state, Com_ptr<ID3D11DepthStencilState>>> _depthstencil_states;
+   absl::flat_hash_map<std::uint64_t, Com_ptr<ID3D11DepthStencilState>> _depthstencil_states;
 
    Rasterizer_state _current_rasterizer_state;
-   std::vector<std::pair<Rasterizer_state, Com_ptr<ID3D11RasterizerState>>> _rasterizer_states;
+   absl::flat_hash_map<std::uint32_t, Com_ptr<ID3D11RasterizerState>> _rasterizer_states;
 
    Fog_state _fog_state;
    DWORD _texture_factor = 0xffffffff;
@@ -151,7 +151,7 @@ HRESULT Texture2d_managed::LockRect(UINT level, D3DLOCKED_RECT* locked_rect,
 
    if (std::exchange(_first_lock, false)) {
       _upload_texture =
-         std::make_unique<Upload_texture>(upload_scratch_buffer, _format,
+         std::make_unique<Upload_texture>(upload_arena, _format,
                                           _width, _height, 1, _mip_levels, 1);
    }
    else if (!_upload_texture && !std::exchange(_dynamic_texture, true)) {
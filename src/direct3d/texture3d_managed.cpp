@@ -34,7 +34,7 @@ Texture3d_managed::Texture3d_managed(core::Shader_patch& shader_patch,
 {
    Expects(mip_levels != 0);
 
-   _upload_texture.emplace(upload_scratch_buffer, _format, _width, _height,
+   _upload_texture.emplace(upload_arena, _format, _width, _height,
                            _depth, _mip_levels, 1);
 }
 
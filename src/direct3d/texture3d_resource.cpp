@@ -1,7 +1,7 @@
 
 #include "texture3d_resource.hpp"
 #include "debug_trace.hpp"
-#include "upload_scratch_buffer.hpp"
+#include "upload_arena.hpp"
 #include "volume_resource.hpp"
 
 #include <span>
@@ -114,7 +114,7 @@ HRESULT Texture3d_resource::LockBox(UINT level, D3DLOCKED_BOX* locked_box,
       log_and_terminate("Unexpected volume texture lock call!");
    }
 
-   _lock_data = upload_scratch_buffer.lock(_resource_size);
+   _lock_data = upload_arena.allocate(_resource_size);
 
    locked_box->RowPitch = _width;
    locked_box->SlicePitch = _width * _height;
@@ -135,7 +135,7 @@ HRESULT Texture3d_resource::UnlockBox(UINT level) noexcept
 
    create_resource();
 
-   upload_scratch_buffer.unlock();
+   upload_arena.deallocate(std::exchange(_lock_data, nullptr));
 
    return S_OK;
 }
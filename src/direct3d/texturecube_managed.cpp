@@ -31,7 +31,7 @@ Texturecube_managed::Texturecube_managed(core::Shader_patch& shader_patch,
 {
    Expects(mip_levels != 0);
 
-   _upload_texture.emplace(upload_scratch_buffer, format, width, width, 1,
+   _upload_texture.emplace(upload_arena, format, width, width, 1,
                            mip_levels, 6);
 }
 
@@ -0,0 +1,216 @@
+
+#include "upload_arena.hpp"
+#include "../logger.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+
+namespace sp::d3d9 {
+
+Upload_arena upload_arena;
+
+Upload_arena::Upload_arena(const std::size_t min_capacity,
+                           const std::size_t starting_capacity) noexcept
+   : _min_capacity{min_capacity}
+{
+   resize(std::max(min_capacity, starting_capacity));
+
+   _stats.resizes = 0;
+}
+
+auto Upload_arena::allocate(const std::size_t size) noexcept -> std::byte*
+{
+   std::scoped_lock lock{_mutex};
+
+   const auto aligned_size = next_multiple_of<alignment>(std::max(size, std::size_t{1}));
+
+   std::byte* data = allocate_from_ring(aligned_size);
+
+   if (!data) data = allocate_overflow(aligned_size);
+
+   _stats.bytes_in_use += aligned_size;
+   _stats.high_water_bytes = std::max(_stats.high_water_bytes, _stats.bytes_in_use);
+   _stats.live_allocations += 1;
+   _stats.max_live_allocations =
+      std::max(_stats.max_live_allocations, _stats.live_allocations);
+   _stats.total_allocations += 1;
+
+   _demand = std::max(_demand, _stats.bytes_in_use);
+   _decay_peak = std::max(_decay_peak, _stats.bytes_in_use);
+
+   return data;
+}
+
+void Upload_arena::deallocate(std::byte* const data) noexcept
+{
+   std::scoped_lock lock{_mutex};
+
+   auto* const ring_begin = reinterpret_cast<std::byte*>(_memory.get());
+   std::size_t freed_size = 0;
+
+   if (data >= ring_begin && data < ring_begin + _capacity) {
+      const auto index =
+         _ring_index.find(static_cast<std::size_t>(data - ring_begin));
+
+      if (index == _ring_index.end()) {
+         log_and_terminate("Attempt to free upload arena memory that is not in use!"sv);
+      }
+
+      auto& slot = _ring_slots[index->second - _ring_front_sequence];
+
+      _ring_index.erase(index);
+
+      slot.freed = true;
+      freed_size = slot.size;
+
+      retire_freed_slots();
+   }
+   else {
+      const auto slot = _overflow_slots.find(data);
+
+      if (slot == _overflow_slots.end()) {
+         log_and_terminate("Attempt to free memory not owned by the upload arena!"sv);
+      }
+
+      freed_size = slot->second.size;
+
+      _overflow_slots.erase(slot);
+   }
+
+   _stats.bytes_in_use -= freed_size;
+   _stats.live_allocations -= 1;
+
+   if (_ring_slots.empty()) ring_emptied();
+}
+
+auto Upload_arena::stats() const noexcept -> Stats
+{
+   std::scoped_lock lock{_mutex};
+
+   return _stats;
+}
+
+auto Upload_arena::allocate_from_ring(const std::size_t size) noexcept -> std::byte*
+{
+   if (size > _capacity) return nullptr;
+
+   std::size_t offset = 0;
+
+   if (!_ring_slots.empty()) {
+      const std::size_t tail = _ring_slots.front().offset;
+      const std::size_t head = _ring_slots.back().offset + _ring_slots.back().size;
+
+      if (head > tail) {
+         if (_capacity - head >= size) {
+            offset = head;
+         }
+         else if (tail >= size) {
+            offset = 0;
+         }
+         else {
+            return nullptr;
+         }
+      }
+      else {
+         if (tail - head < size) return nullptr;
+
+         offset = head;
+      }
+   }
+
+   _ring_index.emplace(offset, _ring_front_sequence + _ring_slots.size());
+   _ring_slots.push_back({.offset = offset, .size = size});
+
+   return reinterpret_cast<std::byte*>(_memory.get()) + offset;
+}
+
+auto Upload_arena::allocate_overflow(const std::size_t size) noexcept -> std::byte*
+{
+   const auto block_count = next_multiple_of<sizeof(Block)>(size) / sizeof(Block);
+
+   std::unique_ptr<Block[]> memory{new (std::nothrow) Block[block_count]};
+
+   if (!memory) log_and_terminate("Failed to allocate memory for upload arena!"sv);
+
+   auto* const data = reinterpret_cast<std::byte*>(memory.get());
+
+   _overflow_slots.emplace(data, Overflow_slot{std::move(memory), size});
+
+   _stats.overflow_allocations += 1;
+
+   return data;
+}
+
+void Upload_arena::retire_freed_slots() noexcept
+{
+   while (!_ring_slots.empty() && _ring_slots.front().freed) {
+      _ring_slots.pop_front();
+      _ring_front_sequence += 1;
+   }
+
+   // Slots freed in reverse order (nested locks) give their space back to the
+   // head of the ring straight away.
+   while (!_ring_slots.empty() && _ring_slots.back().freed) {
+      _ring_slots.pop_back();
+   }
+}
+
+void Upload_arena::ring_emptied() noexcept
+{
+   _empty_count += 1;
+
+   // Grow to fit everything that was live at once since the ring was last
+   // empty, this is what stops repeated large locks from hitting the heap
+   // every time. Overflow allocations still live don't need to be freed first,
+   // they keep their own memory.
+   if (_demand > _capacity) {
+      log_debug("Growing upload arena from {} to {} bytes."sv, _capacity, _demand);
+
+      resize(_demand);
+   }
+   else if (_empty_count >= decay_period) {
+      const auto target = std::max(_min_capacity, _decay_peak);
+
+      if (_capacity > target) {
+         const auto new_capacity = std::max(target, _capacity / 2);
+
+         log_debug("Shrinking upload arena from {} to {} bytes."sv, _capacity,
+                   new_capacity);
+
+         resize(new_capacity);
+      }
+
+      _empty_count = 0;
+      _decay_peak = 0;
+   }
+
+   // Overflow allocations that are still live carry over into the next window.
+   _demand = _stats.bytes_in_use;
+}
+
+void Upload_arena::resize(const std::size_t new_capacity) noexcept
+{
+   Expects(_ring_slots.empty());
+
+   const auto block_count =
+      next_multiple_of<sizeof(Block)>(new_capacity) / sizeof(Block);
+   const auto block_capacity = block_count * sizeof(Block);
+
+   if (block_capacity == _capacity) return;
+
+   _memory = nullptr;
+   _capacity = 0;
+   _stats.capacity = 0;
+   _stats.resizes += 1;
+
+   if (block_count == 0) return;
+
+   _memory = std::unique_ptr<Block[]>{new (std::nothrow) Block[block_count]};
+   _capacity = block_capacity;
+   _stats.capacity = block_capacity;
+
+   if (!_memory)
+      log_and_terminate("Failed to allocate memory for upload arena!"sv);
+}
+
+}
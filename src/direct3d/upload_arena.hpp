@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <absl/container/flat_hash_map.h>
+#include <gsl/gsl>
+
+namespace sp::d3d9 {
+
+//! Staging memory for resource locks. Allocations are carved out of a
+//! persistent ring so several locks can be live at once. Requests that do
+//! not fit in the ring are served from the heap and the ring is grown to the
+//! observed demand the next time it is empty. Capacity above what has recently
+//! been used decays back towards the minimum size over time.
+class Upload_arena {
+public:
+   constexpr static std::size_t alignment = 256u;
+
+   struct Stats {
+      std::size_t capacity = 0;
+      std::size_t bytes_in_use = 0;
+      std::size_t high_water_bytes = 0;
+
+      std::size_t live_allocations = 0;
+      std::size_t max_live_allocations = 0;
+
+      std::size_t total_allocations = 0;
+      std::size_t overflow_allocations = 0;
+      std::size_t resizes = 0;
+   };
+
+   Upload_arena(const std::size_t min_capacity = 16777216u,
+                const std::size_t starting_capacity = 16777216u) noexcept;
+
+   ~Upload_arena() = default;
+
+   Upload_arena(const Upload_arena&) = delete;
+   Upload_arena& operator=(const Upload_arena&) = delete;
+
+   Upload_arena(Upload_arena&&) = delete;
+   Upload_arena& operator=(Upload_arena&&) = delete;
+
+   //! Allocate `size` bytes aligned to `alignment`. The memory stays valid
+   //! until passed to `deallocate`.
+   [[nodiscard]] auto allocate(const std::size_t size) noexcept -> std::byte*;
+
+   void deallocate(std::byte* const data) noexcept;
+
+   auto stats() const noexcept -> Stats;
+
+private:
+   struct alignas(alignment) Block {
+      std::byte bytes[65536];
+   };
+
+   struct Ring_slot {
+      std::size_t offset = 0;
+      std::size_t size = 0;
+      bool freed = false;
+   };
+
+   struct Overflow_slot {
+      std::unique_ptr<Block[]> memory;
+      std::size_t size = 0;
+   };
+
+   auto allocate_from_ring(const std::size_t size) noexcept -> std::byte*;
+
+   auto allocate_overflow(const std::size_t size) noexcept -> std::byte*;
+
+   void retire_freed_slots() noexcept;
+
+   void ring_emptied() noexcept;
+
+   void resize(const std::size_t new_capacity) noexcept;
+
+   // How many times the ring must empty before unused capacity is released.
+   constexpr static std::size_t decay_period = 64u;
+
+   mutable std::mutex _mutex;
+
+   std::unique_ptr<Block[]> _memory = nullptr;
+   std::size_t _capacity = 0;
+
+   // Live ring allocations in the order they were made. Slots freed out of
+   // order stay in place until they reach either end of the ring.
+   std::deque<Ring_slot> _ring_slots;
+   // Sequence number of _ring_slots.front(), each slot is numbered by when it
+   // was allocated so it can be found from _ring_index without a search.
+   std::size_t _ring_front_sequence = 0;
+   absl::flat_hash_map<std::size_t, std::size_t> _ring_index;
+
+   absl::flat_hash_map<std::byte*, Overflow_slot> _overflow_slots;
+
+   std::size_t _demand = 0;
+   std::size_t _decay_peak = 0;
+   std::size_t _empty_count = 0;
+
+   Stats _stats;
+
+   const std::size_t _min_capacity;
+};
+
+extern Upload_arena upload_arena;
+
+}
@@ -42,16 +42,16 @@ auto calc_size(const DXGI_FORMAT format, const UINT width, const UINT height,
 }
 }
 
-Upload_texture::Upload_texture(Upload_scratch_buffer& scratch_buffer,
+Upload_texture::Upload_texture(Upload_arena& arena,
                                const DXGI_FORMAT format, const UINT width,
                                const UINT height, const UINT depth,
                                const UINT mip_levels, const UINT array_size) noexcept
-   : _scratch_buffer{scratch_buffer}, _mip_levels{mip_levels}
+   : _arena{arena}, _mip_levels{mip_levels}
 {
    Expects(mip_levels > 0 && array_size >= 1);
 
    const auto size = calc_size(format, width, height, depth, mip_levels, array_size);
-   auto* const data = scratch_buffer.lock(size);
+   auto* const data = _data = arena.allocate(size);
 
    _surfaces = {reinterpret_cast<core::Mapped_texture*>(data), array_size * mip_levels};
 
@@ -86,10 +86,10 @@ Upload_texture::~Upload_texture()
    static_assert(
       std::is_trivially_destructible_v<core::Mapped_texture>,
       "An array of core::Mapped_texture was explicitly constructed into the "
-      "scratch buffer but was not explicitly destroyed. (Trivial "
+      "upload arena but was not explicitly destroyed. (Trivial "
       "destructibility was expected.)");
 
-   _scratch_buffer.unlock();
+   _arena.deallocate(_data);
 }
 
 auto Upload_texture::subresource(const UINT mip, const UINT index) noexcept
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../core/shader_patch.hpp"
-#include "upload_scratch_buffer.hpp"
+#include "upload_arena.hpp"
 
 #include <gsl/gsl>
 
@@ -13,7 +13,7 @@ class Upload_texture {
 public:
    constexpr static std::size_t alignment = 256u;
 
-   Upload_texture(Upload_scratch_buffer& scratch_buffer, const DXGI_FORMAT format,
+   Upload_texture(Upload_arena& arena, const DXGI_FORMAT format,
                   const UINT width, const UINT height, const UINT depth,
                   const UINT mip_levels, const UINT array_size) noexcept;
 
@@ -32,7 +32,8 @@ public:
 private:
    std::span<core::Mapped_texture> _surfaces;
 
-   Upload_scratch_buffer& _scratch_buffer;
+   Upload_arena& _arena;
+   std::byte* _data = nullptr;
    const UINT _mip_levels;
 };
 
@@ -3,6 +3,7 @@
 #include "../logger.hpp"
 #include "file_dialogs.hpp"
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <iomanip>
@@ -20,6 +21,20 @@ namespace {
 
 constexpr auto max_unique_region_configs = std::numeric_limits<std::uint16_t>::max();
 
+constexpr std::size_t max_bvh_leaf_regions = 4;
+
+auto rotated_bounds(const glm::quat rotation, const glm::vec3 centre,
+                    const glm::vec3 half_extents) noexcept
+   -> std::pair<glm::vec3, glm::vec3>
+{
+   const glm::mat3 matrix = glm::mat3_cast(rotation);
+   const glm::vec3 world_half_extents =
+      glm::abs(matrix[0]) * half_extents.x + glm::abs(matrix[1]) * half_extents.y +
+      glm::abs(matrix[2]) * half_extents.z;
+
+   return {centre - world_half_extents, centre + world_half_extents};
+}
+
 auto apply_params_weight(Color_grading_params params, const float weight) noexcept
 {
    params.color_filter *= weight;
@@ -169,6 +184,7 @@ void save_configs(const std::filesystem::path& path,
 void Color_grading_regions_blender::global_cg_params(const Color_grading_params& params) noexcept
 {
    _global_cg_params = params;
+   _blended_camera_position = std::nullopt;
 }
 
 auto Color_grading_regions_blender::global_bloom_params() const noexcept
@@ -180,6 +196,7 @@ auto Color_grading_regions_blender::global_bloom_params() const noexcept
 void Color_grading_regions_blender::global_bloom_params(const Bloom_params& params) noexcept
 {
    _global_bloom_params = params;
+   _blended_camera_position = std::nullopt;
 }
 
 auto Color_grading_regions_blender::global_cg_params() const noexcept
@@ -199,18 +216,35 @@ void Color_grading_regions_blender::regions(const Color_grading_regions& regions
 
    init_region_params(regions);
    init_regions(regions);
+   build_bvh();
 
    _contributions.reserve(_regions.size() + 1);
+   _candidate_regions.reserve(_regions.size());
+   _blended_camera_position = std::nullopt;
 }
 
 auto Color_grading_regions_blender::blend(const glm::vec3 camera_position) noexcept
    -> std::pair<Color_grading_params, Bloom_params>
+{
+   if (_blended_camera_position == camera_position) return _blended_params;
+
+   _blended_camera_position = camera_position;
+   _blended_params = blend_regions(camera_position);
+
+   return _blended_params;
+}
+
+auto Color_grading_regions_blender::blend_regions(const glm::vec3 camera_position) noexcept
+   -> std::pair<Color_grading_params, Bloom_params>
 {
    _contributions.clear();
 
+   find_candidate_regions(camera_position);
+
    float global_weight = 1.0f;
 
-   for (const auto& region : _regions) {
+   for (const auto region_index : _candidate_regions) {
+      const auto& region = _regions[region_index];
       const auto weight = region.weight(camera_position);
 
       if (weight <= 0.0f) continue;
@@ -270,6 +304,9 @@ void Color_grading_regions_blender::show_imgui(
 
    _imgui_editor_state.resize(_region_cg_params.size());
 
+   // The editors below can change any region's params.
+   _blended_camera_position = std::nullopt;
+
    if (ImGui::BeginTabBar("Color Grading Regions", ImGuiTabBarFlags_AutoSelectNewTabs)) {
       if (ImGui::BeginTabItem("Configs")) {
          if (ImGui::Button("Save Configs")) {
@@ -427,6 +464,146 @@ auto Color_grading_regions_blender::get_region_params(const std::string_view con
    return _region_cg_params.size() - 1;
 }
 
+void Color_grading_regions_blender::build_bvh() noexcept
+{
+   _bvh.clear();
+   _bvh_region_indices.resize(_regions.size());
+
+   std::iota(_bvh_region_indices.begin(), _bvh_region_indices.end(), std::uint32_t{0});
+
+   if (_regions.empty()) return;
+
+   _bvh.reserve(_regions.size() * 2);
+   _bvh.emplace_back();
+
+   build_bvh_node(0, 0, _regions.size());
+}
+
+void Color_grading_regions_blender::build_bvh_node(const std::size_t node_index,
+                                                   const std::size_t begin,
+                                                   const std::size_t end) noexcept
+{
+   glm::vec3 min{std::numeric_limits<float>::max()};
+   glm::vec3 max{std::numeric_limits<float>::lowest()};
+   glm::vec3 centroid_min{std::numeric_limits<float>::max()};
+   glm::vec3 centroid_max{std::numeric_limits<float>::lowest()};
+
+   for (std::size_t i = begin; i < end; ++i) {
+      const auto [region_min, region_max] = _regions[_bvh_region_indices[i]].bounds();
+      const auto centroid = (region_min + region_max) * 0.5f;
+
+      min = glm::min(min, region_min);
+      max = glm::max(max, region_max);
+      centroid_min = glm::min(centroid_min, centroid);
+      centroid_max = glm::max(centroid_max, centroid);
+   }
+
+   _bvh[node_index].min = min;
+   _bvh[node_index].max = max;
+
+   if ((end - begin) <= max_bvh_leaf_regions) {
+      _bvh[node_index].first = static_cast<std::uint32_t>(begin);
+      _bvh[node_index].count = static_cast<std::uint32_t>(end - begin);
+
+      return;
+   }
+
+   // Split at the median centroid along the axis the centroids are spread
+   // out the most on.
+   const auto centroid_extent = centroid_max - centroid_min;
+   const int axis = centroid_extent.x > centroid_extent.y
+                       ? (centroid_extent.x > centroid_extent.z ? 0 : 2)
+                       : (centroid_extent.y > centroid_extent.z ? 1 : 2);
+   const auto middle = begin + (end - begin) / 2;
+
+   std::nth_element(_bvh_region_indices.begin() + begin,
+                    _bvh_region_indices.begin() + middle,
+                    _bvh_region_indices.begin() + end,
+                    [&](const std::uint32_t l, const std::uint32_t r) {
+                       const auto [l_min, l_max] = _regions[l].bounds();
+                       const auto [r_min, r_max] = _regions[r].bounds();
+
+                       return (l_min[axis] + l_max[axis]) < (r_min[axis] + r_max[axis]);
+                    });
+
+   const auto children_index = _bvh.size();
+
+   _bvh[node_index].first = static_cast<std::uint32_t>(children_index);
+   _bvh[node_index].count = 0;
+
+   _bvh.emplace_back();
+   _bvh.emplace_back();
+
+   build_bvh_node(children_index, begin, middle);
+   build_bvh_node(children_index + 1, middle, end);
+}
+
+void Color_grading_regions_blender::find_candidate_regions(const glm::vec3 camera_position) noexcept
+{
+   _candidate_regions.clear();
+
+   if (_bvh.empty()) return;
+
+   // Median splits keep the tree balanced so this is far deeper than it
+   // will ever need to be.
+   std::array<std::uint32_t, 64> stack;
+   std::size_t stack_size = 0;
+
+   stack[stack_size++] = 0;
+
+   while (stack_size > 0) {
+      const auto& node = _bvh[stack[--stack_size]];
+
+      if (glm::any(glm::lessThan(camera_position, node.min)) ||
+          glm::any(glm::greaterThan(camera_position, node.max))) {
+         continue;
+      }
+
+      if (node.count == 0) {
+         stack[stack_size++] = node.first;
+         stack[stack_size++] = node.first + 1;
+      }
+      else {
+         _candidate_regions.insert(_candidate_regions.end(),
+                                   _bvh_region_indices.begin() + node.first,
+                                   _bvh_region_indices.begin() + node.first +
+                                      node.count);
+      }
+   }
+
+   // Keep the blend order the same as the region order so the result doesn't
+   // depend on the shape of the tree.
+   std::ranges::sort(_candidate_regions);
+}
+
+auto Color_grading_regions_blender::Region::bounds() const noexcept
+   -> std::pair<glm::vec3, glm::vec3>
+{
+   return std::visit(
+      []<typename Primitive>(const Primitive& prim) noexcept
+      -> std::pair<glm::vec3, glm::vec3> {
+         // Without a fade length the region covers everything, use something
+         // that is still finite once rotated so the BVH maths stays sane.
+         const float fade_length =
+            prim.inv_fade_length > 0.0f ? 1.0f / prim.inv_fade_length : 1e9f;
+
+         if constexpr (std::is_same_v<Primitive, Box>) {
+            return rotated_bounds(prim.rotation, prim.centre,
+                                  prim.length / 2.0f + fade_length);
+         }
+         else if constexpr (std::is_same_v<Primitive, Sphere>) {
+            return {prim.centre - (prim.radius + fade_length),
+                    prim.centre + (prim.radius + fade_length)};
+         }
+         else if constexpr (std::is_same_v<Primitive, Cylinder>) {
+            return rotated_bounds(prim.rotation, prim.centre,
+                                  glm::vec3{prim.radius, prim.length, prim.radius} +
+                                     fade_length);
+         }
+      },
+      primitive);
+}
+
 Color_grading_regions_blender::Region::Region(const Color_grading_region_desc& desc,
                                               const std::size_t params_index) noexcept
    : params_index{params_index}
@@ -6,6 +6,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <variant>
 
@@ -34,12 +35,22 @@ public:
       Small_function<Bloom_params(Bloom_params) noexcept> show_bloom_params_imgui) noexcept;
 
 private:
+   auto blend_regions(const glm::vec3 camera_position) noexcept
+      -> std::pair<Color_grading_params, Bloom_params>;
+
    void init_region_params(const Color_grading_regions& regions) noexcept;
 
    void init_regions(const Color_grading_regions& regions) noexcept;
 
    auto get_region_params(const std::string_view config_name) noexcept -> std::size_t;
 
+   void build_bvh() noexcept;
+
+   void build_bvh_node(const std::size_t node_index, const std::size_t begin,
+                       const std::size_t end) noexcept;
+
+   void find_candidate_regions(const glm::vec3 camera_position) noexcept;
+
    struct Region {
       struct Box {
          glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
@@ -106,6 +117,19 @@ private:
                            -> float { return prim.weight(camera_position); },
                            primitive);
       }
+
+      //! World space bounds of the area the region has a non-zero weight in.
+      auto bounds() const noexcept -> std::pair<glm::vec3, glm::vec3>;
+   };
+
+   // Flattened BVH over the region bounds. Leaves reference a run of
+   // _bvh_region_indices, interior nodes have their children at
+   // `first` and `first + 1`.
+   struct Bvh_node {
+      glm::vec3 min;
+      std::uint32_t first = 0;
+      glm::vec3 max;
+      std::uint32_t count = 0;
    };
 
    struct Contribution {
@@ -116,6 +140,15 @@ private:
 
    std::vector<Contribution> _contributions;
 
+   std::vector<Bvh_node> _bvh;
+   std::vector<std::uint32_t> _bvh_region_indices;
+   std::vector<std::uint32_t> _candidate_regions;
+
+   // The last blend, reused while the camera stays still and nothing has
+   // been edited.
+   std::optional<glm::vec3> _blended_camera_position;
+   std::pair<Color_grading_params, Bloom_params> _blended_params;
+
    Color_grading_params _global_cg_params{};
    Bloom_params _global_bloom_params{};
 
@@ -3,6 +3,7 @@
 #include "../imgui/imgui_ext.hpp"
 #include "../logger.hpp"
 #include "../user_config.hpp"
+#include "cpu_profiler.hpp"
 #include "file_dialogs.hpp"
 #include "filmic_tonemapper.hpp"
 #include "postprocess_params.hpp"
@@ -192,6 +193,22 @@ void Control::show_imgui(HWND game_window) noexcept
 
          ImGui::Checkbox("Profiler Enabled", &profiler.enabled);
 
+         if (bool cpu_profiler_enabled = cpu_profiler().enabled();
+             ImGui::Checkbox("CPU Profiler Enabled", &cpu_profiler_enabled)) {
+            cpu_profiler().enabled(cpu_profiler_enabled);
+         }
+
+         if (ImGui::Button("Capture CPU Trace") && !cpu_profiler().capturing()) {
+            cpu_profiler().capture(300, "shader patch cpu trace.json");
+         }
+
+         if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Records the next 300 frames of CPU timings to "
+                              "\"shader patch cpu trace.json\" in the game's "
+                              "directory. The trace can be opened in "
+                              "ui.perfetto.dev or chrome://tracing.");
+         }
+
          ImGui::Separator();
 
          imgui_save_widget(game_window);
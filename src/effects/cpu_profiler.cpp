@@ -0,0 +1,394 @@
+
+#include "cpu_profiler.hpp"
+#include "../logger.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <utility>
+
+#include "../imgui/imgui.h"
+
+namespace sp::effects {
+
+namespace {
+
+std::atomic_uint64_t next_profiler_id = 1;
+
+void write_json_string(std::ostream& out, const std::string_view string) noexcept
+{
+   out << '"';
+
+   for (const char c : string) {
+      if (c == '"' || c == '\\') {
+         out << '\\' << c;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20) {
+         out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(c) << std::dec << std::setfill(' ');
+      }
+      else {
+         out << c;
+      }
+   }
+
+   out << '"';
+}
+
+}
+
+Cpu_profiler::Cpu_profiler() noexcept : _id{next_profiler_id.fetch_add(1)} {}
+
+Cpu_profiler::~Cpu_profiler() = default;
+
+auto Cpu_profiler::section(const std::string_view name) noexcept -> Cpu_section_id
+{
+   std::scoped_lock lock{_sections_mutex};
+
+   if (auto it = _section_ids.find(name); it != _section_ids.end()) {
+      return it->second;
+   }
+
+   const auto id = static_cast<Cpu_section_id>(_section_names.size());
+
+   _section_names.emplace_back(name);
+   _section_ids.emplace(name, id);
+
+   return id;
+}
+
+void Cpu_profiler::enabled(const bool enabled) noexcept
+{
+   _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Cpu_profiler::enabled() const noexcept
+{
+   return _enabled.load(std::memory_order_relaxed);
+}
+
+void Cpu_profiler::record(const Cpu_section_id section, const Clock::time_point begin,
+                          const Clock::time_point end) noexcept
+{
+   auto& buffer = thread_buffer();
+
+   std::scoped_lock lock{buffer.mutex};
+
+   // Nothing is collecting the events, stop recording instead of growing forever.
+   if (buffer.events.size() >= max_thread_events) return;
+
+   const auto to_nanoseconds = [this](const Clock::time_point time) {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _start).count();
+   };
+
+   buffer.events.push_back({.section = section,
+                            .thread = buffer.index,
+                            .begin = to_nanoseconds(begin),
+                            .end = to_nanoseconds(end)});
+}
+
+void Cpu_profiler::end_frame() noexcept
+{
+   _frame_events.clear();
+
+   {
+      std::scoped_lock lock{_buffers_mutex};
+
+      for (auto it = _buffers.begin(); it != _buffers.end();) {
+         auto& buffer = *it->second;
+
+         std::unique_lock buffer_lock{buffer.mutex};
+
+         _frame_events.insert(_frame_events.end(), buffer.events.begin(),
+                              buffer.events.end());
+         buffer.events.clear();
+
+         if (!buffer.thread_exited) {
+            ++it;
+
+            continue;
+         }
+
+         buffer_lock.unlock();
+
+         _buffers.erase(it++);
+      }
+   }
+
+   {
+      std::scoped_lock lock{_sections_mutex};
+
+      _timings.resize(_section_names.size());
+   }
+
+   for (const auto& event : _frame_events) {
+      auto& timings = _timings[static_cast<std::size_t>(event.section)];
+
+      timings.frame_duration += event.end - event.begin;
+      timings.frame_count += 1;
+   }
+
+   for (auto& timings : _timings) {
+      timings.duration_samples[timings.current_duration_sample] =
+         static_cast<float>(timings.frame_duration) / 1'000'000.0f;
+      timings.current_duration_sample =
+         (timings.current_duration_sample + 1) % timings.duration_samples.size();
+      timings.last_frame_count = timings.frame_count;
+      timings.frame_duration = 0;
+      timings.frame_count = 0;
+   }
+
+   std::shared_ptr<const Capture> completed_capture;
+   std::filesystem::path save_path;
+   bool truncated = false;
+
+   {
+      std::scoped_lock lock{_capture_mutex};
+
+      if (_capture_frames_left == 0) return;
+
+      const std::size_t space = max_capture_events - _capture_events.size();
+
+      if (_frame_events.size() > space) _capture_truncated = true;
+
+      _capture_events.insert(_capture_events.end(), _frame_events.begin(),
+                             _frame_events.begin() +
+                                std::min(_frame_events.size(), space));
+
+      if (--_capture_frames_left != 0) return;
+
+      _completed_capture =
+         std::make_shared<const Capture>(std::exchange(_capture_events, {}));
+
+      completed_capture = _completed_capture;
+      save_path = _capture_path;
+      truncated = _capture_truncated;
+   }
+
+   save_capture(std::move(completed_capture), std::move(save_path), truncated);
+}
+
+void Cpu_profiler::capture(const std::size_t frame_count,
+                           std::filesystem::path save_to) noexcept
+{
+   enabled(true);
+
+   std::scoped_lock lock{_capture_mutex};
+
+   _capture_events.clear();
+   _capture_frames_left = frame_count;
+   _capture_path = std::move(save_to);
+   _capture_truncated = false;
+}
+
+bool Cpu_profiler::capturing() const noexcept
+{
+   std::scoped_lock lock{_capture_mutex};
+
+   return _capture_frames_left != 0;
+}
+
+void Cpu_profiler::write_chrome_trace(std::ostream& out) const noexcept
+{
+   std::scoped_lock lock{_capture_mutex, _sections_mutex};
+
+   if (!_completed_capture) return;
+
+   write_chrome_trace(out, *_completed_capture, _section_names);
+}
+
+void Cpu_profiler::write_chrome_trace(
+   std::ostream& out, const Capture& capture,
+   const std::vector<std::string>& section_names) noexcept
+{
+   std::vector<std::uint32_t> threads;
+
+   for (const auto& event : capture) threads.push_back(event.thread);
+
+   std::sort(threads.begin(), threads.end());
+   threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+   out << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+   bool first = true;
+
+   const auto begin_event = [&] {
+      if (!std::exchange(first, false)) out << ",";
+
+      out << "\n";
+   };
+
+   for (const auto thread : threads) {
+      begin_event();
+
+      out << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << thread
+          << R"(,"args":{"name":"Thread )" << thread << R"("}})";
+   }
+
+   out << std::fixed << std::setprecision(3);
+
+   for (const auto& event : capture) {
+      begin_event();
+
+      out << R"({"name":)";
+      write_json_string(out, section_names[static_cast<std::size_t>(event.section)]);
+      out << R"(,"cat":"cpu","ph":"X","pid":0,"tid":)" << event.thread
+          << R"(,"ts":)" << (event.begin / 1000.0) << R"(,"dur":)"
+          << ((event.end - event.begin) / 1000.0) << "}";
+   }
+
+   out << "\n]}\n";
+}
+
+void Cpu_profiler::show_imgui() noexcept
+{
+   if (!enabled()) return;
+
+   struct Section_display {
+      std::string_view name;
+      float average_duration;
+      std::uint32_t count;
+   };
+
+   std::vector<Section_display> sections;
+   sections.reserve(_timings.size());
+
+   {
+      std::scoped_lock lock{_sections_mutex};
+
+      for (std::size_t i = 0; i < _timings.size(); ++i) {
+         const auto& timings = _timings[i];
+
+         sections.push_back(
+            {.name = _section_names[i],
+             .average_duration = std::reduce(timings.duration_samples.cbegin(),
+                                             timings.duration_samples.cend()) /
+                                 timings.duration_samples.size(),
+             .count = timings.last_frame_count});
+      }
+   }
+
+   std::sort(sections.begin(), sections.end(),
+             [](const Section_display& left, const Section_display& right) {
+                return left.average_duration > right.average_duration;
+             });
+
+   const ImVec2 window_pos{ImGui::GetIO().DisplaySize.x - 10.0f, 10.0f};
+   const ImVec2 window_pos_pivot{1.0f, 0.0f};
+
+   ImGui::SetNextWindowPos(window_pos, ImGuiCond_Always, window_pos_pivot);
+   ImGui::SetNextWindowBgAlpha(0.3f);
+
+   ImGui::Begin("CPU Profiling", nullptr,
+                ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar |
+                   ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize |
+                   ImGuiWindowFlags_NoSavedSettings |
+                   ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+
+   ImGui::Text("CPU Timings (per frame)");
+
+   if (capturing()) ImGui::TextColored({1.0f, 0.25f, 0.25f, 1.0f}, "Capturing");
+
+   ImGui::Separator();
+
+   for (const auto& section : sections) {
+      if (section.average_duration == 0.0f && section.count == 0) continue;
+
+      ImGui::Text("%.*s avg: %.3fms calls: %u", static_cast<int>(section.name.size()),
+                  section.name.data(), section.average_duration, section.count);
+   }
+
+   ImGui::End();
+}
+
+auto Cpu_profiler::thread_buffer() noexcept -> Thread_buffer&
+{
+   // Shares the buffer with the profiler so the profiler never has to know
+   // when the thread is gone, it finds out from thread_exited instead.
+   struct Thread_cache {
+      std::uint64_t profiler_id = 0;
+      std::shared_ptr<Thread_buffer> buffer;
+
+      void release() noexcept
+      {
+         if (!buffer) return;
+
+         std::scoped_lock lock{buffer->mutex};
+
+         buffer->thread_exited = true;
+      }
+
+      ~Thread_cache()
+      {
+         release();
+      }
+   };
+
+   thread_local Thread_cache cache;
+
+   if (cache.profiler_id == _id) return *cache.buffer;
+
+   cache.release();
+
+   std::scoped_lock lock{_buffers_mutex};
+
+   auto& buffer = _buffers[std::this_thread::get_id()];
+
+   if (!buffer) {
+      buffer = std::make_shared<Thread_buffer>();
+      buffer->index = _next_thread_index++;
+   }
+
+   cache.profiler_id = _id;
+   cache.buffer = buffer;
+
+   return *buffer;
+}
+
+void Cpu_profiler::save_capture(std::shared_ptr<const Capture> capture,
+                                std::filesystem::path path, const bool truncated) noexcept
+{
+   if (path.empty()) return;
+
+   std::vector<std::string> section_names;
+
+   {
+      std::scoped_lock lock{_sections_mutex};
+
+      section_names = _section_names;
+   }
+
+   // Large captures take a while to write, keep that off the thread calling
+   // end_frame. The thread owns everything it uses and is detached so that it
+   // never holds up the profiler being destroyed.
+   std::thread{[capture = std::move(capture), path = std::move(path), truncated,
+                section_names = std::move(section_names)]() noexcept {
+      std::ofstream file{path};
+
+      if (!file) {
+         log(Log_level::warning, "Failed to open "sv, path,
+             " to save CPU profile capture."sv);
+
+         return;
+      }
+
+      write_chrome_trace(file, *capture, section_names);
+
+      if (truncated) {
+         log(Log_level::warning,
+             "CPU profile capture was too large and was truncated."sv);
+      }
+
+      log(Log_level::info, "Saved CPU profile capture to "sv, path);
+   }}.detach();
+}
+
+auto cpu_profiler() noexcept -> Cpu_profiler&
+{
+   static Cpu_profiler profiler;
+
+   return profiler;
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+
+namespace sp::effects {
+
+//! \brief Identifies a section returned from Cpu_profiler::section.
+enum class Cpu_section_id : std::uint32_t {};
+
+//! \brief Records how long scopes on the CPU take.
+//!
+//! Each thread records into its own buffer, the buffers are collected by
+//! end_frame to update per frame timings. A number of frames can be captured
+//! and saved as a Chrome trace (which Perfetto can open as well) for offline
+//! inspection. Does not touch D3D.
+class Cpu_profiler {
+public:
+   using Clock = std::chrono::steady_clock;
+
+   Cpu_profiler() noexcept;
+
+   ~Cpu_profiler();
+
+   Cpu_profiler(const Cpu_profiler&) = delete;
+   Cpu_profiler& operator=(const Cpu_profiler&) = delete;
+   Cpu_profiler(Cpu_profiler&&) = delete;
+   Cpu_profiler& operator=(Cpu_profiler&&) = delete;
+
+   //! Get the ID for a section name. Sections should be looked up once and the
+   //! ID kept (usually in a static local) instead of calling this each time.
+   auto section(const std::string_view name) noexcept -> Cpu_section_id;
+
+   void enabled(const bool enabled) noexcept;
+
+   bool enabled() const noexcept;
+
+   //! Record a section, usually called by Cpu_profile. Safe to call from
+   //! any thread.
+   void record(const Cpu_section_id section, const Clock::time_point begin,
+               const Clock::time_point end) noexcept;
+
+   //! Collect the sections recorded since the last call and update the timings.
+   //! Must be called by one thread only.
+   void end_frame() noexcept;
+
+   //! Capture the sections of the next `frame_count` frames. Once the capture
+   //! is complete it is written as a Chrome trace to `save_to` on a background
+   //! thread, if `save_to` is empty the capture is only kept for
+   //! write_chrome_trace.
+   void capture(const std::size_t frame_count, std::filesystem::path save_to) noexcept;
+
+   bool capturing() const noexcept;
+
+   //! Write the last completed capture as a Chrome trace.
+   void write_chrome_trace(std::ostream& out) const noexcept;
+
+   void show_imgui() noexcept;
+
+private:
+   struct Event {
+      Cpu_section_id section;
+      std::uint32_t thread;
+      std::int64_t begin;
+      std::int64_t end;
+   };
+
+   struct Thread_buffer {
+      std::mutex mutex;
+      std::vector<Event> events;
+      std::uint32_t index = 0;
+      // Set when the thread exits, end_frame drops the buffer once it's drained.
+      bool thread_exited = false;
+   };
+
+   using Capture = std::vector<Event>;
+
+   struct Section_timings {
+      std::array<float, 60> duration_samples{};
+      std::size_t current_duration_sample = 0;
+      std::int64_t frame_duration = 0;
+      std::uint32_t frame_count = 0;
+      std::uint32_t last_frame_count = 0;
+   };
+
+   constexpr static std::size_t max_thread_events = 1 << 20;
+   constexpr static std::size_t max_capture_events = 1 << 22;
+
+   auto thread_buffer() noexcept -> Thread_buffer&;
+
+   void save_capture(std::shared_ptr<const Capture> capture,
+                     std::filesystem::path path, const bool truncated) noexcept;
+
+   static void write_chrome_trace(std::ostream& out, const Capture& capture,
+                                  const std::vector<std::string>& section_names) noexcept;
+
+   const std::uint64_t _id;
+   const Clock::time_point _start = Clock::now();
+
+   std::atomic_bool _enabled = false;
+
+   mutable std::mutex _sections_mutex;
+   absl::flat_hash_map<std::string, Cpu_section_id> _section_ids;
+   std::vector<std::string> _section_names;
+
+   std::mutex _buffers_mutex;
+   absl::flat_hash_map<std::thread::id, std::shared_ptr<Thread_buffer>> _buffers;
+   std::uint32_t _next_thread_index = 0;
+
+   // Only touched by the thread calling end_frame and show_imgui.
+   std::vector<Event> _frame_events;
+   std::vector<Section_timings> _timings;
+
+   mutable std::mutex _capture_mutex;
+   std::vector<Event> _capture_events;
+   std::shared_ptr<const Capture> _completed_capture;
+   std::size_t _capture_frames_left = 0;
+   std::filesystem::path _capture_path;
+   bool _capture_truncated = false;
+};
+
+//! \brief Records the time between construction and destruction as a section.
+class Cpu_profile {
+public:
+   Cpu_profile(Cpu_profiler& profiler, const Cpu_section_id section) noexcept
+      : _profiler{profiler}, _section{section}, _active{profiler.enabled()}
+   {
+      if (_active) _begin = Cpu_profiler::Clock::now();
+   }
+
+   ~Cpu_profile()
+   {
+      if (_active) _profiler.record(_section, _begin, Cpu_profiler::Clock::now());
+   }
+
+   Cpu_profile(const Cpu_profile&) = delete;
+   Cpu_profile& operator=(const Cpu_profile&) = delete;
+   Cpu_profile(Cpu_profile&&) = delete;
+   Cpu_profile& operator=(Cpu_profile&&) = delete;
+
+private:
+   Cpu_profiler& _profiler;
+   const Cpu_section_id _section;
+   const bool _active;
+   Cpu_profiler::Clock::time_point _begin;
+};
+
+//! \brief The profiler shared by all of Shader Patch.
+auto cpu_profiler() noexcept -> Cpu_profiler&;
+
+}
@@ -31,14 +31,14 @@ auto Profiler::begin_section(ID3D11DeviceContext1& dc,
    if (!enabled) return npos;
 
    const std::size_t index = [&]() {
-      if (const auto index = find_section(name); index == npos) {
-         _sections.emplace_back(name, *_device);
-
-         return _sections.size() - 1;
-      }
-      else {
-         return index;
+      if (auto it = _section_indices.find(name); it != _section_indices.end()) {
+         return it->second;
       }
+
+      _sections.emplace_back(name, *_device);
+      _section_indices.emplace(name, _sections.size() - 1);
+
+      return _sections.size() - 1;
    }();
 
    auto& section = _sections[index].second;
@@ -66,6 +66,7 @@ void Profiler::end_section(ID3D11DeviceContext1& dc, const std::size_t index) no
    dc.End(section.time_stamp_end_queries[_current_frame].get());
    dc.End(section.disjoint_queries[_current_frame].get());
 
+   section.issued[_current_frame] = true;
    section.active = true;
 }
 
@@ -83,30 +84,32 @@ void Profiler::end_frame(ID3D11DeviceContext1& dc) noexcept
 
       if (!std::exchange(section.active, false)) continue;
 
-      UINT64 begin{};
-      while (dc.GetData(section.time_stamp_begin_queries[_current_frame].get(),
-                        &begin, sizeof(begin), 0) == S_FALSE)
-         ;
-
-      UINT64 end{};
-      while (dc.GetData(section.time_stamp_end_queries[_current_frame].get(),
-                        &end, sizeof(end), 0) == S_FALSE)
-         ;
-
-      D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
-      while (dc.GetData(section.disjoint_queries[_current_frame].get(),
-                        &disjoint, sizeof(disjoint), 0) == S_FALSE)
-         ;
-
-      if (!disjoint.Disjoint) {
-         const auto delta = end - begin;
-         const auto duration = delta / static_cast<float>(disjoint.Frequency) * 1000.0f;
-
-         section.duration_samples[section.current_duration_sample] = duration;
-         section.max_duration = std::max(section.max_duration, duration);
-         section.min_duration = std::min(section.min_duration, duration);
-         section.current_duration_sample = (section.current_duration_sample + 1) %
-                                           section.duration_samples.size();
+      // The queries are read the frame before they are reused, if the GPU has
+      // not got to them yet their results are skipped instead of waiting.
+      if (std::exchange(section.issued[_current_frame], false)) {
+         const auto get_data = [&](ID3D11Query* query, auto& data) {
+            return dc.GetData(query, &data, sizeof(data),
+                              D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+         };
+
+         UINT64 begin{};
+         UINT64 end{};
+         D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+
+         if (get_data(section.disjoint_queries[_current_frame].get(), disjoint) &&
+             get_data(section.time_stamp_begin_queries[_current_frame].get(), begin) &&
+             get_data(section.time_stamp_end_queries[_current_frame].get(), end) &&
+             !disjoint.Disjoint) {
+            const auto delta = end - begin;
+            const auto duration =
+               delta / static_cast<float>(disjoint.Frequency) * 1000.0f;
+
+            section.duration_samples[section.current_duration_sample] = duration;
+            section.max_duration = std::max(section.max_duration, duration);
+            section.min_duration = std::min(section.min_duration, duration);
+            section.current_duration_sample = (section.current_duration_sample + 1) %
+                                              section.duration_samples.size();
+         }
       }
 
       Profile_timings timings;
@@ -151,15 +154,6 @@ void Profiler::end_frame(ID3D11DeviceContext1& dc) noexcept
    ImGui::End();
 }
 
-auto Profiler::find_section(const std::string_view name) const noexcept -> std::size_t
-{
-   for (std::size_t i = 0; i < _sections.size(); ++i) {
-      if (_sections[i].first == name) return i;
-   }
-
-   return npos;
-}
-
 Profiler::Section_data::Section_data(ID3D11Device1& device) noexcept
 {
    for (auto& query : disjoint_queries) {
@@ -9,6 +9,8 @@
 #include <string_view>
 #include <vector>
 
+#include <absl/container/flat_hash_map.h>
+
 #include <d3d11_1.h>
 
 namespace sp::effects {
@@ -36,14 +38,13 @@ private:
    constexpr static std::size_t query_frame_latency = 5;
    constexpr static std::size_t npos = std::numeric_limits<std::size_t>::max();
 
-   auto find_section(const std::string_view name) const noexcept -> std::size_t;
-
    struct Section_data {
       Section_data(ID3D11Device1& device) noexcept;
 
       std::array<Com_ptr<ID3D11Query>, query_frame_latency> disjoint_queries{};
       std::array<Com_ptr<ID3D11Query>, query_frame_latency> time_stamp_begin_queries{};
       std::array<Com_ptr<ID3D11Query>, query_frame_latency> time_stamp_end_queries{};
+      std::array<bool, query_frame_latency> issued{};
 
       std::array<float, 60> duration_samples{};
       std::size_t current_duration_sample = 0;
@@ -60,6 +61,7 @@ private:
    std::size_t _current_frame = 0;
 
    std::vector<std::pair<std::string, Section_data>> _sections;
+   absl::flat_hash_map<std::string, std::size_t> _section_indices;
 };
 
 class Profile {
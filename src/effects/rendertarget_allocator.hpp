@@ -3,10 +3,19 @@
 #include "../logger.hpp"
 #include "com_ptr.hpp"
 #include "enum_flags.hpp"
+#include "rendertarget_planner.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
+
+#include <DirectXTex.h>
 #include <comdef.h>
 #include <d3d11_1.h>
 
@@ -28,13 +37,47 @@ struct Rendertarget_desc {
    DXGI_FORMAT uav_format = format;
 
    bool operator==(const Rendertarget_desc&) const noexcept = default;
+
+   template<typename H>
+   friend H AbslHashValue(H h, const Rendertarget_desc& desc)
+   {
+      return H::combine(std::move(h), desc.format, desc.width, desc.height,
+                        desc.bind_flags, desc.srv_format, desc.rtv_format,
+                        desc.uav_format);
+   }
 };
 
+struct Rendertarget_allocator_stats {
+   std::size_t pooled_count = 0;
+   std::uint64_t pooled_size = 0;
+
+   //! Size of the rendertargets the last planned frame needed, as planned by
+   //! Rendertarget_planner.
+   std::uint64_t planned_size = 0;
+
+   //! Size of the rendertargets the last planned frame would have needed if
+   //! none were reused.
+   std::uint64_t unaliased_size = 0;
+
+   std::size_t evicted_total = 0;
+};
+
+//! \brief Pools the transient rendertargets used by effects.
+//!
+//! Rendertargets are pooled by their exact description and reused when a
+//! handle to one is destroyed. Rendertargets that go unused for a while are
+//! released so changing resolution or settings does not leave stale
+//! rendertargets behind. When asked to with request_plan() a frame's
+//! allocations are also fed to a Rendertarget_planner as passes, which reports
+//! how much memory the frame needs for stats().
 class Rendertarget_allocator {
 private:
    struct Rendertarget {
       Rendertarget_desc desc;
 
+      std::uint64_t allocated_frame = 0;
+      Rendertarget_planner::Resource_id planner_resource{};
+
       Com_ptr<ID3D11ShaderResourceView> srv;
       Com_ptr<ID3D11RenderTargetView> rtv;
       Com_ptr<ID3D11UnorderedAccessView> uav;
@@ -105,37 +148,127 @@ public:
 
    auto allocate(const Rendertarget_desc& desc) noexcept -> Handle
    {
-      if (auto cached = find(desc); cached != std::end(_rendertargets)) {
+      Rendertarget_planner::Resource_id planner_resource{};
 
-         auto rendertarget = std::move(*cached);
-         _rendertargets.erase(cached);
+      if (_planning) {
+         planner_resource =
+            _planner.create({.compatibility_key = absl::Hash<Rendertarget_desc>{}(desc),
+                             .size = rendertarget_size(desc)});
 
-         return {*this, rendertarget};
+         _planner.pass({}, {planner_resource});
       }
 
-      return create(desc);
+      auto rendertarget = [&] {
+         if (auto cached = _pool.find(desc);
+             cached != _pool.end() && !cached->second.empty()) {
+            auto rendertarget = std::move(cached->second.back().rendertarget);
+            cached->second.pop_back();
+
+            return rendertarget;
+         }
+
+         return create(desc);
+      }();
+
+      rendertarget.allocated_frame = _frame;
+      rendertarget.planner_resource = planner_resource;
+
+      return {*this, std::move(rendertarget)};
    }
 
    void return_rendertarget(Rendertarget rendertarget) noexcept
    {
-      _rendertargets.emplace_back(std::move(rendertarget));
+      if (_planning && rendertarget.allocated_frame == _frame) {
+         _planner.pass({rendertarget.planner_resource}, {});
+      }
+
+      // Most recently used rendertargets are at the back of each list, they're
+      // handed out first and the ones at the front are evicted first.
+      _pool[rendertarget.desc].push_back(
+         {.rendertarget = std::move(rendertarget), .last_used_frame = _frame});
+   }
+
+   //! Plan the next frame's allocations for stats(). Only done when asked for
+   //! as it costs a little on every allocation and at the end of the frame.
+   void request_plan() noexcept
+   {
+      _plan_requested = true;
+   }
+
+   //! Update the stats from this frame's allocations and release rendertargets
+   //! that have gone unused.
+   void end_frame() noexcept
+   {
+      if (_planning) {
+         const auto plan = _planner.plan();
+
+         _planner.clear();
+
+         _stats.planned_size = plan.physical_size;
+         _stats.unaliased_size = plan.unaliased_size;
+      }
+
+      _planning = std::exchange(_plan_requested, false);
+
+      _stats.pooled_count = 0;
+      _stats.pooled_size = 0;
+
+      _frame += 1;
+
+      for (auto it = _pool.begin(); it != _pool.end();) {
+         auto& pooled = it->second;
+
+         const auto unused_end =
+            std::find_if(pooled.begin(), pooled.end(),
+                         [&](const Pooled_rendertarget& rendertarget) noexcept {
+                            return (_frame - rendertarget.last_used_frame) <=
+                                   eviction_frames;
+                         });
+
+         _stats.evicted_total +=
+            static_cast<std::size_t>(std::distance(pooled.begin(), unused_end));
+
+         pooled.erase(pooled.begin(), unused_end);
+
+         if (pooled.empty()) {
+            _pool.erase(it++);
+
+            continue;
+         }
+
+         _stats.pooled_count += pooled.size();
+         _stats.pooled_size += pooled.size() * rendertarget_size(it->first);
+
+         ++it;
+      }
+   }
+
+   auto stats() const noexcept -> Rendertarget_allocator_stats
+   {
+      return _stats;
    }
 
    void reset() noexcept
    {
-      _rendertargets.clear();
+      _pool.clear();
    }
 
 private:
-   auto find(const Rendertarget_desc& desc) noexcept -> std::vector<Rendertarget>::iterator
+   struct Pooled_rendertarget {
+      Rendertarget rendertarget;
+      std::uint64_t last_used_frame = 0;
+   };
+
+   // Roughly two seconds at 60 FPS.
+   constexpr static std::uint64_t eviction_frames = 120;
+
+   static auto rendertarget_size(const Rendertarget_desc& desc) noexcept -> std::uint64_t
    {
-      return std::find_if(_rendertargets.begin(), _rendertargets.end(),
-                          [&](const Rendertarget& target) noexcept {
-                             return target.desc == desc;
-                          });
+      return std::uint64_t{desc.width} * desc.height *
+             DirectX::BitsPerPixel(desc.format) / 8;
    }
 
-   auto create(const Rendertarget_desc& desc) noexcept -> Handle
+   auto create(const Rendertarget_desc& desc) noexcept -> Rendertarget
    {
       Rendertarget rendertarget;
 
@@ -195,11 +328,18 @@ private:
 
       rendertarget.desc = desc;
 
-      return {*this, std::move(rendertarget)};
+      return rendertarget;
    }
 
    const Com_ptr<ID3D11Device1> _device;
 
-   std::vector<Rendertarget> _rendertargets;
+   absl::flat_hash_map<Rendertarget_desc, std::vector<Pooled_rendertarget>> _pool;
+   std::uint64_t _frame = 0;
+
+   Rendertarget_planner _planner;
+   bool _planning = false;
+   bool _plan_requested = false;
+
+   Rendertarget_allocator_stats _stats;
 };
 }
@@ -0,0 +1,137 @@
+
+#include "rendertarget_planner.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/inlined_vector.h>
+
+#include <gsl/gsl>
+
+namespace sp::effects {
+
+auto Rendertarget_planner::create(const Resource_desc& desc) noexcept -> Resource_id
+{
+   _resources.push_back({.desc = desc});
+
+   return static_cast<Resource_id>(_resources.size() - 1);
+}
+
+void Rendertarget_planner::pass(std::initializer_list<Resource_id> reads,
+                                std::initializer_list<Resource_id> writes) noexcept
+{
+   for (const auto resource : reads) use(resource);
+   for (const auto resource : writes) use(resource);
+
+   _pass_count += 1;
+}
+
+void Rendertarget_planner::keep(const Resource_id resource) noexcept
+{
+   Expects(static_cast<std::size_t>(resource) < _resources.size());
+
+   _resources[static_cast<std::size_t>(resource)].kept = true;
+}
+
+auto Rendertarget_planner::plan() const noexcept -> Plan
+{
+   Plan plan;
+
+   plan.physical_indices.assign(_resources.size(), Plan::unused);
+
+   std::vector<std::uint32_t> order(_resources.size());
+
+   std::iota(order.begin(), order.end(), 0u);
+   std::stable_sort(order.begin(), order.end(),
+                    [&](const std::uint32_t left, const std::uint32_t right) {
+                       return _resources[left].first_pass <
+                              _resources[right].first_pass;
+                    });
+
+   const auto last_pass = [&](const Resource& resource) {
+      return resource.kept ? _pass_count : resource.last_pass;
+   };
+
+   // Assigning in order of first use to the compatible physical rendertarget
+   // that has been free the longest gives the fewest physical rendertargets
+   // for each key.
+   struct Physical_use {
+      std::uint32_t index;
+      std::uint32_t last_pass;
+   };
+
+   absl::flat_hash_map<std::uint64_t, absl::InlinedVector<Physical_use, 8>>
+      physical_by_key;
+
+   for (const auto resource_index : order) {
+      const Resource& resource = _resources[resource_index];
+
+      if (resource.first_pass == no_pass) continue;
+
+      plan.unaliased_size += resource.desc.size;
+
+      auto& candidates = physical_by_key[resource.desc.compatibility_key];
+
+      Physical_use* best = nullptr;
+
+      for (auto& candidate : candidates) {
+         if (candidate.last_pass >= resource.first_pass) continue;
+
+         if (!best || candidate.last_pass < best->last_pass) best = &candidate;
+      }
+
+      if (!best) {
+         plan.physical.push_back({.compatibility_key = resource.desc.compatibility_key});
+         best = &candidates.emplace_back(Physical_use{
+            .index = static_cast<std::uint32_t>(plan.physical.size() - 1)});
+      }
+
+      auto& physical = plan.physical[best->index];
+
+      physical.size = std::max(physical.size, resource.desc.size);
+      best->last_pass = last_pass(resource);
+
+      plan.physical_indices[resource_index] = best->index;
+   }
+
+   for (const auto& physical : plan.physical) plan.physical_size += physical.size;
+
+   std::vector<std::int64_t> live_size_changes(_pass_count + 2);
+
+   for (const auto& resource : _resources) {
+      if (resource.first_pass == no_pass) continue;
+
+      live_size_changes[resource.first_pass] += resource.desc.size;
+      live_size_changes[last_pass(resource) + 1] -= resource.desc.size;
+   }
+
+   std::int64_t live_size = 0;
+
+   for (const auto change : live_size_changes) {
+      live_size += change;
+
+      plan.peak_live_size =
+         std::max(plan.peak_live_size, static_cast<std::uint64_t>(live_size));
+   }
+
+   return plan;
+}
+
+void Rendertarget_planner::clear() noexcept
+{
+   _resources.clear();
+   _pass_count = 0;
+}
+
+void Rendertarget_planner::use(const Resource_id resource_id) noexcept
+{
+   Expects(static_cast<std::size_t>(resource_id) < _resources.size());
+
+   auto& resource = _resources[static_cast<std::size_t>(resource_id)];
+
+   resource.first_pass = std::min(resource.first_pass, _pass_count);
+   resource.last_pass = std::max(resource.last_pass, _pass_count);
+}
+
+}
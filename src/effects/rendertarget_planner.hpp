@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+namespace sp::effects {
+
+//! \brief Plans which physical rendertargets the transient rendertargets of a
+//! frame can share.
+//!
+//! Passes declare the rendertargets they read and write in the order they
+//! execute. A rendertarget lives from the first pass that uses it to the last
+//! one. Rendertargets with the same compatibility key whose lifetimes do not
+//! overlap are assigned the same physical rendertarget. Does not touch D3D.
+class Rendertarget_planner {
+public:
+   enum class Resource_id : std::uint32_t {};
+
+   struct Resource_desc {
+      //! Only rendertargets with equal keys can share a physical rendertarget.
+      std::uint64_t compatibility_key = 0;
+
+      //! Size of the rendertarget in bytes.
+      std::uint64_t size = 0;
+   };
+
+   struct Plan {
+      constexpr static std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+
+      //! The index into physical of each resource, or unused for resources no
+      //! pass referenced.
+      std::vector<std::uint32_t> physical_indices;
+
+      std::vector<Resource_desc> physical;
+
+      //! Size of all the physical rendertargets.
+      std::uint64_t physical_size = 0;
+
+      //! Size of all the resources if none of them shared rendertargets.
+      std::uint64_t unaliased_size = 0;
+
+      //! Largest size of the resources alive during any one pass, the lower
+      //! bound for physical_size.
+      std::uint64_t peak_live_size = 0;
+   };
+
+   auto create(const Resource_desc& desc) noexcept -> Resource_id;
+
+   void pass(std::initializer_list<Resource_id> reads,
+             std::initializer_list<Resource_id> writes) noexcept;
+
+   //! Keep a resource alive until the end of the frame, for outputs that are
+   //! used after the last pass.
+   void keep(const Resource_id resource) noexcept;
+
+   auto plan() const noexcept -> Plan;
+
+   void clear() noexcept;
+
+private:
+   constexpr static std::uint32_t no_pass = std::numeric_limits<std::uint32_t>::max();
+
+   struct Resource {
+      Resource_desc desc;
+      std::uint32_t first_pass = no_pass;
+      std::uint32_t last_pass = 0;
+      bool kept = false;
+   };
+
+   void use(const Resource_id resource) noexcept;
+
+   std::vector<Resource> _resources;
+   std::uint32_t _pass_count = 0;
+};
+
+}
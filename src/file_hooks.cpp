@@ -13,12 +13,18 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <future>
 #include <iomanip>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string_view>
+#include <vector>
 
 #include <absl/container/inlined_vector.h>
 
@@ -110,6 +116,145 @@ auto edit_core_lvl_fonts(ucfb::Editor& core_editor,
    }
 }
 
+// Rebuilt core.lvl files are cached on disk keyed by a hash of everything that
+// goes into them. The hash is FNV-1a over 8 byte words, it only has to tell
+// apart inputs to the same assembly not resist collisions.
+class Core_lvl_hasher {
+public:
+   void add(const std::span<const std::byte> bytes) noexcept
+   {
+      const auto words = bytes.size() / sizeof(std::uint64_t);
+
+      for (std::size_t i = 0; i < words; ++i) {
+         std::uint64_t word;
+
+         std::memcpy(&word, bytes.data() + i * sizeof(std::uint64_t), sizeof(word));
+
+         _hash = (_hash ^ word) * fnv_prime;
+      }
+
+      for (auto b : bytes.subspan(words * sizeof(std::uint64_t))) {
+         _hash = (_hash ^ static_cast<std::uint64_t>(b)) * fnv_prime;
+      }
+   }
+
+   void add(const std::string_view str) noexcept
+   {
+      add(str.size());
+      add(std::as_bytes(std::span{str}));
+   }
+
+   template<typename T>
+   void add(const T& value) noexcept requires std::is_trivially_copyable_v<T>
+   {
+      add(std::as_bytes(std::span{&value, 1}));
+   }
+
+   auto result() const noexcept -> std::uint64_t
+   {
+      return _hash;
+   }
+
+private:
+   constexpr static std::uint64_t fnv_prime = 1099511628211;
+
+   std::uint64_t _hash = 14695981039346656037;
+};
+
+auto core_lvl_cache_directory() noexcept -> std::filesystem::path
+{
+   return user_config.developer.shader_cache_path.parent_path() / L".core_lvl_cache"sv;
+}
+
+auto assemble_shader_declarations() noexcept -> std::vector<std::byte>
+{
+   ucfb::Editor editor;
+
+   for (const auto& chunk :
+        game_support::munged_shader_declarations().munged_declarations) {
+      editor.emplace_back("SHDR"_mn, ucfb::Editor_parent_chunk{chunk});
+   }
+
+   std::vector<std::byte> bytes;
+
+   {
+      ucfb::Memory_writer writer{"ucfb"_mn, bytes};
+
+      editor.assemble(writer);
+   }
+
+   return bytes;
+}
+
+auto core_lvl_cache_key(const std::span<const std::byte> core_lvl,
+                        const std::span<const std::byte> shader_declarations,
+                        const bool use_scalable_fonts) noexcept -> std::uint64_t
+{
+   Core_lvl_hasher hasher;
+
+   hasher.add(core_lvl);
+   hasher.add(shader_declarations);
+   hasher.add(std::string_view{current_shader_patch_version_string});
+   hasher.add(use_scalable_fonts);
+
+   if (use_scalable_fonts) {
+      const auto font_path =
+         windows_fonts_folder() / user_config.developer.scalable_font_name;
+
+      std::error_code error;
+
+      hasher.add(std::string_view{font_path.string()});
+      hasher.add(std::filesystem::file_size(font_path, error));
+      hasher.add(std::filesystem::last_write_time(font_path, error)
+                    .time_since_epoch()
+                    .count());
+   }
+
+   return hasher.result();
+}
+
+auto open_cached_core_lvl(const std::filesystem::path& path) noexcept
+   -> std::optional<win32::Unique_handle>
+{
+   win32::Unique_handle file{CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                         nullptr, OPEN_EXISTING,
+                                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                         nullptr)};
+
+   if (file.get() == INVALID_HANDLE_VALUE) return std::nullopt;
+
+   // Make sure the file is a complete ucfb chunk before handing it to the game.
+   LARGE_INTEGER file_size{};
+   std::array<std::uint32_t, 2> header{};
+   DWORD read_size = 0;
+
+   if (!GetFileSizeEx(file.get(), &file_size) ||
+       !ReadFile(file.get(), header.data(), sizeof(header), &read_size, nullptr) ||
+       read_size != sizeof(header) ||
+       header[0] != static_cast<std::uint32_t>("ucfb"_mn) ||
+       header[1] + sizeof(header) != static_cast<std::uint64_t>(file_size.QuadPart)) {
+      return std::nullopt;
+   }
+
+   SetFilePointer(file.get(), 0, nullptr, FILE_BEGIN);
+
+   return std::move(file);
+}
+
+void remove_stale_core_lvl_cache_files(const std::filesystem::path& cache_directory,
+                                       const std::filesystem::path& current) noexcept
+{
+   std::error_code error;
+
+   for (const auto& entry :
+        std::filesystem::directory_iterator{cache_directory, error}) {
+      if (!entry.is_regular_file(error) || entry.path() == current) continue;
+      if (entry.path().extension() != L".lvl"sv) continue;
+
+      std::filesystem::remove(entry.path(), error);
+   }
+}
+
 auto edit_core_lvl() noexcept -> win32::Unique_handle
 {
    const bool use_scalable_fonts =
@@ -117,6 +262,23 @@ auto edit_core_lvl() noexcept -> win32::Unique_handle
       std::filesystem::exists(windows_fonts_folder() /
                               user_config.developer.scalable_font_name);
 
+   const Memory_mapped_file core_lvl_file{"data/_lvl_pc/core.lvl"sv,
+                                          Memory_mapped_file::Mode::read,
+                                          Memory_mapped_file::Access_hint::sequential};
+   const auto cache_directory = core_lvl_cache_directory();
+   const auto cache_path =
+      cache_directory /
+      fmt::format("core_{:016x}.lvl"sv,
+                  core_lvl_cache_key(core_lvl_file.bytes(),
+                                     assemble_shader_declarations(),
+                                     use_scalable_fonts));
+
+   if (auto cached_file = open_cached_core_lvl(cache_path); cached_file) {
+      SetLastError(ERROR_SUCCESS);
+
+      return std::move(*cached_file);
+   }
+
    auto replacement_fonts_future =
       use_scalable_fonts
          ? std::async(std::launch::async,
@@ -131,11 +293,8 @@ auto edit_core_lvl() noexcept -> win32::Unique_handle
       return mn == "font"_mn;
    };
 
-   auto core_editor = [] {
-      win32::Memeory_mapped_file file{"data/_lvl_pc/core.lvl"sv};
-
-      return ucfb::Editor{ucfb::Reader_strict<"ucfb"_mn>{file.bytes()}, is_parent};
-   }();
+   ucfb::Editor core_editor{ucfb::Reader_strict<"ucfb"_mn>{core_lvl_file.bytes()},
+                            is_parent};
 
    // Strip out stock shader chunks.
    for (auto it = ucfb::find(core_editor, "SHDR"_mn); it != core_editor.end();
@@ -163,6 +322,41 @@ auto edit_core_lvl() noexcept -> win32::Unique_handle
               user_config.developer.scalable_font_name.string());
    }
 
+   // Write the new core.lvl into the cache and hand the game the cached file.
+   // If that fails for any reason fall back to a temporary file.
+   try {
+      std::filesystem::create_directories(cache_directory);
+
+      const auto write_path = std::filesystem::path{cache_path} += L".TEMP"sv;
+
+      {
+         std::ofstream ostream{write_path, std::ios::binary | std::ios::out};
+
+         if (!ostream) throw std::runtime_error{"Unable to open file."};
+
+         {
+            ucfb::File_writer writer{"ucfb"_mn, ostream};
+
+            core_editor.assemble(writer);
+         }
+
+         if (!ostream.flush()) throw std::runtime_error{"Unable to write file."};
+      }
+
+      std::filesystem::rename(write_path, cache_path);
+
+      remove_stale_core_lvl_cache_files(cache_directory, cache_path);
+
+      if (auto cached_file = open_cached_core_lvl(cache_path); cached_file) {
+         SetLastError(ERROR_SUCCESS);
+
+         return std::move(*cached_file);
+      }
+   }
+   catch (std::exception& e) {
+      log_fmt(Log_level::warning, "Failed to cache core.lvl. Reason: {}"sv, e.what());
+   }
+
    auto [ostream, file_handle] = create_tmp_file();
 
    // Output new core.lvl to temp file
@@ -0,0 +1,461 @@
+
+#include "logger.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
+
+#include <Windows.h>
+
+namespace sp {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Log_record {
+   Log_level level = Log_level::info;
+   std::time_t time = 0;
+   std::string message;
+};
+
+// Bounded multi-producer queue of log records. Each cell carries a sequence
+// number that tells producers when it is free to write and the consumer when
+// it is ready to read, so logging threads never take a lock. Only the log
+// writer (holding _write_mutex) consumes.
+class Log_queue {
+public:
+   constexpr static std::size_t capacity = 4096;
+
+   Log_queue() noexcept
+   {
+      for (std::size_t i = 0; i < capacity; ++i) {
+         _cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+   }
+
+   bool try_push(Log_record& record) noexcept
+   {
+      std::size_t position = _push_position.load(std::memory_order_relaxed);
+
+      while (true) {
+         auto& cell = _cells[position % capacity];
+         const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+         const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+         if (difference == 0) {
+            if (_push_position.compare_exchange_weak(position, position + 1,
+                                                     std::memory_order_relaxed)) {
+               cell.record = std::move(record);
+               cell.sequence.store(position + 1, std::memory_order_release);
+
+               return true;
+            }
+         }
+         else if (difference < 0) {
+            return false;
+         }
+         else {
+            position = _push_position.load(std::memory_order_relaxed);
+         }
+      }
+   }
+
+   auto try_pop() noexcept -> std::optional<Log_record>
+   {
+      auto& cell = _cells[_pop_position % capacity];
+
+      if (cell.sequence.load(std::memory_order_acquire) != _pop_position + 1) {
+         return std::nullopt;
+      }
+
+      std::optional<Log_record> record{std::move(cell.record)};
+
+      cell.sequence.store(_pop_position + capacity, std::memory_order_release);
+      _pop_position += 1;
+
+      return record;
+   }
+
+private:
+   struct alignas(64) Cell {
+      std::atomic_size_t sequence;
+      Log_record record;
+   };
+
+   std::array<Cell, capacity> _cells;
+
+   alignas(64) std::atomic_size_t _push_position = 0;
+   alignas(64) std::size_t _pop_position = 0;
+};
+
+// Drains the queue on a background thread so the threads logging never wait
+// on the file. Repeats of the last message are folded into a count and
+// warnings/info messages that are logged too often are suppressed for the
+// rest of a rate limit window.
+class Log_writer {
+public:
+   Log_writer() noexcept
+   {
+      _file.open(logger_path);
+      _file << "Shader Patch log started. Shader Patch version is "sv
+            << current_shader_patch_version_string << std::endl;
+
+      // std::set_terminate only covers the calling thread with MSVC. The
+      // default terminate handler of every thread calls abort however, which
+      // raises SIGABRT and that handler is process wide. Crashes that never
+      // reach terminate are caught by the unhandled exception filter.
+      _previous_abort_handler = std::signal(SIGABRT, [](int signal) {
+         get().drain_for_terminate();
+
+         const auto previous = get()._previous_abort_handler;
+
+         if (previous != SIG_DFL && previous != SIG_IGN && previous != SIG_ERR) {
+            previous(signal);
+         }
+      });
+
+      _previous_exception_filter =
+         SetUnhandledExceptionFilter([](EXCEPTION_POINTERS* exception) -> LONG {
+            get().drain_for_terminate();
+
+            if (get()._previous_exception_filter) {
+               return get()._previous_exception_filter(exception);
+            }
+
+            return EXCEPTION_CONTINUE_SEARCH;
+         });
+
+      _thread = std::jthread{[this](std::stop_token stop) { run(stop); }};
+   }
+
+   ~Log_writer()
+   {
+      if (_previous_abort_handler != SIG_ERR) {
+         std::signal(SIGABRT, _previous_abort_handler);
+      }
+      SetUnhandledExceptionFilter(_previous_exception_filter);
+
+      // When the process is exiting (which is when a DLL's statics are
+      // destroyed) ExitProcess has already killed the writer thread, possibly
+      // while it held one of the locks. It can't be stopped or joined then and
+      // the write lock is only waited on for a little while.
+      const bool writer_killed =
+         WaitForSingleObject(_thread.native_handle(), 0) == WAIT_OBJECT_0;
+
+      if (writer_killed) {
+         _thread.detach();
+      }
+      else {
+         // Stopped without the wake lock, if the writer misses the notify it
+         // still sees the stop within wake_interval.
+         _thread.request_stop();
+         _wake.notify_one();
+         _thread.join();
+      }
+
+      std::unique_lock lock{_write_mutex, std::defer_lock};
+
+      if (!lock.try_lock_for(std::chrono::seconds{1})) return;
+
+      drain();
+      write_suppression_summaries(Clock::time_point::max());
+      _file.flush();
+   }
+
+   Log_writer(const Log_writer&) = delete;
+   Log_writer& operator=(const Log_writer&) = delete;
+
+   Log_writer(Log_writer&&) = delete;
+   Log_writer& operator=(Log_writer&&) = delete;
+
+   static auto get() noexcept -> Log_writer&
+   {
+      static Log_writer writer;
+
+      return writer;
+   }
+
+   void push(const Log_level level, std::string message) noexcept
+   {
+      Log_record record{.level = level,
+                        .time = std::time(nullptr),
+                        .message = std::move(message)};
+
+      while (!_queue.try_push(record)) {
+         // Errors are rare and usually the most important thing in the log,
+         // wait for room for them. Anything else is dropped.
+         if (level != Log_level::error) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+
+            return;
+         }
+
+         wake_writer();
+         std::this_thread::yield();
+      }
+
+      wake_writer();
+   }
+
+   void flush_policy(const Log_flush_policy policy) noexcept
+   {
+      _flush_policy.store(policy, std::memory_order_relaxed);
+   }
+
+   void flush() noexcept
+   {
+      std::scoped_lock lock{_write_mutex};
+
+      drain();
+      _file.flush();
+   }
+
+private:
+   constexpr static auto wake_interval = std::chrono::milliseconds{100};
+   constexpr static auto periodic_flush_interval = std::chrono::seconds{1};
+   constexpr static auto rate_limit_window = std::chrono::seconds{1};
+   constexpr static std::size_t rate_limit_count = 16;
+
+   struct Rate_limit_state {
+      Clock::time_point window_start;
+      std::size_t count = 0;
+      std::size_t suppressed = 0;
+      Log_level level = Log_level::info;
+   };
+
+   // Only the first message since the writer last woke up needs to notify it,
+   // everything after that will be picked up by the same drain.
+   void wake_writer() noexcept
+   {
+      if (!_pending.exchange(true, std::memory_order_release)) _wake.notify_one();
+   }
+
+   void run(std::stop_token stop) noexcept
+   {
+      while (!stop.stop_requested()) {
+         {
+            std::unique_lock lock{_wake_mutex};
+
+            _wake.wait_for(lock, wake_interval, [&] {
+               return stop.stop_requested() ||
+                      _pending.exchange(false, std::memory_order_acquire);
+            });
+         }
+
+         std::scoped_lock lock{_write_mutex};
+
+         const bool wrote_important = drain();
+         const auto now = Clock::now();
+
+         write_suppression_summaries(now);
+
+         const auto policy = _flush_policy.load(std::memory_order_relaxed);
+
+         if (policy == Log_flush_policy::every_message ||
+             (policy == Log_flush_policy::errors && wrote_important) ||
+             (now - _last_flush) >= periodic_flush_interval) {
+            _file.flush();
+            _last_flush = now;
+         }
+      }
+   }
+
+   // Returns true if a warning or error was written.
+   bool drain() noexcept
+   {
+      bool wrote_important = false;
+
+      while (auto record = _queue.try_pop()) {
+         wrote_important |= record->level != Log_level::info;
+
+         write(*record);
+      }
+
+      if (const auto dropped = _dropped.exchange(0, std::memory_order_relaxed);
+          dropped != 0) {
+         write_repeat_count();
+         write_line(Log_level::warning, std::time(nullptr),
+                    fmt::format("{} log messages were dropped because the log "
+                                "queue was full."sv,
+                                dropped));
+      }
+
+      return wrote_important;
+   }
+
+   void write(Log_record& record) noexcept
+   {
+      if (record.level == _last_level && record.message == _last_message) {
+         _last_repeats += 1;
+
+         return;
+      }
+
+      write_repeat_count();
+
+      if (record.level != Log_level::error && rate_limited(record)) return;
+
+      write_line(record.level, record.time, record.message);
+
+      _last_level = record.level;
+      _last_message = std::move(record.message);
+   }
+
+   bool rate_limited(const Log_record& record) noexcept
+   {
+      const auto now = Clock::now();
+      auto& state = _rate_limits[record.message];
+
+      if ((now - state.window_start) >= rate_limit_window) {
+         write_suppression_summary(record.message, state);
+
+         state.window_start = now;
+         state.count = 0;
+      }
+
+      if (++state.count <= rate_limit_count) return false;
+
+      state.suppressed += 1;
+      state.level = record.level;
+
+      return true;
+   }
+
+   void write_repeat_count() noexcept
+   {
+      if (_last_repeats == 0) return;
+
+      write_line(_last_level, std::time(nullptr),
+                 fmt::format("Last message repeated {} times."sv, _last_repeats));
+
+      _last_repeats = 0;
+   }
+
+   void write_suppression_summaries(const Clock::time_point now) noexcept
+   {
+      for (auto it = _rate_limits.begin(); it != _rate_limits.end();) {
+         auto& [message, state] = *it;
+
+         if ((now - state.window_start) < rate_limit_window) {
+            ++it;
+
+            continue;
+         }
+
+         write_suppression_summary(message, state);
+
+         _rate_limits.erase(it++);
+      }
+   }
+
+   void write_suppression_summary(const std::string_view message,
+                                  Rate_limit_state& state) noexcept
+   {
+      if (state.suppressed == 0) return;
+
+      write_repeat_count();
+      write_line(state.level, std::time(nullptr),
+                 fmt::format("Suppressed {} more copies of: {}"sv, state.suppressed,
+                             message));
+
+      state.suppressed = 0;
+      _last_message.clear();
+   }
+
+   void write_line(const Log_level level, const std::time_t time,
+                   const std::string_view message) noexcept
+   {
+      if (time != _cached_time) {
+         std::tm local_time{};
+
+         localtime_s(&local_time, &time);
+
+         std::strftime(_cached_time_string.data(), _cached_time_string.size(), "%T",
+                       &local_time);
+
+         _cached_time = time;
+      }
+
+      _file << level << ' ' << _cached_time_string.data() << ' ' << message << '\n';
+   }
+
+   void drain_for_terminate() noexcept
+   {
+      // The writer thread may be the one terminating or crashing, in which case
+      // it could be holding the write lock already.
+      if (std::this_thread::get_id() == _thread.get_id()) {
+         drain();
+         _file.flush();
+
+         return;
+      }
+
+      std::unique_lock lock{_write_mutex, std::defer_lock};
+
+      if (!lock.try_lock_for(std::chrono::seconds{1})) return;
+
+      drain();
+      _file.flush();
+   }
+
+   std::ofstream _file;
+
+   Log_queue _queue;
+   std::atomic_size_t _dropped = 0;
+   std::atomic_bool _pending = false;
+   std::atomic<Log_flush_policy> _flush_policy = Log_flush_policy::errors;
+
+   std::mutex _wake_mutex;
+   std::condition_variable _wake;
+
+   // Held by whoever is currently consuming the queue and writing the file.
+   std::timed_mutex _write_mutex;
+
+   Log_level _last_level = Log_level::info;
+   std::string _last_message;
+   std::size_t _last_repeats = 0;
+   Clock::time_point _last_flush = Clock::now();
+   std::time_t _cached_time = -1;
+   std::array<char, 16> _cached_time_string{};
+   absl::flat_hash_map<std::string, Rate_limit_state> _rate_limits;
+
+   using Abort_handler = void(__cdecl*)(int);
+
+   Abort_handler _previous_abort_handler = nullptr;
+   LPTOP_LEVEL_EXCEPTION_FILTER _previous_exception_filter = nullptr;
+
+   // Declared last so the thread is joined before anything it uses is destroyed.
+   std::jthread _thread;
+};
+
+}
+
+void set_log_flush_policy(const Log_flush_policy policy) noexcept
+{
+   Log_writer::get().flush_policy(policy);
+}
+
+void flush_log() noexcept
+{
+   Log_writer::get().flush();
+}
+
+namespace detail {
+
+void queue_log_message(const Log_level level, std::string message) noexcept
+{
+   Log_writer::get().push(level, std::move(message));
+}
+
+}
+
+}
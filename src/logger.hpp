@@ -2,11 +2,13 @@
 
 #include "shader_patch_version.hpp"
 
+#include <cstdint>
 #include <ctime>
 #include <exception>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -37,45 +39,39 @@ inline std::ostream& operator<<(std::ostream& stream, const Log_level& level) no
    return stream;
 }
 
-class Logger {
-public:
-   Logger(const Logger&) = delete;
-   Logger& operator=(const Logger&) = delete;
-
-   Logger(Logger&&) = delete;
-   Logger& operator=(Logger&&) = delete;
+//! When the background log writer flushes the log file.
+enum class Log_flush_policy : std::int8_t {
+   //! After every batch of messages the writer picks up. Messages logged just
+   //! before a crash the log can't catch may still be lost as they only reach
+   //! the file once the writer wakes.
+   every_message,
+   //! After warnings and errors and otherwise once a second.
+   errors,
+   //! Once a second.
+   periodic
+};
 
-   friend auto get_log_stream() noexcept -> std::ostream&;
+void set_log_flush_policy(const Log_flush_policy policy) noexcept;
 
-private:
-   Logger() noexcept
-   {
-      _log_file.open(logger_path);
-      _log_file << "Shader Patch log started. Shader Patch version is "sv
-                << current_shader_patch_version_string << std::endl;
-   }
+//! Write out and flush every message logged so far. Blocks until done.
+void flush_log() noexcept;
 
-   std::ofstream _log_file;
-};
+namespace detail {
 
-inline auto get_log_stream() noexcept -> std::ostream&
-{
-   static Logger logger;
+//! Queue a message for the background log writer. Never blocks for warnings
+//! and info messages, if the queue is full they are dropped (and counted).
+void queue_log_message(const Log_level level, std::string message) noexcept;
 
-   return logger._log_file;
 }
 
 template<typename... Args>
 inline void log(const Log_level level, Args&&... args) noexcept
 {
-   auto& stream = get_log_stream();
-
-   const auto time = std::time(nullptr);
-   const auto local_time = std::localtime(&time);
+   std::ostringstream stream;
 
-   stream << level << ' ' << std::put_time(local_time, "%T") << ' ';
    (stream << ... << args);
-   stream << std::endl;
+
+   detail::queue_log_message(level, stream.str());
 }
 
 template<typename... Args>
@@ -83,14 +79,7 @@ inline void log_debug([[maybe_unused]] fmt::format_string<const Args&...> format
                       [[maybe_unused]] const Args&... args) noexcept
 {
 #ifndef NDEBUG
-   auto& stream = get_log_stream();
-
-   const auto time = std::time(nullptr);
-   const auto local_time = std::localtime(&time);
-
-   stream << Log_level::info << ' ' << std::put_time(local_time, "%T") << ' ';
-   stream << fmt::format(format_str, args...);
-   stream << '\n';
+   detail::queue_log_message(Log_level::info, fmt::format(format_str, args...));
 #endif
 }
 
@@ -98,20 +87,14 @@ template<typename... Args>
 inline void log_fmt(const Log_level level, fmt::format_string<const Args&...> format_str,
                     const Args&... args) noexcept
 {
-   auto& stream = get_log_stream();
-
-   const auto time = std::time(nullptr);
-   const auto local_time = std::localtime(&time);
-
-   stream << level << ' ' << std::put_time(local_time, "%T") << ' ';
-   stream << fmt::format(format_str, args...);
-   stream << std::endl;
+   detail::queue_log_message(level, fmt::format(format_str, args...));
 }
 
 template<typename... Args>
 [[noreturn]] inline void log_and_terminate(Args&&... args)
 {
    log(Log_level::error, std::forward<Args>(args)...);
+   flush_log();
 
    std::terminate();
 }
@@ -121,6 +104,7 @@ template<typename... Args>
                                                const Args&... args)
 {
    log_fmt(Log_level::error, format_str, args...);
+   flush_log();
 
    std::terminate();
 }
@@ -82,8 +82,11 @@ void property_editor(const std::string& name, Material_var<bool>& var) noexcept
    ImGui::Checkbox(name.c_str(), &var.value);
 }
 
-void material_editor(Factory& factory, Material& material) noexcept
+// Returns true if the material's shader resources were changed.
+bool material_editor(Factory& factory, Material& material) noexcept
 {
+   bool resources_changed = false;
+
    if (!material.properties.empty() && ImGui::TreeNode("Properties")) {
       for (auto& prop : material.properties) {
          std::visit([&](auto& value) { property_editor(prop.name, value); },
@@ -100,8 +103,9 @@ void material_editor(Factory& factory, Material& material) noexcept
             const core::Shader_resource_database::Imgui_pick_result picked =
                factory.shader_resource_database().imgui_resource_picker();
 
-            if (picked.srv) {
+            if (picked.srv && value != picked.name) {
                value = picked.name;
+               resources_changed = true;
             }
 
             ImGui::EndCombo();
@@ -120,21 +124,31 @@ void material_editor(Factory& factory, Material& material) noexcept
    }
 
    factory.update_material(material);
+
+   return resources_changed;
 }
 }
 
-void show_editor(Factory& factory,
+auto show_editor(Factory& factory,
                  const std::vector<std::unique_ptr<Material>>& materials) noexcept
+   -> std::vector<Material*>
 {
+   std::vector<Material*> resources_changed;
+
    if (ImGui::Begin("Materials")) {
       for (auto& material : materials) {
          if (ImGui::TreeNode(material->name.c_str())) {
-            material_editor(factory, *material);
+            if (material_editor(factory, *material)) {
+               resources_changed.push_back(material.get());
+            }
+
             ImGui::TreePop();
          }
       }
    }
 
    ImGui::End();
+
+   return resources_changed;
 }
 }
@@ -9,6 +9,9 @@
 
 namespace sp::material {
 
-void show_editor(Factory& factory,
-                 const std::vector<std::unique_ptr<Material>>& materials) noexcept;
+//! Show the material editor. Returns the materials that had their shader
+//! resources changed.
+auto show_editor(Factory& factory,
+                 const std::vector<std::unique_ptr<Material>>& materials) noexcept
+   -> std::vector<Material*>;
 }
@@ -0,0 +1,131 @@
+
+#include "resource_tracker.hpp"
+
+#include <algorithm>
+
+using namespace std::literals;
+
+namespace sp::material {
+
+void Resource_tracker::track(Material& material) noexcept
+{
+   auto resources = referenced_resources(material);
+
+   for (const auto& resource : resources) {
+      _dependents[resource].insert(&material);
+   }
+
+   _material_resources[&material] = std::move(resources);
+}
+
+void Resource_tracker::untrack(Material& material) noexcept
+{
+   _dirty.erase(&material);
+
+   auto it = _material_resources.find(&material);
+
+   if (it == _material_resources.end()) return;
+
+   for (const auto& resource : it->second) {
+      auto dependents = _dependents.find(resource);
+
+      if (dependents == _dependents.end()) continue;
+
+      dependents->second.erase(&material);
+
+      if (dependents->second.empty()) _dependents.erase(dependents);
+   }
+
+   _material_resources.erase(it);
+}
+
+void Resource_tracker::retrack(Material& material) noexcept
+{
+   if (auto it = _material_resources.find(&material);
+       it != _material_resources.end() &&
+       it->second == referenced_resources(material)) {
+      return;
+   }
+
+   const bool dirty = _dirty.contains(&material);
+
+   untrack(material);
+   track(material);
+
+   if (dirty) _dirty.insert(&material);
+}
+
+void Resource_tracker::mark_dirty(const std::string_view resource_name) noexcept
+{
+   auto it = _dependents.find(resource_name);
+
+   if (it == _dependents.end()) return;
+
+   _dirty.insert(it->second.begin(), it->second.end());
+}
+
+void Resource_tracker::mark_all_dirty() noexcept
+{
+   for (const auto& [material, resources] : _material_resources) {
+      _dirty.insert(material);
+   }
+}
+
+auto Resource_tracker::update(const core::Shader_resource_database& resource_database) noexcept
+   -> std::size_t
+{
+   const auto rebound = _dirty.size();
+
+   for (auto* material : _dirty) {
+      material->update_resources(resource_database);
+   }
+
+   _dirty.clear();
+
+   _stats.rebound_last_update = rebound;
+   _stats.rebound_total += rebound;
+
+   return rebound;
+}
+
+auto Resource_tracker::stats() const noexcept -> Stats
+{
+   return _stats;
+}
+
+auto Resource_tracker::resource_key(const std::string_view name) noexcept -> std::string
+{
+   // Materials refer to builtins as "$name", the database stores them as "_SP_BUILTIN_name".
+   if (name.starts_with('$')) {
+      std::string key{"_SP_BUILTIN_"sv};
+      key.append(name.substr(1));
+
+      return key;
+   }
+
+   return std::string{name};
+}
+
+auto Resource_tracker::referenced_resources(const Material& material) noexcept
+   -> std::vector<std::string>
+{
+   std::vector<std::string> resources;
+   resources.reserve(material.vs_shader_resources_names.size() +
+                     material.ps_shader_resources_names.size());
+
+   for (const auto* names :
+        {&material.vs_shader_resources_names, &material.ps_shader_resources_names}) {
+      for (const auto& name : *names) {
+         if (name.empty()) continue;
+
+         resources.emplace_back(resource_key(name));
+      }
+   }
+
+   std::sort(resources.begin(), resources.end());
+   resources.erase(std::unique(resources.begin(), resources.end()), resources.end());
+
+   return resources;
+}
+
+}
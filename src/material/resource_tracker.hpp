@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../core/texture_database.hpp"
+#include "material.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+
+namespace sp::material {
+
+//! Tracks which materials reference which shader resources so that when a
+//! resource is inserted, replaced or erased only the materials that depend on
+//! it have their resources rebound.
+class Resource_tracker {
+public:
+   struct Stats {
+      std::size_t rebound_last_update = 0;
+      std::size_t rebound_total = 0;
+   };
+
+   void track(Material& material) noexcept;
+
+   void untrack(Material& material) noexcept;
+
+   //! Refresh the resources tracked for a material after its resource names
+   //! may have changed (for instance from the material editor).
+   void retrack(Material& material) noexcept;
+
+   void mark_dirty(const std::string_view resource_name) noexcept;
+
+   void mark_all_dirty() noexcept;
+
+   //! Rebind the resources of every dirty material. Returns the number of materials rebound.
+   auto update(const core::Shader_resource_database& resource_database) noexcept
+      -> std::size_t;
+
+   auto stats() const noexcept -> Stats;
+
+private:
+   static auto resource_key(const std::string_view name) noexcept -> std::string;
+
+   static auto referenced_resources(const Material& material) noexcept
+      -> std::vector<std::string>;
+
+   absl::flat_hash_map<std::string, absl::flat_hash_set<Material*>> _dependents;
+   absl::flat_hash_map<Material*, std::vector<std::string>> _material_resources;
+   absl::flat_hash_set<Material*> _dirty;
+
+   Stats _stats;
+};
+
+}
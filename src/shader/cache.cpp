@@ -1,68 +1,326 @@
 #include "cache.hpp"
 #include "../logger.hpp"
 #include "binary_io_winapi.hpp"
+#include "memory_mapped_file.hpp"
 #include "shader_patch_version.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
 #include <functional>
+#include <optional>
 #include <ranges>
 #include <span>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 using namespace std::literals;
-using std::filesystem::file_time_type;
 
 namespace sp::shader {
 
+namespace {
+
+// The cache file is laid out as a header, a flat table of entries, a table
+// of entrypoint hashes, a string section and then a blob section holding all
+// the bytecode. Every table refers into the later sections by offset so the
+// whole file can be written in one go and read straight out of a mapping.
+
+constexpr std::uint32_t cache_file_magic = 0x43535053; // "SPSC"
+
+// Bumped whenever the layout of the cache file changes.
+constexpr std::uint32_t cache_file_version = 3;
+
+constexpr std::size_t cache_file_blob_alignment = 16;
+
+struct Cache_file_header {
+   std::uint32_t magic;
+   std::uint32_t version;
+   Shader_patch_version shader_patch_version;
+
+   std::uint64_t entry_count;
+   std::uint64_t entries_offset;
+   std::uint64_t hash_count;
+   std::uint64_t hashes_offset;
+   std::uint64_t strings_offset;
+   std::uint64_t strings_size;
+   std::uint64_t blobs_offset;
+   std::uint64_t blobs_size;
+};
+
+struct Cache_file_string {
+   std::uint32_t offset;
+   std::uint32_t size;
+};
+
+struct Cache_file_entry {
+   Stage stage;
+   Vertex_shader_flags game_flags;
+   Cache_file_string group;
+   Cache_file_string entrypoint;
+   std::uint64_t static_flags;
+   std::uint64_t bytecode_offset;
+   std::uint64_t bytecode_size;
+};
+
+struct Cache_file_entrypoint_hash {
+   Cache_file_string group;
+   Cache_file_string entrypoint;
+   std::uint64_t hash;
+};
+
+static_assert(std::is_trivially_copyable_v<Cache_file_header>);
+static_assert(std::is_trivially_copyable_v<Cache_file_entry>);
+static_assert(std::is_trivially_copyable_v<Cache_file_entrypoint_hash>);
+
+class Cache_file_view {
+public:
+   explicit Cache_file_view(const std::span<const std::byte> bytes) noexcept
+      : _bytes{bytes}
+   {
+   }
+
+   template<typename T>
+   auto read(const std::uint64_t offset) const -> T
+   {
+      T value;
+
+      std::memcpy(&value, span(offset, sizeof(T)).data(), sizeof(T));
+
+      return value;
+   }
+
+   auto span(const std::uint64_t offset, const std::uint64_t size) const
+      -> std::span<const std::byte>
+   {
+      if (offset > _bytes.size() || size > (_bytes.size() - offset)) {
+         throw std::runtime_error{"Shader cache file is truncated or corrupt."};
+      }
+
+      return _bytes.subspan(static_cast<std::size_t>(offset),
+                            static_cast<std::size_t>(size));
+   }
+
+private:
+   std::span<const std::byte> _bytes;
+};
+
+// Hashes here are saved to disk so they can not use absl::Hash, which is
+// seeded differently on every run.
+class Stable_hasher {
+public:
+   void add(const std::string_view str) noexcept
+   {
+      add(str.size());
+
+      for (const char c : str) add_byte(static_cast<std::uint8_t>(c));
+   }
+
+   template<typename T>
+      requires std::is_trivially_copyable_v<T>
+   void add(const T& value) noexcept
+   {
+      for (const auto byte : std::bit_cast<std::array<std::uint8_t, sizeof(T)>>(value)) {
+         add_byte(byte);
+      }
+   }
+
+   auto result() const noexcept -> std::uint64_t
+   {
+      return _hash;
+   }
+
+private:
+   void add_byte(const std::uint8_t byte) noexcept
+   {
+      _hash ^= byte;
+      _hash *= 0x100000001b3ull;
+   }
+
+   std::uint64_t _hash = 0xcbf29ce484222325ull;
+};
+
+auto hash_entrypoint(const Entrypoint_description& entrypoint,
+                     const std::uint64_t source_hash) noexcept -> std::uint64_t
+{
+   Stable_hasher hasher;
+
+   hasher.add(source_hash);
+   hasher.add(entrypoint.function_name);
+   hasher.add(entrypoint.source_name);
+   hasher.add(entrypoint.stage);
+
+   const auto& vertex_state = entrypoint.vertex_state;
+
+   hasher.add(vertex_state.use_custom_input_layout);
+   hasher.add(vertex_state.custom_input_layout.size());
+
+   for (const auto& element : vertex_state.custom_input_layout) {
+      hasher.add(element.semantic_name);
+      hasher.add(element.semantic_index);
+      hasher.add(element.input_type);
+   }
+
+   const auto& input_state = vertex_state.generic_input_state;
+
+   for (const bool input : {input_state.position, input_state.skinned,
+                            input_state.normal, input_state.tangents,
+                            input_state.tangents_unflagged, input_state.color,
+                            input_state.texture_coords}) {
+      hasher.add(input);
+   }
+
+   const auto static_flags = entrypoint.static_flags.as_span();
+
+   hasher.add(static_flags.size());
+
+   for (const auto& flag : static_flags) hasher.add(flag);
+
+   hasher.add(entrypoint.preprocessor_defines.size());
+
+   for (const auto& define : entrypoint.preprocessor_defines) {
+      hasher.add(define.name);
+      hasher.add(define.definition);
+   }
+
+   return hasher.result();
+}
+
+}
+
 Cache::Cache(ID3D11Device5& device, const std::filesystem::path& cache_path) noexcept
 {
    load_from_file(device, cache_path);
 }
 
-void Cache::clear_stale_entries(const Source_file_dependency_index& dependency_index,
-                                const Source_file_store& file_store,
-                                const std::span<const Group_definition> groups) noexcept
+void Cache::clear_stale_entries(const Entrypoint_descriptions& entrypoints,
+                                const Source_file_dependency_index& dependency_index,
+                                const Source_file_store& file_store) noexcept
 {
    std::lock_guard lock{_mutex};
 
-   absl::flat_hash_set<std::string_view> dependents;
-   dependents.reserve(file_store.size());
+   absl::flat_hash_map<std::string_view, std::uint64_t> file_hashes;
+   file_hashes.reserve(file_store.size());
+
+   for (const auto& file : file_store.get_range()) {
+      Stable_hasher hasher;
+
+      hasher.add(file.data);
+
+      file_hashes.emplace(file.name, hasher.result());
+   }
 
-   for (auto& group : groups) {
-      if (group.last_write_time > std::exchange(_group_last_write_times[group.group_name],
-                                                group.last_write_time)) {
-         invalidate_group_nolock(group.group_name);
-         continue;
+   absl::flat_hash_map<std::string_view, std::uint64_t> source_hashes;
+
+   const auto get_source_hash = [&](const std::string_view source_name) noexcept {
+      if (auto it = source_hashes.find(source_name); it != source_hashes.end()) {
+         return it->second;
       }
 
-      dependents.clear();
+      absl::flat_hash_set<std::string_view> dependencies;
 
-      const auto add_dependents = [&](const auto& add_dependents,
-                                      const std::string_view file) noexcept {
-         auto [iter, inserted] = dependents.insert(file);
+      const auto add_dependencies = [&](const auto& add_dependencies,
+                                        const std::string_view file) noexcept {
+         auto [iter, inserted] = dependencies.insert(file);
 
          if (!inserted) return;
 
-         for (const auto& dependent_file : dependency_index[file]) {
-            add_dependents(add_dependents, dependent_file);
+         for (const auto& dependency : dependency_index[file]) {
+            add_dependencies(add_dependencies, dependency);
          }
       };
 
-      add_dependents(add_dependents, group.source_name);
+      add_dependencies(add_dependencies, source_name);
 
-      for (const auto& dependent : dependents) {
-         if (file_store.last_write_time(dependent) >
-             _shader_last_write_times[dependent]) {
-            invalidate_group_nolock(group.group_name);
-            break;
+      std::vector<std::string_view> sorted_dependencies{dependencies.begin(),
+                                                        dependencies.end()};
+
+      std::ranges::sort(sorted_dependencies);
+
+      Stable_hasher hasher;
+
+      for (const auto& dependency : sorted_dependencies) {
+         const auto file_hash = file_hashes.find(dependency);
+
+         hasher.add(dependency);
+         hasher.add(file_hash != file_hashes.end() ? file_hash->second : 0ull);
+      }
+
+      source_hashes.emplace(source_name, hasher.result());
+
+      return hasher.result();
+   };
+
+   Entrypoint_hashes current_hashes;
+   std::size_t changed_entrypoints = 0;
+   std::size_t total_entrypoints = 0;
+
+   for (const auto& [group_name, group_entrypoints] : entrypoints) {
+      auto& group_hashes = current_hashes[group_name];
+
+      for (const auto& [entrypoint_name, entrypoint] : group_entrypoints) {
+         const auto hash =
+            hash_entrypoint(entrypoint, get_source_hash(entrypoint.source_name));
+
+         group_hashes[entrypoint_name] = hash;
+
+         const auto previous_group = _entrypoint_hashes.find(group_name);
+
+         if (previous_group == _entrypoint_hashes.end() ||
+             !previous_group->second.contains(entrypoint_name) ||
+             previous_group->second.at(entrypoint_name) != hash) {
+            changed_entrypoints += 1;
          }
+
+         total_entrypoints += 1;
       }
    }
 
-   _shader_last_write_times.clear();
+   const auto find_hash = [](const Entrypoint_hashes& hashes,
+                             const std::string_view group_name,
+                             const std::string_view entrypoint_name) noexcept
+      -> std::optional<std::uint64_t> {
+      if (auto group = hashes.find(group_name); group != hashes.end()) {
+         if (auto entrypoint = group->second.find(entrypoint_name);
+             entrypoint != group->second.end()) {
+            return entrypoint->second;
+         }
+      }
 
-   for (const auto& file : file_store.get_range()) {
-      _shader_last_write_times[file.name] = file.last_write_time;
-   }
+      return std::nullopt;
+   };
+
+   const auto is_stale = [&](const auto& key_value) noexcept {
+      const auto& index = key_value.first;
+      const auto previous_hash =
+         find_hash(_entrypoint_hashes, index.group, index.entrypoint);
+
+      return !previous_hash ||
+             previous_hash != find_hash(current_hashes, index.group, index.entrypoint);
+   };
+
+   const auto total_entries = [this] {
+      return _vs_cache.size() + _cs_cache.size() + _ds_cache.size() +
+             _hs_cache.size() + _gs_cache.size() + _ps_cache.size();
+   };
+
+   const std::size_t loaded_entries = total_entries();
+
+   const auto clear_stale = [&](auto&... caches) noexcept {
+      (erase_if(caches, is_stale), ...);
+   };
+
+   clear_stale(_vs_cache, _cs_cache, _ds_cache, _hs_cache, _gs_cache, _ps_cache);
+
+   const std::size_t reused_entries = total_entries();
+   const std::size_t stale_entries = loaded_entries - reused_entries;
+
+   _entrypoint_hashes = std::move(current_hashes);
+
+   log_fmt(Log_level::info,
+           "Shader bytecode cache has {} reusable entries and {} stale entries. {} of {} entrypoints changed."sv,
+           reused_entries, stale_entries, changed_entrypoints, total_entrypoints);
 }
 
 void Cache::save_to_file(const std::filesystem::path& cache_path)
@@ -72,52 +330,111 @@ void Cache::save_to_file(const std::filesystem::path& cache_path)
    try {
       const auto write_path = std::filesystem::path{cache_path} += L".TEMP"sv;
 
-      Binary_writer file{write_path};
+      std::vector<Cache_file_entry> entries;
+      std::vector<Cache_file_entrypoint_hash> hashes;
+      std::string strings;
+      std::vector<std::byte> blobs;
 
-      file.write(current_shader_patch_version.major,
-                 current_shader_patch_version.minor,
-                 current_shader_patch_version.patch,
-                 current_shader_patch_version.prerelease_stage,
-                 current_shader_patch_version.prerelease);
+      entries.reserve(_vs_cache.size() + _cs_cache.size() + _ds_cache.size() +
+                      _hs_cache.size() + _gs_cache.size() + _ps_cache.size());
 
-      const auto write_stage_cache =
-         [&file]<typename K, typename V>(const Basic_cache_map<K, V>& cache) {
-            file.write(cache.size());
+      absl::flat_hash_map<std::string_view, Cache_file_string> string_offsets;
 
+      const auto add_string = [&](const std::string_view string) {
+         if (auto it = string_offsets.find(string); it != string_offsets.end()) {
+            return it->second;
+         }
+
+         const Cache_file_string file_string{.offset = static_cast<std::uint32_t>(
+                                                strings.size()),
+                                             .size = static_cast<std::uint32_t>(
+                                                string.size())};
+
+         strings += string;
+         string_offsets.emplace(string, file_string);
+
+         return file_string;
+      };
+
+      const auto add_stage_cache =
+         [&]<typename K, typename V>(const Stage stage,
+                                     const Basic_cache_map<K, V>& cache) {
             for (const auto& [index, entry] : cache) {
-               file.write(index.group.size(), index.group);
-               file.write(index.entrypoint.size(), index.entrypoint);
-               file.write(index.static_flags);
+               blobs.resize((blobs.size() + (cache_file_blob_alignment - 1)) &
+                            ~(cache_file_blob_alignment - 1));
+
+               const auto bytecode_offset = blobs.size();
+
+               blobs.insert(blobs.end(), entry.bytecode.begin(), entry.bytecode.end());
+
+               entries.push_back(
+                  {.stage = stage,
+                   .game_flags = Vertex_shader_flags::none,
+                   .group = add_string(index.group),
+                   .entrypoint = add_string(index.entrypoint),
+                   .static_flags = index.static_flags,
+                   .bytecode_offset = bytecode_offset,
+                   .bytecode_size = entry.bytecode.size()});
 
                if constexpr (std::is_same_v<K, Cache_index_vs>) {
-                  file.write(index.game_flags);
+                  entries.back().game_flags = index.game_flags;
                }
-
-               file.write(entry.bytecode.size(), entry.bytecode);
             }
          };
 
-      write_stage_cache(_cs_cache);
-      write_stage_cache(_vs_cache);
-      write_stage_cache(_ds_cache);
-      write_stage_cache(_hs_cache);
-      write_stage_cache(_gs_cache);
-      write_stage_cache(_ps_cache);
-
-      // write last write times
-      const auto write_last_writes =
-         [&file](const absl::flat_hash_map<std::string, std::filesystem::file_time_type>& last_writes) {
-            file.write(last_writes.size());
-
-            for (const auto& [name, last_write_time] : last_writes) {
-               file.write(name.size(), name);
-               file.write(last_write_time.time_since_epoch().count());
-            }
-         };
+      add_stage_cache(Stage::compute, _cs_cache);
+      add_stage_cache(Stage::vertex, _vs_cache);
+      add_stage_cache(Stage::domain, _ds_cache);
+      add_stage_cache(Stage::hull, _hs_cache);
+      add_stage_cache(Stage::geometry, _gs_cache);
+      add_stage_cache(Stage::pixel, _ps_cache);
+
+      for (const auto& [group_name, group_hashes] : _entrypoint_hashes) {
+         for (const auto& [entrypoint_name, hash] : group_hashes) {
+            hashes.push_back({.group = add_string(group_name),
+                              .entrypoint = add_string(entrypoint_name),
+                              .hash = hash});
+         }
+      }
+
+      Cache_file_header header{.magic = cache_file_magic,
+                               .version = cache_file_version,
+                               .shader_patch_version = current_shader_patch_version,
+                               .entry_count = entries.size(),
+                               .hash_count = hashes.size(),
+                               .strings_size = strings.size(),
+                               .blobs_size = blobs.size()};
+
+      header.entries_offset = sizeof(Cache_file_header);
+      header.hashes_offset =
+         header.entries_offset + entries.size() * sizeof(Cache_file_entry);
+      header.strings_offset =
+         header.hashes_offset + hashes.size() * sizeof(Cache_file_entrypoint_hash);
+      header.blobs_offset =
+         (header.strings_offset + strings.size() + (cache_file_blob_alignment - 1)) &
+         ~std::uint64_t{cache_file_blob_alignment - 1};
+
+      std::vector<std::byte> file_data;
+      file_data.resize(static_cast<std::size_t>(header.blobs_offset + blobs.size()));
+
+      const auto copy_to_file_data = [&](const std::uint64_t offset,
+                                         const void* data, const std::size_t size) {
+         if (size != 0) {
+            std::memcpy(file_data.data() + offset, data, size);
+         }
+      };
+
+      copy_to_file_data(0, &header, sizeof(Cache_file_header));
+      copy_to_file_data(header.entries_offset, entries.data(),
+                        entries.size() * sizeof(Cache_file_entry));
+      copy_to_file_data(header.hashes_offset, hashes.data(),
+                        hashes.size() * sizeof(Cache_file_entrypoint_hash));
+      copy_to_file_data(header.strings_offset, strings.data(), strings.size());
+      copy_to_file_data(header.blobs_offset, blobs.data(), blobs.size());
 
-      write_last_writes(_group_last_write_times);
-      write_last_writes(_shader_last_write_times);
+      Binary_writer file{write_path};
 
+      file.write(file_data);
       file.close();
 
       std::filesystem::rename(write_path, cache_path);
@@ -138,90 +455,118 @@ void Cache::load_from_file(ID3D11Device5& device, const std::filesystem::path& c
    }
 
    try {
-      Binary_reader file{cache_path};
-
-      Shader_patch_version cache_sp_version{};
-
-      file.read_to(cache_sp_version.major, cache_sp_version.minor,
-                   cache_sp_version.patch, cache_sp_version.prerelease_stage,
-                   cache_sp_version.prerelease);
-
-      if (cache_sp_version != current_shader_patch_version) return;
-
-      const auto read_string = [&file](auto& out) {
-         out.resize(file.read<std::size_t>());
-
-         file.read_to(out);
-      };
+      const Memory_mapped_file mapping{cache_path, Memory_mapped_file::Mode::read,
+                                       Memory_mapped_file::Access_hint::sequential};
+      const Cache_file_view file{mapping.bytes()};
 
-      const auto read_stage_cache =
-         [&]<typename K, typename V>(Basic_cache_map<K, V>& cache, auto create) {
-            const auto entry_count = file.read<std::size_t>();
+      const auto header = file.read<Cache_file_header>(0);
 
-            for (std::size_t i = 0; i < entry_count; ++i) {
+      if (header.magic != cache_file_magic || header.version != cache_file_version) {
+         return;
+      }
 
-               K index;
+      if (header.shader_patch_version != current_shader_patch_version) return;
 
-               read_string(index.group);
-               read_string(index.entrypoint);
+      const auto strings = file.span(header.strings_offset, header.strings_size);
+      const auto blobs = file.span(header.blobs_offset, header.blobs_size);
 
-               file.read_to(index.static_flags);
+      const auto get_string = [&](const Cache_file_string string) {
+         if (string.offset > strings.size() ||
+             string.size > (strings.size() - string.offset)) {
+            throw std::runtime_error{"Shader cache file is truncated or corrupt."};
+         }
 
-               if constexpr (std::is_same_v<K, Cache_index_vs>) {
-                  file.read_to(index.game_flags);
-               }
+         return std::string{reinterpret_cast<const char*>(strings.data()) + string.offset,
+                            string.size};
+      };
 
-               Bytecode_blob bytecode{file.read<std::size_t>()};
+      const auto get_bytecode = [&](const Cache_file_entry& entry) {
+         return Cache_file_view{blobs}.span(entry.bytecode_offset, entry.bytecode_size);
+      };
 
-               file.read_to(bytecode);
+      // The shader is created straight from the mapped bytecode, which is then
+      // only copied out of the mapping if creation succeeded.
+      const auto load_entry =
+         [&]<typename K, typename V>(Basic_cache_map<K, V>& cache, K index,
+                                     const std::span<const std::byte> bytecode_span,
+                                     auto create) {
+            Com_ptr<V> shader;
+
+            if (const auto result =
+                   std::invoke(create, device, bytecode_span.data(),
+                               bytecode_span.size(), nullptr, shader.clear_and_assign());
+                FAILED(result)) {
+               log_debug("Failed to create shader from cached bytecode {}:{}({:x})"sv,
+                         index.group, index.entrypoint, index.static_flags);
 
-               Com_ptr<V> shader;
+               return;
+            }
 
-               if (const auto result =
-                      std::invoke(create, device, bytecode.data(), bytecode.size(),
-                                  nullptr, shader.clear_and_assign());
-                   FAILED(result)) {
-                  log_debug("Failed to create shader from cached bytecode {}:{}({:x})"sv,
-                            index.group, index.entrypoint, index.static_flags);
+            log_debug("Loaded and created cached shader {}:{}({:x})"sv,
+                      index.group, index.entrypoint, index.static_flags);
 
-                  return;
-               }
+            Bytecode_blob bytecode{bytecode_span.size()};
 
-               log_debug("Loaded and created cached shader {}:{}({:x})"sv,
-                         index.group, index.entrypoint, index.static_flags);
+            std::memcpy(bytecode.data(), bytecode_span.data(), bytecode_span.size());
 
-               cache.emplace(std::move(index),
-                             Cache_entry<V>{.shader = std::move(shader),
-                                            .bytecode = std::move(bytecode)});
-            }
+            cache.emplace(std::move(index),
+                          Cache_entry<V>{.shader = std::move(shader),
+                                         .bytecode = std::move(bytecode)});
          };
 
-      read_stage_cache(_cs_cache, &ID3D11Device5::CreateComputeShader);
-      read_stage_cache(_vs_cache, &ID3D11Device5::CreateVertexShader);
-      read_stage_cache(_ds_cache, &ID3D11Device5::CreateDomainShader);
-      read_stage_cache(_hs_cache, &ID3D11Device5::CreateHullShader);
-      read_stage_cache(_gs_cache, &ID3D11Device5::CreateGeometryShader);
-      read_stage_cache(_ps_cache, &ID3D11Device5::CreatePixelShader);
+      for (std::uint64_t i = 0; i < header.entry_count; ++i) {
+         const auto entry = file.read<Cache_file_entry>(
+            header.entries_offset + i * sizeof(Cache_file_entry));
 
-      // read last write times
-      const auto read_last_writes =
-         [&](absl::flat_hash_map<std::string, std::filesystem::file_time_type>& last_writes) {
-            const auto count = file.read<std::size_t>();
+         const auto bytecode = get_bytecode(entry);
 
-            last_writes.reserve(count);
+         Cache_index index{.group = get_string(entry.group),
+                           .entrypoint = get_string(entry.entrypoint),
+                           .static_flags = entry.static_flags};
 
-            for (std::size_t i = 0; i < count; ++i) {
-               std::string name;
+         switch (entry.stage) {
+         case Stage::compute:
+            load_entry(_cs_cache, std::move(index), bytecode,
+                       &ID3D11Device5::CreateComputeShader);
+            break;
+         case Stage::vertex:
+            load_entry(_vs_cache,
+                       Cache_index_vs{.group = std::move(index.group),
+                                      .entrypoint = std::move(index.entrypoint),
+                                      .static_flags = index.static_flags,
+                                      .game_flags = entry.game_flags},
+                       bytecode, &ID3D11Device5::CreateVertexShader);
+            break;
+         case Stage::hull:
+            load_entry(_hs_cache, std::move(index), bytecode,
+                       &ID3D11Device5::CreateHullShader);
+            break;
+         case Stage::domain:
+            load_entry(_ds_cache, std::move(index), bytecode,
+                       &ID3D11Device5::CreateDomainShader);
+            break;
+         case Stage::geometry:
+            load_entry(_gs_cache, std::move(index), bytecode,
+                       &ID3D11Device5::CreateGeometryShader);
+            break;
+         case Stage::pixel:
+            load_entry(_ps_cache, std::move(index), bytecode,
+                       &ID3D11Device5::CreatePixelShader);
+            break;
+         default:
+            throw std::runtime_error{"Shader cache file is truncated or corrupt."};
+         }
+      }
 
-               read_string(name);
+      _entrypoint_hashes.reserve(static_cast<std::size_t>(header.hash_count));
 
-               last_writes[std::move(name)] = file_time_type{file_time_type::duration{
-                  file.read<file_time_type::duration::rep>()}};
-            }
-         };
+      for (std::uint64_t i = 0; i < header.hash_count; ++i) {
+         const auto hash = file.read<Cache_file_entrypoint_hash>(
+            header.hashes_offset + i * sizeof(Cache_file_entrypoint_hash));
 
-      read_last_writes(_group_last_write_times);
-      read_last_writes(_shader_last_write_times);
+         _entrypoint_hashes[get_string(hash.group)][get_string(hash.entrypoint)] =
+            hash.hash;
+      }
    }
    catch (std::exception&) {
       log(Log_level::warning,
@@ -2,12 +2,13 @@
 
 #include "bytecode_blob.hpp"
 #include "com_ptr.hpp"
-#include "group_definition.hpp"
+#include "entrypoint_description.hpp"
 #include "source_file_dependency_index.hpp"
 #include "source_file_store.hpp"
 
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 #include <shared_mutex>
 #include <tuple>
 #include <vector>
@@ -74,7 +75,7 @@ public:
    template<typename T>
    auto get_if(const std::string_view group_name, const std::string_view entrypoint_name,
                const std::uint64_t static_flags) const noexcept
-      -> const Cache_entry<T>*
+      -> std::optional<Cache_entry<T>>
    {
       std::shared_lock lock{_mutex};
 
@@ -86,7 +87,7 @@ public:
                   const std::string_view entrypoint_name,
                   const std::uint64_t static_flags,
                   const Vertex_shader_flags game_flags) const noexcept
-      -> const Cache_entry<ID3D11VertexShader>*
+      -> std::optional<Cache_entry<ID3D11VertexShader>>
    {
       std::shared_lock lock{_mutex};
 
@@ -126,9 +127,15 @@ public:
       invalidate_group_nolock(group);
    }
 
-   void clear_stale_entries(const Source_file_dependency_index& dependency_index,
-                            const Source_file_store& file_store,
-                            const std::span<const Group_definition> groups) noexcept;
+   using Entrypoint_descriptions =
+      absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, Entrypoint_description>>;
+
+   //! \brief Remove any entries whose entrypoint has changed since they were
+   //! compiled. An entrypoint is considered changed when it's description or
+   //! the contents of any source file it (transitively) includes changes.
+   void clear_stale_entries(const Entrypoint_descriptions& entrypoints,
+                            const Source_file_dependency_index& dependency_index,
+                            const Source_file_store& file_store) noexcept;
 
    void save_to_file(const std::filesystem::path& cache_path);
 
@@ -151,13 +158,6 @@ private:
        ...);
    }
 
-   struct Group_info {
-      bool dirty = true;
-      std::string name;
-      std::string source_name;
-      std::filesystem::file_time_type desc_last_write{};
-   };
-
    struct Hash_transparent {
       using is_transparent = void;
 
@@ -177,15 +177,17 @@ private:
 
    using Cache_map_vs = Basic_cache_map<Cache_index_vs, ID3D11VertexShader>;
 
+   // Entries are returned by copy as other threads may add to the cache (and
+   // rehash it) as soon as the lock is released.
    template<typename C, typename K>
    auto get_if_impl(const C& container, K k) const noexcept
-      -> std::add_pointer_t<const typename C::mapped_type>
+      -> std::optional<typename C::mapped_type>
    {
       if (auto it = container.find(k); it != container.end()) {
-         return &it->second;
+         return it->second;
       }
 
-      return nullptr;
+      return std::nullopt;
    }
 
    template<typename T, typename S>
@@ -219,8 +221,10 @@ private:
    Cache_map<ID3D11GeometryShader> _gs_cache;
    Cache_map<ID3D11PixelShader> _ps_cache;
 
-   absl::flat_hash_map<std::string, std::filesystem::file_time_type> _group_last_write_times;
-   absl::flat_hash_map<std::string, std::filesystem::file_time_type> _shader_last_write_times;
+   using Entrypoint_hashes =
+      absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, std::uint64_t>>;
+
+   Entrypoint_hashes _entrypoint_hashes;
 };
 
 }
@@ -1,7 +1,7 @@
 
 #include "compiler.hpp"
+#include "../effects/cpu_profiler.hpp"
 #include "../logger.hpp"
-#include "retry_dialog.hpp"
 
 #include <type_traits>
 
@@ -150,14 +150,20 @@ auto get_target(const Entrypoint_description& entrypoint) -> const char*
 
 }
 
-auto compile(Source_file_store& file_store, const Entrypoint_description& entrypoint,
-             const std::uint64_t static_flags,
-             const Vertex_shader_flags vertex_shader_flags) noexcept -> Bytecode_blob
+auto compile(Source_file_store& file_store, std::shared_mutex& file_store_mutex,
+             const Entrypoint_description& entrypoint, const std::uint64_t static_flags,
+             const Vertex_shader_flags vertex_shader_flags) noexcept -> Compile_result
 {
+   static const auto profile_section =
+      effects::cpu_profiler().section("shader::compile"sv);
+   effects::Cpu_profile profile{effects::cpu_profiler(), profile_section};
+
+   std::shared_lock file_store_lock{file_store_mutex};
+
    auto source = file_store.data(entrypoint.source_name);
 
    if (!source) {
-      log_and_terminate("Unable to get shader source code. Can't compile.");
+      return {.error_message = "Unable to get shader source code. Can't compile."s};
    }
 
    auto shader_defines =
@@ -177,22 +183,16 @@ auto compile(Source_file_store& file_store, const Entrypoint_description& entryp
                  error_messages.clear_and_assign());
 
    if (FAILED(result)) {
-      const std::string_view error_message_view = {static_cast<const char*>(
-                                                      error_messages->GetBufferPointer()),
-                                                   error_messages->GetBufferSize()};
-
-      if (retry_dialog("Shader Compile Error"s, error_message_view)) {
-         file_store.reload();
-
-         return compile(file_store, entrypoint, static_flags, vertex_shader_flags);
-      }
+      if (!error_messages) return {.error_message = "Unknown shader compile error."s};
 
-      log_and_terminate("Unable to compile shader!\n", error_message_view);
+      return {.error_message = {static_cast<const char*>(
+                                   error_messages->GetBufferPointer()),
+                                error_messages->GetBufferSize()}};
    }
 
    log_debug("Compiled shader {}:{}({:x})"sv, entrypoint.source_name,
              entrypoint.function_name, static_flags);
 
-   return Bytecode_blob{std::move(bytecode_result)};
+   return {.bytecode = Bytecode_blob{std::move(bytecode_result)}};
 }
 }
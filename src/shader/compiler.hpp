@@ -4,11 +4,28 @@
 #include "entrypoint_description.hpp"
 #include "source_file_store.hpp"
 
+#include <shared_mutex>
+#include <string>
+
 namespace sp::shader {
 
-auto compile(Source_file_store& file_store, const Entrypoint_description& entrypoint,
+struct Compile_result {
+   Bytecode_blob bytecode;
+
+   //! The compiler's output if the compile failed, empty otherwise.
+   std::string error_message;
+};
+
+//! \brief Compile a shader entrypoint. Safe to call from multiple threads at
+//! once, file_store_mutex guards file_store against the reload that happens
+//! when the user retries a failed compile.
+//!
+//! Errors are returned instead of reported so that the thread that asked for
+//! the shader can show them, compiles can run on worker threads.
+auto compile(Source_file_store& file_store, std::shared_mutex& file_store_mutex,
+             const Entrypoint_description& entrypoint,
              const std::uint64_t static_flags,
              const Vertex_shader_flags vertex_shader_flags = Vertex_shader_flags::none) noexcept
-   -> Bytecode_blob;
+   -> Compile_result;
 
 }
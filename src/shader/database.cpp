@@ -5,14 +5,23 @@
 #include "compiler.hpp"
 #include "entrypoint_description.hpp"
 #include "group_definition.hpp"
+#include "retry_dialog.hpp"
 #include "source_file_dependency_index.hpp"
 #include "source_file_store.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <future>
+#include <mutex>
 #include <ranges>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
 
 #include <absl/container/flat_hash_map.h>
 
@@ -214,7 +223,7 @@ public:
 
    void mark_dirty() noexcept
    {
-      _disk_cache_dirty = true;
+      _disk_cache_dirty.store(true, std::memory_order_relaxed);
    }
 
    bool should_update() const noexcept
@@ -234,12 +243,117 @@ public:
    }
 
 private:
-   bool _disk_cache_dirty = false;
+   std::atomic_bool _disk_cache_dirty = false;
    std::chrono::steady_clock::time_point _last_update =
       std::chrono::steady_clock::now();
    std::future<void> _update_future;
 };
 
+struct Compile_key {
+   Stage stage;
+   std::string group;
+   std::string entrypoint;
+   std::uint64_t static_flags;
+   Vertex_shader_flags game_flags;
+
+   template<typename H>
+   friend H AbslHashValue(H h, const Compile_key& key)
+   {
+      return H::combine(std::move(h), key.stage, key.group, key.entrypoint,
+                        key.static_flags, key.game_flags);
+   }
+
+   bool operator==(const Compile_key&) const noexcept = default;
+};
+
+//! \brief A shader from the cache or from a compile. Compile errors are carried
+//! back to the thread that asked for the shader instead of being reported
+//! wherever the compile happened to run.
+struct Compile_output {
+   Com_ptr<ID3D11DeviceChild> shader;
+   Bytecode_blob bytecode;
+   std::string error_message;
+};
+
+//! \brief Pool of threads that compile shaders in the background. Jobs still
+//! queued when the pool is destroyed are dropped, jobs already running are
+//! waited on.
+class Compile_workers {
+public:
+   Compile_workers() noexcept
+   {
+      const auto thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+
+      _threads.reserve(thread_count);
+
+      for (auto i = 0u; i < thread_count; ++i) {
+         _threads.emplace_back([this](std::stop_token stop) { run(stop); });
+      }
+   }
+
+   void submit(std::function<void()> job) noexcept
+   {
+      {
+         std::scoped_lock lock{_mutex};
+
+         _jobs.push_back(std::move(job));
+         _pending_jobs += 1;
+      }
+
+      _jobs_changed.notify_one();
+   }
+
+   void wait_idle() noexcept
+   {
+      std::unique_lock lock{_mutex};
+
+      _idle.wait(lock, [this] { return _pending_jobs == 0; });
+   }
+
+private:
+   void run(std::stop_token stop) noexcept
+   {
+      std::unique_lock lock{_mutex};
+
+      while (true) {
+         if (!_jobs_changed.wait(lock, stop, [this] { return !_jobs.empty(); })) {
+            return;
+         }
+
+         // The wait still succeeds after a stop while jobs are queued, drop
+         // them instead of holding up shutdown on compiles nobody will use.
+         if (stop.stop_requested()) {
+            _pending_jobs -= _jobs.size();
+            _jobs.clear();
+
+            if (_pending_jobs == 0) _idle.notify_all();
+
+            return;
+         }
+
+         auto job = std::move(_jobs.front());
+         _jobs.pop_front();
+
+         lock.unlock();
+
+         job();
+
+         lock.lock();
+
+         if (--_pending_jobs == 0) _idle.notify_all();
+      }
+   }
+
+   std::mutex _mutex;
+   std::condition_variable_any _jobs_changed;
+   std::condition_variable _idle;
+   std::deque<std::function<void()>> _jobs;
+   std::size_t _pending_jobs = 0;
+
+   // Declared last so the threads are joined before anything they use is destroyed.
+   std::vector<std::jthread> _threads;
+};
+
 }
 
 class Database_internal {
@@ -270,41 +384,23 @@ public:
          }
       }
 
-      _cache.clear_stale_entries(_source_dependency_index, _source_file_store,
-                                 definitions);
+      _cache.clear_stale_entries(_entrypoint_descs, _source_dependency_index,
+                                 _source_file_store);
    }
 
    template<typename T>
    auto get(const std::string_view group_name, const std::string_view entrypoint_name,
             const std::uint64_t static_flags) noexcept -> Com_ptr<T>
    {
-      if (auto cached = _cache.get_if<T>(group_name, entrypoint_name, static_flags);
-          cached) {
-         return cached->shader;
-      }
-
-      // Multithreading stuff to stop double compilation goes here.
+      auto output = compile_shader<T>(group_name, entrypoint_name, static_flags);
 
-      const auto& entrypoint_desc = get_entrypoint_desc(group_name, entrypoint_name);
+      if (!output.shader) {
+         report_compile_error(output.error_message);
 
-      if (entrypoint_desc.stage != to_stage<T>()) {
-         log_and_terminate("Shader stage mismatch for entrypoint '"sv,
-                           entrypoint_name, "' from group '"sv, group_name, "'"sv);
+         return get<T>(group_name, entrypoint_name, static_flags);
       }
 
-      auto bytecode = compile(_source_file_store, entrypoint_desc, static_flags);
-
-      auto shader = create_shader<T>(*_device, bytecode);
-
-      if (!shader) {
-         log_and_terminate("Unable to recover from failed shader creation!"sv);
-      }
-
-      _cache.add<T>(group_name, entrypoint_name, static_flags,
-                    {.shader = shader, .bytecode = bytecode});
-      _cache_disk_updater.mark_dirty();
-
-      return shader;
+      return Com_ptr<T>{static_cast<T*>(output.shader.unmanaged_copy())};
    }
 
    auto get_vs(const std::string_view group_name,
@@ -323,33 +419,50 @@ public:
             : get_vertex_input_layout(entrypoint_desc.vertex_state.generic_input_state,
                                       game_flags);
 
-      if (auto cached = _cache.get_vs_if(group_name, entrypoint_name,
-                                         static_flags, game_flags);
-          cached) {
-         return {cached->shader, cached->bytecode, std::move(vertex_input_layout)};
-      }
+      auto output = compile_vs(group_name, entrypoint_name, static_flags, game_flags);
 
-      // Multithreading stuff to stop double compilation goes here.
+      if (!output.shader) {
+         report_compile_error(output.error_message);
 
-      if (entrypoint_desc.stage != Stage::vertex) {
-         log_and_terminate("Shader stage mismatch for entrypoint '"sv,
-                           entrypoint_name, "' from group '"sv, group_name, "'"sv);
+         return get_vs(group_name, entrypoint_name, static_flags, game_flags);
       }
 
-      auto bytecode =
-         compile(_source_file_store, entrypoint_desc, static_flags, game_flags);
+      return {Com_ptr<ID3D11VertexShader>{static_cast<ID3D11VertexShader*>(
+                 output.shader.unmanaged_copy())},
+              std::move(output.bytecode), std::move(vertex_input_layout)};
+   }
 
-      auto shader = create_shader<ID3D11VertexShader>(*_device, bytecode);
+   //! \brief Queue a shader to be compiled in the background if it is not
+   //! already in the cache.
+   template<typename T>
+   void prefetch(const std::string_view group_name, const std::string_view entrypoint_name,
+                 const std::uint64_t static_flags) noexcept
+   {
+      if (_cache.get_if<T>(group_name, entrypoint_name, static_flags)) return;
+
+      // A failed compile is left out of the cache, it is compiled again and
+      // reported when the shader is actually asked for.
+      _compile_workers.submit([this, group_name = std::string{group_name},
+                               entrypoint_name = std::string{entrypoint_name},
+                               static_flags] {
+         compile_shader<T>(group_name, entrypoint_name, static_flags);
+      });
+   }
 
-      if (!shader) {
-         log_and_terminate("Unable to recover from failed shader creation!"sv);
+   void prefetch_vs(const std::string_view group_name,
+                    const std::string_view entrypoint_name,
+                    const std::uint64_t static_flags,
+                    const Vertex_shader_flags game_flags) noexcept
+   {
+      if (_cache.get_vs_if(group_name, entrypoint_name, static_flags, game_flags)) {
+         return;
       }
 
-      _cache.add_vs(group_name, entrypoint_name, static_flags, game_flags,
-                    {.shader = shader, .bytecode = bytecode});
-      _cache_disk_updater.mark_dirty();
-
-      return {shader, bytecode, std::move(vertex_input_layout)};
+      _compile_workers.submit([this, group_name = std::string{group_name},
+                               entrypoint_name = std::string{entrypoint_name},
+                               static_flags, game_flags] {
+         compile_vs(group_name, entrypoint_name, static_flags, game_flags);
+      });
    }
 
    void cache_update() noexcept
@@ -361,6 +474,8 @@ public:
 
    void force_cache_save_to_disk() noexcept
    {
+      _compile_workers.wait_idle();
+
       _cache.save_to_file(_file_paths.shader_cache);
    }
 
@@ -390,6 +505,171 @@ public:
    }
 
 private:
+   template<typename T>
+   auto compile_shader(const std::string_view group_name,
+                       const std::string_view entrypoint_name,
+                       const std::uint64_t static_flags) noexcept -> Compile_output
+   {
+      const auto get_cached = [&]() noexcept -> std::optional<Compile_output> {
+         auto cached = _cache.get_if<T>(group_name, entrypoint_name, static_flags);
+
+         if (!cached) return std::nullopt;
+
+         return Compile_output{.shader = std::move(cached->shader),
+                               .bytecode = std::move(cached->bytecode)};
+      };
+
+      if (auto cached = get_cached(); cached) return std::move(*cached);
+
+      const auto& entrypoint_desc = get_entrypoint_desc(group_name, entrypoint_name);
+
+      if (entrypoint_desc.stage != to_stage<T>()) {
+         log_and_terminate("Shader stage mismatch for entrypoint '"sv,
+                           entrypoint_name, "' from group '"sv, group_name, "'"sv);
+      }
+
+      return compile_once({.stage = to_stage<T>(),
+                           .group = std::string{group_name},
+                           .entrypoint = std::string{entrypoint_name},
+                           .static_flags = static_flags,
+                           .game_flags = Vertex_shader_flags::none},
+                          get_cached, [&]() noexcept -> Compile_output {
+                             auto compiled =
+                                compile(_source_file_store, _source_file_store_mutex,
+                                        entrypoint_desc, static_flags);
+
+                             if (!compiled.error_message.empty()) {
+                                return {.error_message =
+                                           std::move(compiled.error_message)};
+                             }
+
+                             auto shader = create_shader<T>(*_device, compiled.bytecode);
+
+                             if (!shader) {
+                                return {.error_message = "Failed to create shader."s};
+                             }
+
+                             _cache.add<T>(group_name, entrypoint_name, static_flags,
+                                           {.shader = shader,
+                                            .bytecode = compiled.bytecode});
+                             _cache_disk_updater.mark_dirty();
+
+                             return {.shader = std::move(shader),
+                                     .bytecode = std::move(compiled.bytecode)};
+                          });
+   }
+
+   auto compile_vs(const std::string_view group_name,
+                   const std::string_view entrypoint_name,
+                   const std::uint64_t static_flags,
+                   const Vertex_shader_flags game_flags) noexcept -> Compile_output
+   {
+      const auto get_cached = [&]() noexcept -> std::optional<Compile_output> {
+         auto cached =
+            _cache.get_vs_if(group_name, entrypoint_name, static_flags, game_flags);
+
+         if (!cached) return std::nullopt;
+
+         return Compile_output{.shader = std::move(cached->shader),
+                               .bytecode = std::move(cached->bytecode)};
+      };
+
+      if (auto cached = get_cached(); cached) return std::move(*cached);
+
+      const auto& entrypoint_desc = get_entrypoint_desc(group_name, entrypoint_name);
+
+      if (entrypoint_desc.stage != Stage::vertex) {
+         log_and_terminate("Shader stage mismatch for entrypoint '"sv,
+                           entrypoint_name, "' from group '"sv, group_name, "'"sv);
+      }
+
+      return compile_once({.stage = Stage::vertex,
+                           .group = std::string{group_name},
+                           .entrypoint = std::string{entrypoint_name},
+                           .static_flags = static_flags,
+                           .game_flags = game_flags},
+                          get_cached, [&]() noexcept -> Compile_output {
+                             auto compiled =
+                                compile(_source_file_store, _source_file_store_mutex,
+                                        entrypoint_desc, static_flags, game_flags);
+
+                             if (!compiled.error_message.empty()) {
+                                return {.error_message =
+                                           std::move(compiled.error_message)};
+                             }
+
+                             auto shader =
+                                create_shader<ID3D11VertexShader>(*_device,
+                                                                  compiled.bytecode);
+
+                             if (!shader) {
+                                return {.error_message = "Failed to create shader."s};
+                             }
+
+                             _cache.add_vs(group_name, entrypoint_name, static_flags,
+                                           game_flags,
+                                           {.shader = shader,
+                                            .bytecode = compiled.bytecode});
+                             _cache_disk_updater.mark_dirty();
+
+                             return {.shader = std::move(shader),
+                                     .bytecode = std::move(compiled.bytecode)};
+                          });
+   }
+
+   //! \brief Calls compile unless the shader is already cached or being
+   //! compiled by another thread, in which case this waits for that thread and
+   //! returns its result.
+   template<typename Get_cached, typename Compile>
+   auto compile_once(Compile_key key, const Get_cached& get_cached,
+                     const Compile& compile) noexcept -> Compile_output
+   {
+      std::unique_lock lock{_in_flight_mutex};
+
+      // Checked under the lock as the shader may have finished compiling on
+      // another thread since the caller last looked in the cache.
+      if (auto cached = get_cached(); cached) return std::move(*cached);
+
+      if (auto it = _in_flight_compiles.find(key); it != _in_flight_compiles.end()) {
+         auto compiled = it->second;
+
+         lock.unlock();
+
+         return compiled.get();
+      }
+
+      std::promise<Compile_output> compiled;
+
+      _in_flight_compiles.emplace(key, compiled.get_future().share());
+
+      lock.unlock();
+
+      Compile_output output = compile();
+
+      lock.lock();
+
+      _in_flight_compiles.erase(key);
+
+      lock.unlock();
+
+      compiled.set_value(output);
+
+      return output;
+   }
+
+   //! \brief Show a failed compile to the user. Returns once the shader sources
+   //! have been reloaded for a retry, terminates if the user cancels.
+   void report_compile_error(const std::string_view error_message) noexcept
+   {
+      if (!retry_dialog("Shader Compile Error"s, error_message)) {
+         log_and_terminate("Unable to compile shader!\n", error_message);
+      }
+
+      std::scoped_lock reload_lock{_source_file_store_mutex};
+
+      _source_file_store.reload();
+   }
+
    auto get_entrypoint_desc(const std::string_view group_name,
                             const std::string_view entrypoint_name) const noexcept
       -> const Entrypoint_description&
@@ -414,10 +694,18 @@ private:
    Cache _cache{*_device, _file_paths.shader_cache};
    Cache_disk_updater _cache_disk_updater;
    Source_file_store _source_file_store{_file_paths.shader_source_files};
+   std::shared_mutex _source_file_store_mutex;
    Source_file_dependency_index _source_dependency_index{_source_file_store};
 
    absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, Entrypoint_description>> _entrypoint_descs;
    absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, Rendertype_state_description>> _rendertypes_states;
+
+   std::mutex _in_flight_mutex;
+   absl::flat_hash_map<Compile_key, std::shared_future<Compile_output>> _in_flight_compiles;
+
+   // Declared last so that compiles running in the background finish before
+   // the rest of the database is destroyed.
+   Compile_workers _compile_workers;
 };
 
 Database::Database(Com_ptr<ID3D11Device5> device, Database_file_paths file_paths) noexcept
@@ -528,6 +816,12 @@ Rendertypes_database::Rendertypes_database(Database& database, const bool oit_ca
          std::make_unique<Rendertype>(database.internal(), states, rendertype,
                                       oit_capable);
    }
+
+   // Start compiling everything in the background so shaders are ready (or
+   // at least underway) by the time they're first asked for.
+   for (auto& [name, rendertype] : _rendertypes) {
+      for (auto& [state_name, state] : *rendertype) state->prefetch();
+   }
 }
 
 auto Rendertypes_database::operator[](const std::string_view rendertype) noexcept
@@ -569,6 +863,22 @@ Rendertype_state::Rendertype_state(Database_internal& database,
 {
 }
 
+void Rendertype_state::prefetch() noexcept
+{
+   eval_vertex_shader_variations([&](const Vertex_shader_flags game_flags) {
+      _database.prefetch_vs(_desc.group_name, _desc.vs_entrypoint,
+                            _desc.vs_static_flags, game_flags);
+   });
+
+   _database.prefetch<ID3D11PixelShader>(_desc.group_name, _desc.ps_entrypoint,
+                                         _desc.ps_static_flags);
+
+   if (_oit_capable && _desc.ps_oit_entrypoint) {
+      _database.prefetch<ID3D11PixelShader>(_desc.group_name, *_desc.ps_oit_entrypoint,
+                                            _desc.ps_oit_static_flags);
+   }
+}
+
 auto Rendertype_state::vertex(const Vertex_shader_flags game_flags) noexcept
    -> std::tuple<Com_ptr<ID3D11VertexShader>, Bytecode_blob, Vertex_input_layout>
 {
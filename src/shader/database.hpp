@@ -303,6 +303,10 @@ public:
    auto pixel_oit(std::span<const std::string> extra_flags) noexcept
       -> Com_ptr<ID3D11PixelShader>;
 
+   //! \brief Queue every vertex shader variation and the pixel shaders of the
+   //! state to be compiled in the background.
+   void prefetch() noexcept;
+
 private:
    bool vertex_shader_supported(const Vertex_shader_flags game_flags) const noexcept;
 
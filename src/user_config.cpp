@@ -174,6 +174,39 @@ auto dof_quality_from_string_view(const std::string_view string) noexcept -> DOF
    }
 }
 
+auto to_string_view(const Log_flush_policy policy) noexcept -> std::string_view
+{
+   using namespace std::literals;
+
+   switch (policy) {
+   case Log_flush_policy::every_message:
+      return "Every Message"sv;
+   case Log_flush_policy::errors:
+      return "Errors"sv;
+   case Log_flush_policy::periodic:
+      return "Periodic"sv;
+   }
+
+   std::terminate();
+}
+
+auto log_flush_policy_from_string_view(const std::string_view string) noexcept
+   -> Log_flush_policy
+{
+   if (string == to_string_view(Log_flush_policy::every_message)) {
+      return Log_flush_policy::every_message;
+   }
+   else if (string == to_string_view(Log_flush_policy::errors)) {
+      return Log_flush_policy::errors;
+   }
+   else if (string == to_string_view(Log_flush_policy::periodic)) {
+      return Log_flush_policy::periodic;
+   }
+   else {
+      return Log_flush_policy::errors;
+   }
+}
+
 auto to_string_view(const SSAO_quality quality) noexcept -> std::string_view
 {
    using namespace std::literals;
@@ -254,6 +287,34 @@ auto refraction_quality_from_string_view(const std::string_view string) noexcept
    }
 }
 
+auto to_string_view(const Screenshot_format format) noexcept -> std::string_view
+{
+   using namespace std::literals;
+
+   switch (format) {
+   case Screenshot_format::png:
+      return "PNG"sv;
+   case Screenshot_format::qoi:
+      return "QOI"sv;
+   }
+
+   std::terminate();
+}
+
+auto screenshot_format_from_string_view(const std::string_view string) noexcept
+   -> Screenshot_format
+{
+   if (string == to_string_view(Screenshot_format::png)) {
+      return Screenshot_format::png;
+   }
+   else if (string == to_string_view(Screenshot_format::qoi)) {
+      return Screenshot_format::qoi;
+   }
+   else {
+      return Screenshot_format::png;
+   }
+}
+
 auto to_string_view(const Aspect_ratio_hud hud) noexcept -> std::string_view
 {
    using namespace std::literals;
@@ -308,6 +369,8 @@ User_config::User_config(const std::string& path) noexcept
       log(Log_level::warning, "Failed to read config file "sv,
           std::quoted(path), ". reason:"sv, e.what());
    }
+
+   set_log_flush_policy(developer.log_flush_policy);
 }
 
 User_config::~User_config()
@@ -456,6 +519,26 @@ void User_config::show_imgui() noexcept
                                  &graphics.enable_user_effects_auto_config);
 
       MarkProperty("Enable Auto User Effects Config");
+
+      changed |= ImGui::Checkbox("Stream Textures", &graphics.stream_textures);
+
+      MarkProperty("Stream Textures");
+
+      if (ImGui::BeginCombo("Screenshot Format",
+                            to_string_view(graphics.screenshot_format).data())) {
+         for (const Screenshot_format format :
+              {Screenshot_format::png, Screenshot_format::qoi}) {
+            if (ImGui::Selectable(to_string_view(format).data(),
+                                  format == graphics.screenshot_format)) {
+               graphics.screenshot_format = format;
+               changed = true;
+            }
+         }
+
+         ImGui::EndCombo();
+      }
+
+      MarkProperty("Screenshot Format");
    }
 
    if (ImGui::CollapsingHeader("Effects", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -676,6 +759,13 @@ void User_config::parse_file(const std::string& path)
    graphics.use_d3d11on12 =
       config["Graphics"s]["Use Direct3D 11 on 12"s].as<bool>(graphics.use_d3d11on12);
 
+   graphics.stream_textures =
+      config["Graphics"s]["Stream Textures"s].as<bool>(graphics.stream_textures);
+
+   graphics.screenshot_format = screenshot_format_from_string_view(
+      config["Graphics"s]["Screenshot Format"s].as<std::string_view>(
+         to_string_view(graphics.screenshot_format)));
+
    effects.bloom = config["Effects"s]["Bloom"s].as<bool>(effects.bloom);
 
    effects.vignette = config["Effects"s]["Vignette"s].as<bool>(effects.vignette);
@@ -713,6 +803,10 @@ void User_config::parse_file(const std::string& path)
    developer.use_dxgi_1_2_factory =
       config["Developer"s]["Use DXGI 1.2 Factory"s].as<bool>(developer.use_dxgi_1_2_factory);
 
+   developer.log_flush_policy = log_flush_policy_from_string_view(
+      config["Developer"s]["Log Flush Policy"s].as<std::string_view>(
+         to_string_view(developer.log_flush_policy)));
+
    developer.shader_cache_path =
       config["Developer"s]["Shader Cache Path"s].as<std::string>();
 
@@ -841,6 +935,8 @@ void User_config::save_file(const std::string& path, const std::string& temp_pat
       write_value("Enable Auto User Effects Config",
                   printify(graphics.enable_user_effects_auto_config));
       write_value("Use Direct3D 11 on 12", printify(graphics.use_d3d11on12));
+      write_value("Stream Textures", printify(graphics.stream_textures));
+      write_value("Screenshot Format", printify(graphics.screenshot_format));
 
       out << "Effects: "sv << line_break;
 
@@ -860,6 +956,7 @@ void User_config::save_file(const std::string& path, const std::string& temp_pat
       write_value("Allow Event Queries", printify(developer.allow_event_queries));
       write_value("Use D3D11 Debug Layer", printify(developer.use_d3d11_debug_layer));
       write_value("Use DXGI 1.2 Factory", printify(developer.use_dxgi_1_2_factory));
+      write_value("Log Flush Policy", printify(developer.log_flush_policy));
       write_value("Shader Cache Path", printify_dynamic(developer.shader_cache_path));
       write_value("Shader Definitions Path",
                   printify_dynamic(developer.shader_definitions_path));
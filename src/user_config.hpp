@@ -36,6 +36,8 @@ enum class SSAO_quality : std::int8_t { fastest, fast, medium, high, highest };
 
 enum class Refraction_quality : std::int8_t { low, medium, high, ultra };
 
+enum class Screenshot_format : std::int8_t { png, qoi };
+
 enum class Aspect_ratio_hud : std::int8_t {
    stretch_4_3,
    centre_4_3,
@@ -109,6 +111,8 @@ struct User_config {
       bool supersample_alpha_test = false;
       bool allow_vertex_soft_skinning = false;
       bool use_d3d11on12 = false;
+      bool stream_textures = true;
+      Screenshot_format screenshot_format = Screenshot_format::png;
       std::string user_effects_config;
    } graphics;
 
@@ -121,6 +125,7 @@ struct User_config {
       bool allow_event_queries = false;
       bool use_d3d11_debug_layer = false;
       bool use_dxgi_1_2_factory = false;
+      Log_flush_policy log_flush_policy = Log_flush_policy::errors;
 
       std::filesystem::path shader_cache_path =
          LR"(.\data\shaderpatch\.shader_dxbc_cache)";
@@ -1,4 +1,5 @@
 
+#include "memory_mapped_file.hpp"
 #include "req_file_helpers.hpp"
 #include "string_utilities.hpp"
 #include "swbf_fnv_1a.hpp"
@@ -7,18 +8,24 @@
 #include "ucfb_writer.hpp"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <cwctype>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <regex>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -67,8 +74,16 @@ auto load_and_transform_req_files(fs::path path)
    return req;
 }
 
+// Canonical so that every spelling of a path (relative, through links and so
+// on) gives the same key.
 auto normalize_path(fs::path path) -> fs::path::string_type
 {
+   std::error_code error;
+
+   if (auto canonical = fs::weakly_canonical(path, error); !error) {
+      path = std::move(canonical);
+   }
+
    path = path.lexically_normal().make_preferred();
 
    fs::path::string_type string;
@@ -104,16 +119,19 @@ auto make_extern_files_set(const std::vector<std::string>& extern_files_list_pat
    return extern_files_set;
 }
 
+class Munged_file_cache;
+
 void write_file_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
                        std::unordered_set<fs::path::string_type>& added_files,
                        const std::vector<fs::path>& source_dirs,
                        const std::unordered_set<Ci_string>& extern_files,
-                       const fs::path& filepath);
+                       Munged_file_cache& file_cache, const fs::path& filepath);
 
 void write_req_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
                       std::unordered_set<fs::path::string_type>& added_files,
                       const std::vector<fs::path>& source_dirs,
                       const std::unordered_set<Ci_string>& extern_files,
+                      Munged_file_cache& file_cache,
                       std::vector<std::pair<std::string, std::vector<std::string>>> req_file_contents);
 
 auto find_file(const std::string& filename, const std::vector<fs::path>& input_dirs)
@@ -130,28 +148,98 @@ auto find_file(const std::string& filename, const std::vector<fs::path>& input_d
    return std::nullopt;
 }
 
-auto read_binary_in(const fs::path& path) -> std::vector<std::byte>
+auto read_binary_in(const fs::path& path) -> std::shared_ptr<const Memory_mapped_file>
 {
    Expects(fs::exists(path) && fs::is_regular_file(path));
 
-   std::ifstream file{path.string(), std::ios::binary | std::ios::ate};
+   return std::make_shared<const Memory_mapped_file>(path, Memory_mapped_file::Mode::read,
+                                                     Memory_mapped_file::Access_hint::sequential);
+}
 
-   const auto file_size = file.tellg();
+//! \brief Read-only cache of munged input files shared between the .lvl files
+//! being packed at the same time. A file included by more than one .lvl is
+//! mapped into memory once and handed out to each of them, the mapping is
+//! dropped once the last .lvl that includes it has been packed.
+//!
+//! Every other file is read straight from disk each time it is asked for. This
+//! includes outputs of the current run, as their contents change while packing
+//! and they must not be held open.
+class Munged_file_cache {
+public:
+   using Data = std::shared_ptr<const Memory_mapped_file>;
+
+   //! Create a cache that caches nothing.
+   Munged_file_cache() = default;
+
+   //! `consumer_counts` is the number of .lvl files that include each file.
+   explicit Munged_file_cache(
+      const std::unordered_map<fs::path::string_type, std::size_t>& consumer_counts)
+   {
+      for (const auto& [normalized_path, consumers] : consumer_counts) {
+         if (consumers < 2) continue;
+
+         _entries.emplace(normalized_path, std::make_shared<Entry>(consumers));
+      }
+   }
 
-   std::vector<std::byte> vector;
-   vector.resize(static_cast<std::size_t>(file_size));
+   auto get(const fs::path& path, const fs::path::string_type& normalized_path) -> Data
+   {
+      std::shared_ptr<Entry> entry;
 
-   file.seekg(0);
-   file.read(reinterpret_cast<char*>(vector.data()), vector.size());
+      {
+         std::lock_guard lock{_mutex};
 
-   return vector;
-}
+         if (auto it = _entries.find(normalized_path); it != _entries.end()) {
+            entry = it->second;
+         }
+      }
+
+      if (!entry) return read_binary_in(path);
+
+      // Concurrent requests for the same file wait here for the first one to
+      // finish reading it instead of reading it again.
+      std::call_once(entry->loaded, [&] {
+         entry->data = read_binary_in(path);
+      });
+
+      return entry->data;
+   }
+
+   //! Call once a .lvl has been packed with the files it includes.
+   void release(const std::unordered_set<fs::path::string_type>& inputs)
+   {
+      std::lock_guard lock{_mutex};
+
+      for (const auto& input : inputs) {
+         auto it = _entries.find(input);
+
+         if (it == _entries.end()) continue;
+
+         // Packs still reading the file hold their own reference to the data.
+         if (--it->second->consumers == 0) _entries.erase(it);
+      }
+   }
+
+private:
+   struct Entry {
+      explicit Entry(const std::size_t consumers) noexcept : consumers{consumers} {}
+
+      std::once_flag loaded;
+      Data data;
+
+      // Only touched with _mutex held.
+      std::size_t consumers;
+   };
+
+   std::mutex _mutex;
+   std::unordered_map<fs::path::string_type, std::shared_ptr<Entry>> _entries;
+};
 
 void write_file_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
                        std::unordered_set<fs::path::string_type>& added_files,
                        const std::vector<fs::path>& input_dirs,
                        const std::unordered_set<Ci_string>& extern_files,
-                       const fs::path& filepath)
+                       Munged_file_cache& file_cache, const fs::path& filepath)
 {
    const auto normalized_path = normalize_path(filepath);
 
@@ -161,19 +249,19 @@ void write_file_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
    req_path.replace_extension(filepath.extension() += ".req"sv);
 
    if (fs::exists(req_path) && fs::is_regular_file(req_path)) {
-      write_req_to_lvl(req_file_path, writer, added_files, input_dirs,
-                       extern_files, load_and_transform_req_files(req_path));
+      write_req_to_lvl(req_file_path, writer, added_files, input_dirs, extern_files,
+                       file_cache, load_and_transform_req_files(req_path));
    }
 
-   const auto file_data = read_binary_in(filepath);
+   const auto file_data = file_cache.get(filepath, normalized_path);
 
-   if (file_data.size() == 8u) {
+   if (file_data->bytes().size() == 8u) {
       synced_print(filepath, " is empty, skipping."sv);
 
       return;
    }
 
-   ucfb::Reader reader{file_data};
+   ucfb::Reader reader{file_data->bytes()};
 
    if (filepath.extension() == ".lvl"s) {
       auto lvl_writer = writer.emplace_child("lvl_"_mn);
@@ -192,6 +280,7 @@ void write_req_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
                       std::unordered_set<fs::path::string_type>& added_files,
                       const std::vector<fs::path>& input_dirs,
                       const std::unordered_set<Ci_string>& extern_files,
+                      Munged_file_cache& file_cache,
                       std::vector<std::pair<std::string, std::vector<std::string>>> req_file_contents)
 {
    for (auto& section : req_file_contents) {
@@ -200,7 +289,7 @@ void write_req_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
 
          if (const auto path = find_file(filename, input_dirs); path) {
             write_file_to_lvl(req_file_path, writer, added_files, input_dirs,
-                              extern_files, *path);
+                              extern_files, file_cache, *path);
          }
          else if (!extern_files.count(Ci_string{filename.data(), filename.size()})) {
             synced_error_print("Warning nonexistent file "sv, std::quoted(filename),
@@ -210,14 +299,20 @@ void write_req_to_lvl(const fs::path& req_file_path, ucfb::File_writer& writer,
    }
 }
 
+auto lvl_output_path(const fs::path& req_file_path, const fs::path& output_directory)
+   -> fs::path
+{
+   return output_directory / req_file_path.filename().replace_extension(".lvl"sv);
+}
+
 void build_lvl_file(const fs::path& req_file_path, const fs::path& output_directory,
                     const std::vector<fs::path>& input_dirs,
-                    const std::unordered_set<Ci_string>& extern_files) noexcept
+                    const std::unordered_set<Ci_string>& extern_files,
+                    Munged_file_cache& file_cache) noexcept
 {
    Expects(fs::exists(req_file_path) && fs::exists(output_directory));
 
-   const auto output_path =
-      output_directory / req_file_path.filename().replace_extension(".lvl"sv);
+   const auto output_path = lvl_output_path(req_file_path, output_directory);
 
    try {
       bool success = false;
@@ -232,8 +327,8 @@ void build_lvl_file(const fs::path& req_file_path, const fs::path& output_direct
 
       std::unordered_set<fs::path::string_type> added_files;
 
-      write_req_to_lvl(req_file_path, writer, added_files, input_dirs,
-                       extern_files, load_and_transform_req_files(req_file_path));
+      write_req_to_lvl(req_file_path, writer, added_files, input_dirs, extern_files,
+                       file_cache, load_and_transform_req_files(req_file_path));
 
       success = true;
    }
@@ -242,6 +337,156 @@ void build_lvl_file(const fs::path& req_file_path, const fs::path& output_direct
                          req_file_path.filename(), "\n   ", e.what());
    }
 }
+
+void collect_req_inputs(const std::vector<std::pair<std::string, std::vector<std::string>>>& req_file_contents,
+                        const std::vector<fs::path>& input_dirs,
+                        const std::unordered_set<fs::path::string_type>& lvl_outputs,
+                        std::unordered_set<fs::path::string_type>& inputs)
+{
+   for (auto& section : req_file_contents) {
+      for (auto& value : section.second) {
+         const auto filename = value + "."s + section.first;
+
+         // Every output of this run that could be picked up is an input, not
+         // just the one that exists on disk right now.
+         for (const auto& dir : input_dirs) {
+            const auto path = dir / filename;
+            const auto normalized_path = normalize_path(path);
+            const bool exists = fs::exists(path) && fs::is_regular_file(path);
+
+            if (!exists && !lvl_outputs.count(normalized_path)) continue;
+
+            if (inputs.insert(normalized_path).second) {
+               auto req_path = path;
+               req_path.replace_extension(path.extension() += ".req"sv);
+
+               if (fs::exists(req_path) && fs::is_regular_file(req_path)) {
+                  collect_req_inputs(load_and_transform_req_files(req_path),
+                                     input_dirs, lvl_outputs, inputs);
+               }
+            }
+
+            if (exists) break;
+         }
+      }
+   }
+}
+
+struct Lvl_job {
+   fs::path req_file_path;
+   std::unordered_set<fs::path::string_type> inputs;
+   std::vector<std::size_t> dependents;
+   std::size_t unfinished_dependencies = 0;
+};
+
+//! \brief Works out which .req files must be packed before others.
+//!
+//! Two .req files depend on each other when one of them (transitively) includes
+//! the .lvl produced by the other or when they both produce the same .lvl. The
+//! one listed first is always packed first so that the output matches packing
+//! every .req file one after another in order.
+auto make_lvl_jobs(const std::vector<fs::path>& req_file_paths,
+                   const fs::path& output_directory,
+                   const std::vector<fs::path>& input_dirs,
+                   const std::unordered_set<fs::path::string_type>& lvl_outputs)
+   -> std::vector<Lvl_job>
+{
+   std::vector<Lvl_job> jobs;
+   jobs.reserve(req_file_paths.size());
+
+   std::vector<fs::path::string_type> outputs;
+
+   for (const auto& path : req_file_paths) {
+      auto& job = jobs.emplace_back(Lvl_job{.req_file_path = path});
+      outputs.push_back(normalize_path(lvl_output_path(path, output_directory)));
+
+      try {
+         collect_req_inputs(load_and_transform_req_files(path), input_dirs,
+                            lvl_outputs, job.inputs);
+      }
+      catch (std::exception&) {
+         // Reported when the .req is packed.
+      }
+   }
+
+   for (std::size_t i = 0; i < jobs.size(); ++i) {
+      for (std::size_t j = i + 1; j < jobs.size(); ++j) {
+         if (outputs[i] == outputs[j] || jobs[i].inputs.count(outputs[j]) ||
+             jobs[j].inputs.count(outputs[i])) {
+            jobs[i].dependents.push_back(j);
+            jobs[j].unfinished_dependencies += 1;
+         }
+      }
+   }
+
+   return jobs;
+}
+
+//! \brief Count how many jobs include each of their inputs, leaving out outputs
+//! of the current run.
+auto count_input_consumers(const std::vector<Lvl_job>& jobs,
+                           const std::unordered_set<fs::path::string_type>& lvl_outputs)
+   -> std::unordered_map<fs::path::string_type, std::size_t>
+{
+   std::unordered_map<fs::path::string_type, std::size_t> consumer_counts;
+
+   for (const auto& job : jobs) {
+      for (const auto& input : job.inputs) {
+         if (!lvl_outputs.count(input)) consumer_counts[input] += 1;
+      }
+   }
+
+   return consumer_counts;
+}
+
+template<typename Build>
+void run_lvl_jobs(std::vector<Lvl_job> jobs, const int thread_count, const Build& build)
+{
+   std::mutex mutex;
+   std::condition_variable jobs_changed;
+   std::deque<std::size_t> ready_jobs;
+   std::size_t remaining_jobs = jobs.size();
+
+   for (std::size_t i = 0; i < jobs.size(); ++i) {
+      if (jobs[i].unfinished_dependencies == 0) ready_jobs.push_back(i);
+   }
+
+   const auto worker = [&] {
+      std::unique_lock lock{mutex};
+
+      while (true) {
+         jobs_changed.wait(lock, [&] {
+            return !ready_jobs.empty() || remaining_jobs == 0;
+         });
+
+         if (ready_jobs.empty()) return;
+
+         const auto index = ready_jobs.front();
+         ready_jobs.pop_front();
+
+         lock.unlock();
+
+         build(jobs[index]);
+
+         lock.lock();
+
+         remaining_jobs -= 1;
+
+         for (const auto dependent : jobs[index].dependents) {
+            if (--jobs[dependent].unfinished_dependencies == 0) {
+               ready_jobs.push_back(dependent);
+            }
+         }
+
+         jobs_changed.notify_all();
+      }
+   };
+
+   std::vector<std::jthread> threads;
+   threads.reserve(thread_count);
+
+   for (auto i = 0; i < thread_count; ++i) threads.emplace_back(worker);
+}
 }
 
 int main(int arg_count, char* args[])
@@ -255,6 +500,7 @@ int main(int arg_count, char* args[])
    std::vector<std::string> input_directories;
    std::vector<std::string> extern_files_list_paths;
    bool recursive = false;
+   int jobs = 1;
 
    // clang-format off
 
@@ -280,7 +526,11 @@ int main(int arg_count, char* args[])
        " provided."s)
       | Opt{recursive, "recursive"s}
       ["-r"s]["--recursive"s]
-      ("Search input directory recursively for .req files."s);
+      ("Search input directory recursively for .req files."s)
+      | Opt{jobs, "jobs"s}
+      ["--jobs"s]["-j"s]
+      ("Number of .req files to pack at the same time. .req files that include"
+       " the output of another are still packed after it. Default is 1."s);
 
    // clang-format on
 
@@ -330,6 +580,8 @@ int main(int arg_count, char* args[])
 
    const std::regex regex{input_filter, std::regex::ECMAScript};
 
+   std::vector<fs::path> req_file_paths;
+
    const auto process_directory = [&](auto&& iterator) {
       for (auto& entry : std::forward<decltype(iterator)>(iterator)) {
          if (!fs::is_regular_file(entry.path())) continue;
@@ -338,9 +590,7 @@ int main(int arg_count, char* args[])
             continue;
          }
 
-         synced_print("Munging lvl "sv, entry.path().filename().string(), "..."sv);
-
-         build_lvl_file(entry.path(), output_dir, input_directories_paths, extern_files);
+         req_file_paths.push_back(entry.path());
       }
    };
 
@@ -350,4 +600,36 @@ int main(int arg_count, char* args[])
    else {
       process_directory(fs::directory_iterator{source_dir});
    }
+
+   std::unordered_set<fs::path::string_type> lvl_outputs;
+
+   for (const auto& path : req_file_paths) {
+      lvl_outputs.insert(normalize_path(lvl_output_path(path, output_dir)));
+   }
+
+   const auto build = [&](const fs::path& req_file_path, Munged_file_cache& file_cache) {
+      synced_print("Munging lvl "sv, req_file_path.filename().string(), "..."sv);
+
+      build_lvl_file(req_file_path, output_dir, input_directories_paths,
+                     extern_files, file_cache);
+   };
+
+   // Packing one .lvl at a time nothing is shared, so nothing is cached.
+   if (jobs <= 1) {
+      Munged_file_cache file_cache;
+
+      for (const auto& path : req_file_paths) build(path, file_cache);
+   }
+   else {
+      auto lvl_jobs =
+         make_lvl_jobs(req_file_paths, output_dir, input_directories_paths, lvl_outputs);
+
+      Munged_file_cache file_cache{count_input_consumers(lvl_jobs, lvl_outputs)};
+
+      run_lvl_jobs(std::move(lvl_jobs), jobs, [&](const Lvl_job& job) {
+         build(job.req_file_path, file_cache);
+
+         file_cache.release(job.inputs);
+      });
+   }
 }
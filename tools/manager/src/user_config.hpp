@@ -121,6 +121,10 @@ struct user_config {
                              L"Enabled", L"Disabled"},
 
       bool_user_config_value{L"Use Direct3D 11 on 12", false, L"Yes", L"No"},
+
+      bool_user_config_value{L"Stream Textures", true, L"Yes", L"No"},
+
+      enum_user_config_value{L"Screenshot Format", L"PNG", {L"PNG", L"QOI"}},
    };
 
    user_config_value_vector effects = {
@@ -157,6 +161,10 @@ struct user_config {
 
        bool_user_config_value{L"Use DXGI 1.2 Factory", false, L"Yes", L"No"},
 
+       enum_user_config_value{L"Log Flush Policy",
+                              L"Errors",
+                              {L"Every Message", L"Errors", L"Periodic"}},
+
        string_user_config_value{L"Shader Cache Path",
                                 LR"(.\data\shaderpatch\.shader_dxbc_cache)"},
 
@@ -31,6 +31,7 @@ int main(int arg_count, char* args[])
 
    bool help = false;
    bool use_mtrl_file_flags = false;
+   bool serial_terrain = false;
    auto output_dir = "./"s;
    auto source_dir = "./"s;
    auto munged_input_dir = "./"s;
@@ -54,7 +55,10 @@ int main(int arg_count, char* args[])
        " holding descriptions of rendertypes."s)
       | Opt{use_mtrl_file_flags, "use mtrl file flags"s}
       ["--usemtrlflags"s]
-      ("Use the deprecated Flags section in .mtrl files."s);
+      ("Use the deprecated Flags section in .mtrl files."s)
+      | Opt{serial_terrain, "serial terrain"s}
+      ["--serialterrain"s]
+      ("Process terrain model segments one at a time instead of in parallel."s);
 
    // clang-format on
 
@@ -105,7 +109,9 @@ int main(int arg_count, char* args[])
 
    munge_materials(output_dir, texture_references, files, descriptions,
                    use_mtrl_file_flags);
-   munge_terrain_materials(files, output_dir, munged_input_dir, output_dir);
+   munge_terrain_materials(files, output_dir, munged_input_dir, output_dir,
+                           serial_terrain ? Terrain_segment_execution::serial
+                                          : Terrain_segment_execution::parallel);
 
    return 0;
 }
@@ -318,8 +318,8 @@ void patch_model(const std::filesystem::path& model_path,
 {
    try {
       ucfb::Editor editor = [&] {
-         win32::Memeory_mapped_file file{model_path,
-                                         win32::Memeory_mapped_file::Mode::read};
+         Memory_mapped_file file{model_path, Memory_mapped_file::Mode::read,
+                                 Memory_mapped_file::Access_hint::sequential};
          const auto is_parent = [](const Magic_number mn) noexcept {
             if (mn == "modl"_mn || mn == "shdw"_mn || mn == "segm"_mn)
                return true;
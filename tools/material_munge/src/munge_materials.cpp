@@ -3,24 +3,27 @@
 #include "describe_material.hpp"
 #include "file_helpers.hpp"
 #include "material_options.hpp"
+#include "memory_mapped_file.hpp"
 #include "model_patcher.hpp"
 #include "patch_material_io.hpp"
 #include "req_file_helpers.hpp"
+#include "shader_patch_version.hpp"
 #include "string_utilities.hpp"
 #include "synced_io.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <execution>
 #include <filesystem>
 #include <fstream>
+#include <map>
 #include <mutex>
 #include <optional>
-#include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
-#include <unordered_set>
 #include <utility>
 
 #include <gsl/gsl>
@@ -33,48 +36,140 @@ namespace fs = std::filesystem;
 
 namespace {
 
-auto load_materials_index(const fs::path& output_dir) noexcept
-   -> std::pair<bool, std::unordered_map<Ci_string, Material_options>>
+// The munge cache records, for every munged material, a hash of its .mtrl
+// and the options it was munged with and, for every patched model, a hash of
+// everything patch_model consumed. It is never deleted at startup, instead it
+// is only ever replaced atomically and entries are only recorded for outputs
+// that were successfully (and atomically) written, so a crash at worst causes
+// the files that were in flight to be rebuilt.
+
+struct Munge_cache_material {
+   std::uint64_t source_hash = 0;
+   Material_options options;
+};
+
+struct Munge_cache {
+   std::unordered_map<Ci_string, Munge_cache_material> materials;
+   std::unordered_map<std::string, std::uint64_t> models;
+};
+
+class Content_hasher {
+public:
+   void add(const std::span<const std::byte> bytes) noexcept
+   {
+      for (const auto byte : bytes) {
+         _hash ^= static_cast<std::uint64_t>(byte);
+         _hash *= 0x100000001b3ull;
+      }
+   }
+
+   void add(const std::string_view string) noexcept
+   {
+      add(std::as_bytes(std::span{string}));
+      add(std::as_bytes(std::span{"\0", 1}));
+   }
+
+   auto result() const noexcept -> std::uint64_t
+   {
+      return _hash;
+   }
+
+private:
+   std::uint64_t _hash = 0xcbf29ce484222325ull;
+};
+
+auto hash_file(const fs::path& path) -> std::uint64_t
+{
+   const Memory_mapped_file file{path, Memory_mapped_file::Mode::read,
+                                 Memory_mapped_file::Access_hint::sequential};
+
+   Content_hasher hasher;
+
+   hasher.add(file.bytes());
+
+   return hasher.result();
+}
+
+auto munge_cache_path(const fs::path& output_dir) -> fs::path
 {
-   const auto materials_index_path = output_dir / "materials_index.json"s;
+   return output_dir / "munge_cache.json"s;
+}
+
+auto load_munge_cache(const fs::path& output_dir,
+                      const bool patch_material_flags) noexcept -> Munge_cache
+{
+   // Superseded by the munge cache.
+   std::error_code ec;
+   fs::remove(output_dir / "materials_index.json"s, ec);
 
    try {
-      const auto file = load_string_file(materials_index_path);
-      const auto index = nlohmann::json::parse(file);
+      const auto file = load_string_file(munge_cache_path(output_dir));
+      const auto json = nlohmann::json::parse(file);
 
-      std::unordered_map<Ci_string, Material_options> result;
+      if (json.at("version"s).get<std::string>() != current_shader_patch_version_string ||
+          json.at("patch_material_flags"s).get<bool>() != patch_material_flags) {
+         return {};
+      }
 
-      for (const auto& entry : index.items()) {
-         auto key = entry.key();
+      Munge_cache cache;
 
-         result.emplace(make_ci_string(entry.key()),
-                        entry.value().get<Material_options>());
+      for (const auto& entry : json.at("materials"s).items()) {
+         cache.materials.emplace(
+            make_ci_string(entry.key()),
+            Munge_cache_material{
+               .source_hash = entry.value().at("source_hash"s).get<std::uint64_t>(),
+               .options = entry.value().at("options"s).get<Material_options>()});
       }
 
-      // Remove the index file so in event of a crash a full munge will be triggered next time to clean up unruly files.
-      fs::remove(materials_index_path);
+      for (const auto& entry : json.at("models"s).items()) {
+         cache.models.emplace(entry.key(), entry.value().get<std::uint64_t>());
+      }
 
-      return {true, result};
+      return cache;
    }
    catch (std::exception&) {
-      return {false, {}};
+      return {};
    }
 }
 
-void save_materials_index(const fs::path& output_dir,
-                          const std::unordered_map<Ci_string, Material_options>& material_index) noexcept
+void save_munge_cache(const fs::path& output_dir, const Munge_cache& cache,
+                      const bool patch_material_flags) noexcept
 {
-   const auto materials_index_path = output_dir / "materials_index.json"s;
+   nlohmann::json json{{"version"s, current_shader_patch_version_string},
+                       {"patch_material_flags"s, patch_material_flags},
+                       {"materials"s, nlohmann::json::object()},
+                       {"models"s, nlohmann::json::object()}};
+
+   for (const auto& [name, material] : cache.materials) {
+      json["materials"s][std::string{name.begin(), name.end()}] =
+         nlohmann::json{{"source_hash"s, material.source_hash},
+                        {"options"s, material.options}};
+   }
 
-   std::ofstream output{materials_index_path};
+   for (const auto& [name, hash] : cache.models) {
+      json["models"s][name] = hash;
+   }
 
-   nlohmann::json json;
+   const auto cache_path = munge_cache_path(output_dir);
+   auto temp_path = cache_path;
+   temp_path += ".tmp"sv;
 
-   for (const auto& entry : material_index) {
-      json[std::string{entry.first.begin(), entry.first.end()}] = entry.second;
-   }
+   try {
+      {
+         std::ofstream output{temp_path};
+
+         output << json;
+
+         if (!output.flush()) {
+            throw std::runtime_error{"failed to write munge cache"s};
+         }
+      }
 
-   output << json;
+      fs::rename(temp_path, cache_path);
+   }
+   catch (std::exception& e) {
+      synced_error_print("Error saving munge cache: "sv, e.what());
+   }
 }
 
 auto munge_material(const fs::path& material_path, const fs::path& output_file_path,
@@ -157,64 +252,115 @@ auto munge_material(const fs::path& material_path, const fs::path& output_file_p
    return options;
 }
 
-bool output_model_out_of_date(const fs::path& model, const fs::path& output_dir)
+// Hash everything patch_model's output depends on. The material index
+// entries for the materials the model references are folded in by name, in
+// sorted order so the hash is stable.
+auto hash_model_inputs(
+   const fs::path& model, std::vector<Ci_string> materials,
+   const std::unordered_map<Ci_string, Material_options>& material_index) -> std::uint64_t
 {
-   const auto output_model_path = output_dir / model.filename();
+   std::sort(materials.begin(), materials.end());
+
+   Content_hasher hasher;
 
-   if (!fs::exists(output_model_path) || !fs::is_regular_file(output_model_path)) {
-      return false;
+   hasher.add(current_shader_patch_version_string);
+
+   const Memory_mapped_file file{model, Memory_mapped_file::Mode::read,
+                                 Memory_mapped_file::Access_hint::sequential};
+
+   hasher.add(file.bytes());
+
+   for (const auto& material : materials) {
+      hasher.add(std::string_view{material.data(), material.size()});
+
+      if (auto it = material_index.find(material); it != material_index.end()) {
+         hasher.add(nlohmann::json(it->second).dump());
+      }
    }
 
-   return fs::last_write_time(output_model_path) < fs::last_write_time(model);
+   return hasher.result();
 }
 
 void fixup_munged_models(
    const fs::path& output_dir,
    const std::unordered_map<Ci_string, std::vector<fs::path>>& texture_references,
    const std::unordered_map<Ci_string, Material_options>& material_index,
-   const std::unordered_set<Ci_string>& changed_materials,
-   const bool patch_material_flags)
+   Munge_cache& cache, const bool patch_material_flags)
 {
-   std::set<fs::path> affected_models;
-
-   std::for_each(texture_references.cbegin(), texture_references.cend(),
-                 [&](const std::pair<Ci_string, std::vector<fs::path>>& tex_ref) noexcept {
-                    for (const auto& model : tex_ref.second) {
-                       if (changed_materials.count(tex_ref.first) ||
-                           (material_index.count(tex_ref.first) &&
-                            output_model_out_of_date(model, output_dir))) {
-                          affected_models.insert(model);
-                       }
-                    }
-                 });
-
-   std::for_each(std::execution::par, affected_models.cbegin(),
-                 affected_models.cend(), [&](const fs::path& input_path) noexcept {
-                    const auto output_file_path = output_dir / input_path.filename();
-                    const auto extension = input_path.extension() += ".req"sv;
-
-                    auto req_file_path = input_path;
-                    req_file_path.replace_extension(extension);
-
-                    if (fs::exists(req_file_path)) {
-                       auto output_req_file_path = output_file_path;
-                       output_req_file_path.replace_extension(extension);
-
-                       fs::copy_file(req_file_path, output_req_file_path,
-                                     fs::copy_options::overwrite_existing);
-                    }
-
-                    synced_print("Editing "sv, output_file_path.filename().string(),
-                                 " for Shader Patch..."sv);
-
-                    try {
-                       patch_model(input_path, output_file_path, material_index,
-                                   patch_material_flags);
-                    }
-                    catch (std::exception& e) {
-                       synced_error_print(e.what());
-                    }
-                 });
+   std::map<fs::path, std::vector<Ci_string>> candidate_models;
+
+   for (const auto& [texture, models] : texture_references) {
+      for (const auto& model : models) {
+         candidate_models[model].push_back(texture);
+      }
+   }
+
+   // Only models that reference at least one Shader Patch material need patching.
+   std::erase_if(candidate_models, [&](const auto& model) {
+      return std::none_of(model.second.cbegin(), model.second.cend(),
+                          [&](const Ci_string& texture) {
+                             return material_index.contains(texture);
+                          });
+   });
+
+   std::mutex cache_mutex;
+   std::unordered_map<std::string, std::uint64_t> patched_models;
+
+   std::for_each(
+      std::execution::par, candidate_models.cbegin(), candidate_models.cend(),
+      [&](const std::pair<const fs::path, std::vector<Ci_string>>& candidate) noexcept {
+         const auto& input_path = candidate.first;
+         const auto output_file_path = output_dir / input_path.filename();
+         const auto cache_key = input_path.filename().string();
+
+         try {
+            const auto inputs_hash =
+               hash_model_inputs(input_path, candidate.second, material_index);
+
+            if (auto it = cache.models.find(cache_key);
+                it != cache.models.end() && it->second == inputs_hash &&
+                fs::exists(output_file_path)) {
+               std::scoped_lock lock{cache_mutex};
+
+               patched_models.emplace(cache_key, inputs_hash);
+
+               return;
+            }
+
+            const auto extension = input_path.extension() += ".req"sv;
+
+            auto req_file_path = input_path;
+            req_file_path.replace_extension(extension);
+
+            if (fs::exists(req_file_path)) {
+               auto output_req_file_path = output_file_path;
+               output_req_file_path.replace_extension(extension);
+
+               fs::copy_file(req_file_path, output_req_file_path,
+                             fs::copy_options::overwrite_existing);
+            }
+
+            synced_print("Editing "sv, output_file_path.filename().string(),
+                         " for Shader Patch..."sv);
+
+            auto temp_output_path = output_file_path;
+            temp_output_path += ".tmp"sv;
+
+            patch_model(input_path, temp_output_path, material_index,
+                        patch_material_flags);
+
+            fs::rename(temp_output_path, output_file_path);
+
+            std::scoped_lock lock{cache_mutex};
+
+            patched_models.emplace(cache_key, inputs_hash);
+         }
+         catch (std::exception& e) {
+            synced_error_print(e.what());
+         }
+      });
+
+   cache.models = std::move(patched_models);
 }
 }
 
@@ -224,9 +370,9 @@ void munge_materials(const fs::path& output_dir,
                      const std::unordered_map<Ci_string, YAML::Node>& descriptions,
                      const bool patch_material_flags)
 {
-   std::unordered_set<Ci_string> changed_materials;
+   auto cache = load_munge_cache(output_dir, patch_material_flags);
 
-   auto [partial_munge, index] = load_materials_index(output_dir);
+   std::unordered_map<Ci_string, Material_options> index;
 
    for (auto& file : files) {
       try {
@@ -234,27 +380,42 @@ void munge_materials(const fs::path& output_dir,
 
          const auto output_file_path =
             output_dir / file.second.stem().replace_extension(".texture"s);
+         const auto material_name = make_ci_string(file.second.stem().string());
+         const auto source_hash = hash_file(file.second);
+
+         if (auto it = cache.materials.find(material_name);
+             it != cache.materials.end() && it->second.source_hash == source_hash &&
+             fs::exists(output_file_path)) {
+            index[material_name] = it->second.options;
 
-         if (partial_munge && fs::exists(output_file_path) &&
-             (fs::last_write_time(file.second) < fs::last_write_time(output_file_path))) {
             continue;
          }
 
+         cache.materials.erase(material_name);
+
          synced_print("Munging "sv, file.first, "..."sv);
 
          const auto options = munge_material(file.second, output_file_path,
                                              descriptions, patch_material_flags);
 
-         index[make_ci_string(file.second.stem().string())] = options;
-         changed_materials.emplace(make_ci_string(file.second.stem().string()));
+         index[material_name] = options;
+         cache.materials[material_name] = {.source_hash = source_hash,
+                                           .options = options};
       }
       catch (std::exception& e) {
          synced_error_print("Error munging "sv, file.first, ": "sv, e.what());
       }
    }
 
-   fixup_munged_models(output_dir, texture_references, index, changed_materials,
+   // Drop materials whose source has gone away.
+   std::erase_if(cache.materials,
+                 [&](const auto& material) { return !index.contains(material.first); });
+
+   // Save now so the material work survives a crash while patching models.
+   save_munge_cache(output_dir, cache, patch_material_flags);
+
+   fixup_munged_models(output_dir, texture_references, index, cache,
                        patch_material_flags);
-   save_materials_index(output_dir, index);
+   save_munge_cache(output_dir, cache, patch_material_flags);
 }
 }
@@ -75,7 +75,8 @@ bool should_modelify_terrain(const fs::file_time_type config_last_write_time,
 void munge_terrain_materials(const std::unordered_map<Ci_string, std::filesystem::path>& source_files,
                              const std::filesystem::path& output_munge_files_dir,
                              const std::filesystem::path& input_munge_files_dir,
-                             const std::filesystem::path& input_sptex_files_dir) noexcept
+                             const std::filesystem::path& input_sptex_files_dir,
+                             const Terrain_segment_execution segment_execution) noexcept
 {
    for (const auto& file : source_files) {
       try {
@@ -98,7 +99,7 @@ void munge_terrain_materials(const std::unordered_map<Ci_string, std::filesystem
                                      terrain_output_file_path)) {
             terrain_modelify(terrain_map, terrain_suffix,
                              config.far_terrain == Terrain_far::fullres,
-                             config.use_ze_static_lighting,
+                             config.use_ze_static_lighting, segment_execution,
                              munged_terrain_input_file_path, terrain_output_file_path);
          }
 
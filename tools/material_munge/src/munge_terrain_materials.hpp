@@ -1,5 +1,6 @@
 
 #include "string_utilities.hpp"
+#include "terrain_model_segment.hpp"
 
 #include <filesystem>
 #include <unordered_map>
@@ -10,6 +11,7 @@ void munge_terrain_materials(
    const std::unordered_map<Ci_string, std::filesystem::path>& source_files,
    const std::filesystem::path& output_munge_files_dir,
    const std::filesystem::path& input_munge_files_dir,
-   const std::filesystem::path& input_sptex_files_dir) noexcept;
+   const std::filesystem::path& input_sptex_files_dir,
+   const Terrain_segment_execution segment_execution) noexcept;
 
 }
@@ -1,15 +1,309 @@
-
 #include "terrain_cut.hpp"
 #include "terrain_vertex_buffer.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <numeric>
+
+#include <absl/container/inlined_vector.h>
 
 namespace sp {
 
-void Terrain_cut::apply(Terrain_triangle_list&) const noexcept
+namespace {
+
+// Clipping a triangle against a handful of planes produces small polygons.
+using Polygon = absl::InlinedVector<Terrain_vertex, 8>;
+
+constexpr std::size_t max_bvh_leaf_cuts = 4;
+
+// Vertices this close to a plane are treated as on it. Keeps slivers from
+// being created when a cut plane runs along triangle edges.
+constexpr float plane_epsilon = 1e-4f;
+
+struct Aabb {
+   glm::vec3 min{std::numeric_limits<float>::max()};
+   glm::vec3 max{std::numeric_limits<float>::lowest()};
+};
+
+bool intersects(const Aabb& l, const Aabb& r) noexcept
+{
+   return glm::all(glm::lessThanEqual(l.min, r.max)) &&
+          glm::all(glm::greaterThanEqual(l.max, r.min));
+}
+
+auto cut_bounds(const Terrain_cut& cut) noexcept -> Aabb
+{
+   return {.min = cut.centre - cut.radius, .max = cut.centre + cut.radius};
+}
+
+auto triangle_bounds(const Terrain_triangle& tri) noexcept -> Aabb
+{
+   return {.min = glm::min(glm::min(tri[0].position, tri[1].position), tri[2].position),
+           .max = glm::max(glm::max(tri[0].position, tri[1].position), tri[2].position)};
+}
+
+auto plane_distance(const glm::vec4 plane, const glm::vec3 point) noexcept -> float
+{
+   return glm::dot(glm::vec3{plane}, point) + plane.w;
+}
+
+auto lerp_vertex(const Terrain_vertex& v0, const Terrain_vertex& v1,
+                 const float t) noexcept -> Terrain_vertex
 {
-   if (planes.empty()) return;
+   Terrain_vertex vertex = v0;
+
+   vertex.position = glm::mix(v0.position, v1.position, t);
+   vertex.normal = glm::normalize(glm::mix(v0.normal, v1.normal, t));
+   vertex.diffuse_lighting = glm::mix(v0.diffuse_lighting, v1.diffuse_lighting, t);
+   vertex.base_color = glm::mix(v0.base_color, v1.base_color, t);
+
+   for (std::size_t i = 0; i < vertex.texture_blend.size(); ++i) {
+      vertex.texture_blend[i] = glm::mix(v0.texture_blend[i], v1.texture_blend[i], t);
+   }
+
+   return vertex;
+}
+
+// Split a convex polygon by a plane into the part in front of it and the part
+// behind it. Either may end up empty.
+void split_polygon(const Polygon& polygon, const glm::vec4 plane, Polygon& front,
+                   Polygon& back) noexcept
+{
+   front.clear();
+   back.clear();
+
+   // A polygon lying on the plane is on the surface of the cut, keep it.
+   if (std::ranges::all_of(polygon, [&](const Terrain_vertex& vertex) {
+          return std::abs(plane_distance(plane, vertex.position)) <= plane_epsilon;
+       })) {
+      front = polygon;
+
+      return;
+   }
+
+   for (std::size_t i = 0; i < polygon.size(); ++i) {
+      const auto& v0 = polygon[i];
+      const auto& v1 = polygon[(i + 1) % polygon.size()];
+
+      const float d0 = plane_distance(plane, v0.position);
+      const float d1 = plane_distance(plane, v1.position);
+
+      if (d0 >= -plane_epsilon) front.push_back(v0);
+      if (d0 <= plane_epsilon) back.push_back(v0);
+
+      if ((d0 > plane_epsilon && d1 < -plane_epsilon) ||
+          (d0 < -plane_epsilon && d1 > plane_epsilon)) {
+         const auto split = lerp_vertex(v0, v1, d0 / (d0 - d1));
+
+         front.push_back(split);
+         back.push_back(split);
+      }
+   }
+
+   if (front.size() < 3) front.clear();
+   if (back.size() < 3) back.clear();
+}
+
+// Removes the part of `polygon` inside `cut`. The pieces outside the cut are
+// appended to `output`.
+void subtract_cut(const Polygon& polygon, const Terrain_cut& cut,
+                  std::vector<Polygon>& output) noexcept
+{
+   Polygon remaining = polygon;
+   Polygon front;
+   Polygon back;
+
+   for (const auto& plane : cut.planes) {
+      split_polygon(remaining, plane, front, back);
+
+      if (!front.empty()) output.push_back(front);
+      if (back.empty()) return;
+
+      std::swap(remaining, back);
+   }
+
+   // Whatever is left is behind every plane and so inside the cut.
+}
+
+bool outside_cut(const Terrain_triangle& tri, const Terrain_cut& cut) noexcept
+{
+   return std::ranges::any_of(cut.planes, [&](const glm::vec4 plane) {
+      return std::ranges::all_of(tri, [&](const Terrain_vertex& vertex) {
+         return plane_distance(plane, vertex.position) >= -plane_epsilon;
+      });
+   });
+}
+
+// BVH over the cut bounds so triangles only get tested against cuts near
+// them. Leaves reference a run of `cut_indices`, interior nodes have their
+// children at `first` and `first + 1`.
+class Cut_bvh {
+public:
+   explicit Cut_bvh(std::span<const Terrain_cut> cuts) noexcept : _cuts{cuts}
+   {
+      _cut_indices.resize(cuts.size());
+
+      std::iota(_cut_indices.begin(), _cut_indices.end(), std::uint32_t{0});
+
+      if (cuts.empty()) return;
+
+      _nodes.reserve(cuts.size() * 2);
+      _nodes.emplace_back();
+
+      build(0, 0, cuts.size());
+   }
+
+   //! Find the cuts that may overlap `bounds`, in the order they are in the map.
+   void query(const Aabb& bounds, std::vector<std::uint32_t>& results) const noexcept
+   {
+      results.clear();
+
+      if (_nodes.empty()) return;
+
+      std::array<std::uint32_t, 64> stack;
+      std::size_t stack_size = 0;
+
+      stack[stack_size++] = 0;
+
+      while (stack_size > 0) {
+         const auto& node = _nodes[stack[--stack_size]];
+
+         if (!intersects(node.bounds, bounds)) continue;
+
+         if (node.count == 0) {
+            stack[stack_size++] = node.first;
+            stack[stack_size++] = node.first + 1;
+
+            continue;
+         }
+
+         for (std::uint32_t i = node.first; i < (node.first + node.count); ++i) {
+            if (intersects(cut_bounds(_cuts[_cut_indices[i]]), bounds)) {
+               results.push_back(_cut_indices[i]);
+            }
+         }
+      }
+
+      std::ranges::sort(results);
+   }
+
+private:
+   struct Node {
+      Aabb bounds;
+      std::uint32_t first = 0;
+      std::uint32_t count = 0;
+   };
+
+   void build(const std::size_t node_index, const std::size_t begin,
+              const std::size_t end) noexcept
+   {
+      Aabb bounds;
+      Aabb centre_bounds;
+
+      for (std::size_t i = begin; i < end; ++i) {
+         const auto& cut = _cuts[_cut_indices[i]];
+         const auto cut_aabb = cut_bounds(cut);
+
+         bounds.min = glm::min(bounds.min, cut_aabb.min);
+         bounds.max = glm::max(bounds.max, cut_aabb.max);
+         centre_bounds.min = glm::min(centre_bounds.min, cut.centre);
+         centre_bounds.max = glm::max(centre_bounds.max, cut.centre);
+      }
+
+      _nodes[node_index].bounds = bounds;
+
+      if ((end - begin) <= max_bvh_leaf_cuts) {
+         _nodes[node_index].first = static_cast<std::uint32_t>(begin);
+         _nodes[node_index].count = static_cast<std::uint32_t>(end - begin);
+
+         return;
+      }
+
+      const auto extent = centre_bounds.max - centre_bounds.min;
+      const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                           : (extent.y > extent.z ? 1 : 2);
+      const auto middle = begin + (end - begin) / 2;
+
+      std::nth_element(_cut_indices.begin() + begin, _cut_indices.begin() + middle,
+                       _cut_indices.begin() + end,
+                       [&](const std::uint32_t l, const std::uint32_t r) {
+                          return _cuts[l].centre[axis] < _cuts[r].centre[axis];
+                       });
+
+      const auto children_index = _nodes.size();
+
+      _nodes[node_index].first = static_cast<std::uint32_t>(children_index);
+      _nodes[node_index].count = 0;
+
+      _nodes.emplace_back();
+      _nodes.emplace_back();
+
+      build(children_index, begin, middle);
+      build(children_index + 1, middle, end);
+   }
+
+   std::span<const Terrain_cut> _cuts;
+   std::vector<Node> _nodes;
+   std::vector<std::uint32_t> _cut_indices;
+};
+
+}
+
+void Terrain_cut::apply(Terrain_triangle_list& tris) const noexcept
+{
+   apply_terrain_cuts(std::span{this, 1}, tris);
+}
+
+void apply_terrain_cuts(std::span<const Terrain_cut> cuts,
+                        Terrain_triangle_list& tris) noexcept
+{
+   if (cuts.empty()) return;
+
+   const Cut_bvh bvh{cuts};
+
+   Terrain_triangle_list output;
+   output.reserve(tris.size());
+
+   std::vector<std::uint32_t> candidate_cuts;
+   std::vector<Polygon> pieces;
+   std::vector<Polygon> next_pieces;
+
+   for (const auto& tri : tris) {
+      bvh.query(triangle_bounds(tri), candidate_cuts);
+
+      std::erase_if(candidate_cuts, [&](const std::uint32_t cut_index) {
+         return cuts[cut_index].planes.empty() || outside_cut(tri, cuts[cut_index]);
+      });
+
+      if (candidate_cuts.empty()) {
+         output.push_back(tri);
+
+         continue;
+      }
+
+      pieces.clear();
+      pieces.emplace_back(tri.begin(), tri.end());
+
+      for (const auto cut_index : candidate_cuts) {
+         next_pieces.clear();
+
+         for (const auto& piece : pieces) {
+            subtract_cut(piece, cuts[cut_index], next_pieces);
+         }
+
+         std::swap(pieces, next_pieces);
+
+         if (pieces.empty()) break;
+      }
+
+      for (const auto& piece : pieces) {
+         for (std::size_t i = 2; i < piece.size(); ++i) {
+            output.push_back({piece[0], piece[i - 1], piece[i]});
+         }
+      }
+   }
 
-   // TODO: Clip triangles here.
+   tris = std::move(output);
 }
 }
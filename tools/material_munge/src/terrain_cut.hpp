@@ -2,6 +2,7 @@
 
 #include <array>
 #include <optional>
+#include <span>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -10,6 +11,8 @@ namespace sp {
 
 struct Terrain_vertex;
 
+//! A convex volume to remove from the terrain. Points are inside the cut when
+//! they are behind (dot(plane.xyz, point) + plane.w <= 0) every plane.
 struct Terrain_cut {
    glm::vec3 centre;
    float radius;
@@ -18,4 +21,9 @@ struct Terrain_cut {
    void apply(std::vector<std::array<Terrain_vertex, 3>>& tris) const noexcept;
 };
 
+//! Remove the parts of the triangles inside any of the cuts. Triangles
+//! partially inside a cut are split along its planes.
+void apply_terrain_cuts(std::span<const Terrain_cut> cuts,
+                        std::vector<std::array<Terrain_vertex, 3>>& tris) noexcept;
+
 }
@@ -2,8 +2,12 @@
 #include "terrain_downsample.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <execution>
 #include <limits>
+#include <vector>
 
 #include <gsl/gsl>
 
@@ -19,123 +23,134 @@ auto index(const int length, const int x, const int y)
    return x_clamped + (y_clamped * length);
 }
 
-template<typename Type>
-auto array_type_len(const Type& type) -> decltype(type.length())
+// Output is processed in square tiles so the footprints of one tile cover a
+// compact block of source rows, and all attributes of a source texel are read
+// together in a single pass. Sums are accumulated in the same order as a
+// per-attribute pass would, so results do not depend on the tiling.
+constexpr int downsample_tile_length = 32;
+
+struct Downsample_context {
+   const Terrain_map& input;
+   Terrain_map& output;
+   int footprint;
+   float inv_total_weight;
+
+   float x_begin;
+   float x_end;
+   float z_begin;
+   float z_end;
+
+   // Clamped source coordinate for every footprint texel of every output
+   // coordinate, indexed by (output * footprint) + offset.
+   std::vector<int> source_coords;
+};
+
+void downsample_texel(const Downsample_context& context, const int x,
+                      const int y) noexcept
 {
-   return type.length();
-}
+   const auto& input = context.input;
+   auto& output = context.output;
+   const auto footprint = context.footprint;
 
-template<typename Type>
-auto array_type_len(const Type& type) -> decltype(type.size())
-{
-   return type.size();
-}
+   float height = 0.0f;
+   glm::vec3 color{};
+   glm::vec3 diffuse_lighting{};
+   std::array<float, 16> texture_weights{};
 
-template<typename Type>
-auto sample(const std::unique_ptr<Type[]>& data, const int length,
-            const int x_offs, const int y_offs, const int footprint) -> Type
-{
-   const auto inv_total_weight = 1.0f / (footprint * footprint);
-   Type total{};
+   for (auto y_offs = 0; y_offs < footprint; ++y_offs) {
+      const auto row = context.source_coords[y * footprint + y_offs] * input.length;
+
+      for (auto x_offs = 0; x_offs < footprint; ++x_offs) {
+         const auto i = row + context.source_coords[x * footprint + x_offs];
 
-   for (auto y = y_offs; y < (y_offs + footprint); ++y) {
-      for (auto x = x_offs; x < (x_offs + footprint); ++x) {
-         const auto& v = data[index(length, x, y)];
+         height += input.position[i].y;
+         color += input.color[i];
+         diffuse_lighting += input.diffuse_lighting[i];
 
-         for (auto i = 0; i < array_type_len(v); ++i) {
-            total[i] += v[i];
+         for (std::size_t w = 0; w < texture_weights.size(); ++w) {
+            texture_weights[w] += input.texture_weights[i][w];
          }
       }
    }
 
-   for (auto i = 0; i < array_type_len(total); ++i) {
-      total[i] *= inv_total_weight;
-   }
+   const auto inv_total_weight = context.inv_total_weight;
+   const auto out_index = index(output.length, x, y);
 
-   return total;
-}
+   output.position[out_index] =
+      {glm::mix(context.x_begin, context.x_end, x / (output.length - 1.0f)),
+       height * inv_total_weight,
+       glm::mix(context.z_begin, context.z_end, y / (output.length - 1.0f))};
+   output.color[out_index] = color * inv_total_weight;
+   output.diffuse_lighting[out_index] = diffuse_lighting * inv_total_weight;
 
-void downsample_positions(const Terrain_map& input, const Terrain_map& output,
-                          const int footprint) noexcept
-{
-   const auto x_begin = input.position[index(input.length, 0, 0)].x;
-   const auto x_end = input.position[index(input.length, input.length - 1, 0)].x;
-   const auto z_begin = input.position[index(input.length, 0, 0)].z;
-   const auto z_end = input.position[index(input.length, 0, input.length - 1)].z;
-
-   for (auto y = 0; y < output.length; ++y) {
-      for (auto x = 0; x < output.length; ++x) {
-         const float x_pos = glm::mix(x_begin, x_end, x / (output.length - 1.0f));
-
-         const float z_pos = glm::mix(z_begin, z_end, y / (output.length - 1.0f));
-
-         output.position[index(output.length, x, y)] = {x_pos,
-                                                        sample(input.position,
-                                                               input.length, x * footprint,
-                                                               y * footprint, footprint)
-                                                           .y,
-                                                        z_pos};
-      }
-   }
-}
+   for (auto& weight : texture_weights) weight *= inv_total_weight;
 
-void downsample_color(const Terrain_map& input, const Terrain_map& output,
-                      const int footprint)
-{
-   for (auto y = 0; y < output.length; ++y) {
-      for (auto x = 0; x < output.length; ++x) {
-         output.color[index(output.length, x, y)] =
-            sample(input.color, input.length, x * footprint, y * footprint, footprint);
-      }
-   }
+   output.texture_weights[out_index] = texture_weights;
 }
 
-void downsample_diffuse_lighting(const Terrain_map& input,
-                                 const Terrain_map& output, const int footprint)
+void downsample_into(const Terrain_map& input, Terrain_map& output) noexcept
 {
-   for (auto y = 0; y < output.length; ++y) {
-      for (auto x = 0; x < output.length; ++x) {
-         output.diffuse_lighting[index(output.length, x, y)] =
-            sample(input.diffuse_lighting, input.length, x * footprint,
-                   y * footprint, footprint);
-      }
+   const auto footprint = static_cast<int>(std::ceil(
+      static_cast<double>(input.length) / static_cast<double>(output.length)));
+
+   Downsample_context context{
+      .input = input,
+      .output = output,
+      .footprint = footprint,
+      .inv_total_weight = 1.0f / (footprint * footprint),
+      .x_begin = input.position[index(input.length, 0, 0)].x,
+      .x_end = input.position[index(input.length, input.length - 1, 0)].x,
+      .z_begin = input.position[index(input.length, 0, 0)].z,
+      .z_end = input.position[index(input.length, 0, input.length - 1)].z};
+
+   context.source_coords.resize(output.length * footprint);
+
+   for (auto i = 0; i < static_cast<int>(context.source_coords.size()); ++i) {
+      context.source_coords[i] = std::clamp(i, 0, input.length - 1);
    }
-}
 
-void downsample_texture_weights(const Terrain_map& input,
-                                const Terrain_map& output, const int footprint)
-{
-   for (auto y = 0; y < output.length; ++y) {
-      for (auto x = 0; x < output.length; ++x) {
-         output.texture_weights[index(output.length, x, y)] =
-            sample(input.texture_weights, input.length, x * footprint,
-                   y * footprint, footprint);
+   const auto tiles_per_row =
+      (output.length + downsample_tile_length - 1) / downsample_tile_length;
+
+   const auto process_tile = [&](const std::ptrdiff_t tile) noexcept {
+      const auto tile_x = static_cast<int>(tile % tiles_per_row) * downsample_tile_length;
+      const auto tile_y = static_cast<int>(tile / tiles_per_row) * downsample_tile_length;
+      const auto x_end = std::min(tile_x + downsample_tile_length, int{output.length});
+      const auto y_end = std::min(tile_y + downsample_tile_length, int{output.length});
+
+      for (auto y = tile_y; y < y_end; ++y) {
+         for (auto x = tile_x; x < x_end; ++x) {
+            downsample_texel(context, x, y);
+         }
       }
-   }
-}
+   };
+
+   std::for_each_n(std::execution::par, Index_iterator{},
+                   tiles_per_row * tiles_per_row, process_tile);
 }
 
-auto terrain_downsample(const Terrain_map& input, const std::uint16_t new_length)
+auto make_downsampled_map(const Terrain_map& input, const std::uint16_t new_length)
    -> Terrain_map
 {
-   Expects(new_length > 1);
-
-   if (new_length >= input.length) return Terrain_map{input};
-
    Terrain_map output{new_length};
 
    output.texture_names = input.texture_names;
    output.texture_transforms = input.texture_transforms;
    output.cuts = input.cuts;
 
-   const auto footprint = static_cast<int>(std::ceil(
-      static_cast<double>(input.length) / static_cast<double>(new_length)));
-
-   downsample_positions(input, output, footprint);
-   downsample_color(input, output, footprint);
-   downsample_diffuse_lighting(input, output, footprint);
-   downsample_texture_weights(input, output, footprint);
+   downsample_into(input, output);
 
    return output;
 }
 }
+
+auto terrain_downsample(const Terrain_map& input, const std::uint16_t new_length)
+   -> Terrain_map
+{
+   Expects(new_length > 1);
+
+   if (new_length >= input.length) return Terrain_map{input};
+
+   return make_downsampled_map(input, new_length);
+}
+}
@@ -49,8 +49,8 @@ struct Terrain_color {
 
    operator glm::vec4() const noexcept
    {
-      return decompress_srgb(
-         glm::vec4{red / 255.f, green / 255.f, blue / 255.f, alpha / 255.f});
+      return {decompress_srgb_unorm8(red), decompress_srgb_unorm8(green),
+              decompress_srgb_unorm8(blue), alpha / 255.f};
    };
 };
 
@@ -275,7 +275,8 @@ void read_texture_weights(std::ifstream& file,
    }
 }
 
-auto read_terrain_cuts(std::ifstream& file) -> std::vector<Terrain_cut>
+auto read_terrain_cuts(std::ifstream& file, const glm::vec3 terrain_offset)
+   -> std::vector<Terrain_cut>
 {
    std::int32_t size{};
 
@@ -299,13 +300,16 @@ auto read_terrain_cuts(std::ifstream& file) -> std::vector<Terrain_cut>
       std::array<glm::vec3, 2> aabb;
       file.read(reinterpret_cast<char*>(aabb.data()), sizeof(aabb));
 
-      cut.centre = aabb[0] + aabb[1] / 2.0f;
+      cut.centre = (aabb[0] + aabb[1]) / 2.0f + terrain_offset;
       cut.radius = glm::distance(aabb[0], aabb[1]) / 2.0f;
 
       cut.planes.resize(plane_count);
 
       for (auto& plane : cut.planes) {
-         file.read(reinterpret_cast<char*>(&plane), sizeof(aabb));
+         file.read(reinterpret_cast<char*>(&plane), sizeof(plane));
+
+         // Move the plane along with the terrain.
+         plane.w -= glm::dot(glm::vec3{plane}, terrain_offset);
       }
    }
 
@@ -392,7 +396,7 @@ auto load_terrain_map(const std::filesystem::path& path,
       file.seekg(262144, std::ios::cur); // Unknown data
       file.seekg(131072, std::ios::cur); // Unknown data
 
-      map.cuts = read_terrain_cuts(file);
+      map.cuts = read_terrain_cuts(file, terrain_offset);
    }
    catch (std::ios_base::failure&) {
       // Sometimes terrain files end abruptly, terrainmunge
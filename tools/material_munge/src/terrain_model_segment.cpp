@@ -1,10 +1,13 @@
 
 #include "terrain_model_segment.hpp"
 #include "optimize_mesh.hpp"
+#include "utility.hpp"
 #include "weld_vertex_list.hpp"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <execution>
 #include <limits>
 #include <stdexcept>
 #include <tuple>
@@ -74,31 +77,53 @@ auto get_max_xy_length(const Terrain_triangle_list& triangles) noexcept -> float
    return glm::distance(min, max);
 }
 
+template<typename Func>
+void for_each_segment(const Terrain_segment_execution execution,
+                      const std::size_t segment_count, Func&& func) noexcept
+{
+   if (execution == Terrain_segment_execution::parallel) {
+      std::for_each_n(std::execution::par, Index_iterator{}, segment_count, func);
+   }
+   else {
+      std::for_each_n(Index_iterator{}, segment_count, func);
+   }
 }
 
-auto create_terrain_model_segments(const Terrain_triangle_list& triangles)
+}
+
+auto create_terrain_model_segments(const Terrain_triangle_list& triangles,
+                                   const Terrain_segment_execution execution)
    -> std::vector<Terrain_model_segment>
 {
    const auto sorted_tris =
       sort_into_segments(triangles, get_max_xy_length(triangles));
 
    std::vector<Terrain_model_segment> segments;
-   segments.reserve(segment_grid_length * segment_grid_length);
+   segments.resize(segment_grid_length * segment_grid_length);
+
+   // Exceptions can't leave a parallel algorithm so just note the failure
+   // and throw once every segment is done.
+   std::atomic_bool too_many_vertices = false;
 
-   for (auto& row : sorted_tris) {
-      for (auto& tris : row) {
-         auto indexed_tris = weld_vertex_list(tris);
+   for_each_segment(execution, segments.size(), [&](const std::size_t i) {
+      const auto& tris = sorted_tris[i / segment_grid_length][i % segment_grid_length];
 
-         if (indexed_tris.second.size() > std::numeric_limits<std::uint16_t>::max()) {
-            throw std::runtime_error{
-               "Terrain has too many vertices to handle!"};
-         }
+      auto indexed_tris = weld_vertex_list(tris);
 
-         const auto bbox = get_bbox(indexed_tris.second);
+      if (indexed_tris.second.size() > std::numeric_limits<std::uint16_t>::max()) {
+         too_many_vertices = true;
 
-         segments.push_back({shrink_index_buffer(indexed_tris.first),
-                             std::move(indexed_tris.second), bbox});
+         return;
       }
+
+      const auto bbox = get_bbox(indexed_tris.second);
+
+      segments[i] = {shrink_index_buffer(indexed_tris.first),
+                     std::move(indexed_tris.second), bbox};
+   });
+
+   if (too_many_vertices) {
+      throw std::runtime_error{"Terrain has too many vertices to handle!"};
    }
 
    return segments;
@@ -122,13 +147,16 @@ auto create_terrain_low_detail_model_segment(const Terrain_triangle_list& triang
    return segment;
 }
 
-auto optimize_terrain_model_segments(std::vector<Terrain_model_segment> segments) noexcept
+auto optimize_terrain_model_segments(std::vector<Terrain_model_segment> segments,
+                                     const Terrain_segment_execution execution) noexcept
    -> std::vector<Terrain_model_segment>
 {
-   for (auto& segment : segments) {
+   for_each_segment(execution, segments.size(), [&](const std::size_t i) {
+      auto& segment = segments[i];
+
       std::tie(segment.indices, segment.vertices) =
          optimize_mesh(std::move(segment.indices), std::move(segment.vertices));
-   }
+   });
 
    return segments;
 }
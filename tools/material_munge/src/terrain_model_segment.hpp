@@ -9,19 +9,25 @@
 
 namespace sp {
 
+//! How the independent segments of a terrain should be processed. Both produce
+//! identical output, segments are always returned in grid order.
+enum class Terrain_segment_execution { serial, parallel };
+
 struct Terrain_model_segment {
    Index_buffer_16 indices;
    Terrain_vertex_buffer vertices;
    std::array<glm::vec3, 2> bbox;
 };
 
-auto create_terrain_model_segments(const Terrain_triangle_list& triangles)
+auto create_terrain_model_segments(const Terrain_triangle_list& triangles,
+                                   const Terrain_segment_execution execution)
    -> std::vector<Terrain_model_segment>;
 
 auto create_terrain_low_detail_model_segment(const Terrain_triangle_list& triangles)
    -> Terrain_model_segment;
 
-auto optimize_terrain_model_segments(std::vector<Terrain_model_segment> segments) noexcept
+auto optimize_terrain_model_segments(std::vector<Terrain_model_segment> segments,
+                                     const Terrain_segment_execution execution) noexcept
    -> std::vector<Terrain_model_segment>;
 
 auto calculate_terrain_model_segments_aabb(const std::vector<Terrain_model_segment>& segments) noexcept
@@ -5,6 +5,7 @@
 #include "material_flags.hpp"
 #include "memory_mapped_file.hpp"
 #include "swbf_fnv_1a.hpp"
+#include "synced_io.hpp"
 #include "terrain_constants.hpp"
 #include "terrain_downsample.hpp"
 #include "terrain_model_segment.hpp"
@@ -13,7 +14,10 @@
 #include "ucfb_editor.hpp"
 #include "ucfb_writer.hpp"
 
+#include <chrono>
 #include <iomanip>
+#include <sstream>
+#include <string>
 
 #include <gsl/gsl>
 
@@ -39,10 +43,43 @@ auto create_low_detail_terrain(const Terrain_map& terrain) -> Terrain_model_segm
    const auto low_terrain_triangles = create_terrain_triangle_list(low_terrain);
 
    return optimize_terrain_model_segments(
-             {create_terrain_low_detail_model_segment(low_terrain_triangles)})
+             {create_terrain_low_detail_model_segment(low_terrain_triangles)},
+             Terrain_segment_execution::serial)
       .front();
 }
 
+// Times the stages of turning a terrain into models so slow terrains can be
+// looked into.
+class Stage_timer {
+public:
+   template<typename Func>
+   auto operator()(const std::string_view stage, Func&& func)
+   {
+      const auto start = std::chrono::steady_clock::now();
+
+      auto result = func();
+
+      if (_stage_count++ != 0) _report << ", "sv;
+
+      _report << stage << ' ' << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::milli>{
+                    std::chrono::steady_clock::now() - start}
+                    .count()
+              << "ms"sv;
+
+      return result;
+   }
+
+   auto report() const -> std::string
+   {
+      return _report.str();
+   }
+
+private:
+   std::ostringstream _report;
+   std::size_t _stage_count = 0;
+};
+
 auto sort_terrain_segments_into_models(std::vector<Terrain_model_segment> segments)
    -> std::vector<std::vector<Terrain_model_segment>>
 {
@@ -506,6 +543,7 @@ void write_req_path(const std::filesystem::path& main_output_path,
 
 void terrain_modelify(const Terrain_map& terrain, const std::string_view material_suffix,
                       const bool high_res_far_terrain, const bool keep_static_lighting,
+                      const Terrain_segment_execution segment_execution,
                       const std::filesystem::path& munged_input_terrain_path,
                       const std::filesystem::path& output_path)
 {
@@ -514,8 +552,8 @@ void terrain_modelify(const Terrain_map& terrain, const std::string_view materia
            fs::exists(output_path.parent_path()));
 
    ucfb::Editor editor = [&] {
-      win32::Memeory_mapped_file file{munged_input_terrain_path,
-                                      win32::Memeory_mapped_file::Mode::read};
+      Memory_mapped_file file{munged_input_terrain_path, Memory_mapped_file::Mode::read,
+                              Memory_mapped_file::Access_hint::sequential};
       const auto is_parent = [](const Magic_number mn) noexcept {
          return mn == "tern"_mn;
       };
@@ -528,12 +566,23 @@ void terrain_modelify(const Terrain_map& terrain, const std::string_view materia
 
    remove_tern_geometry(tern_editor);
 
-   const auto terrain_triangle_list = create_terrain_triangle_list(terrain);
-   const auto terrain_model_segments = optimize_terrain_model_segments(
-      create_terrain_model_segments(terrain_triangle_list));
-   const auto terrain_low_detail_segment =
-      !high_res_far_terrain ? std::optional{create_low_detail_terrain(terrain)}
-                            : std::nullopt;
+   Stage_timer timer;
+
+   const auto terrain_triangle_list =
+      timer("triangles"sv, [&] { return create_terrain_triangle_list(terrain); });
+   auto terrain_model_segments = timer("segments"sv, [&] {
+      return create_terrain_model_segments(terrain_triangle_list, segment_execution);
+   });
+   terrain_model_segments = timer("optimize"sv, [&] {
+      return optimize_terrain_model_segments(std::move(terrain_model_segments),
+                                             segment_execution);
+   });
+   const auto terrain_low_detail_segment = timer("low detail"sv, [&] {
+      return !high_res_far_terrain ? std::optional{create_low_detail_terrain(terrain)}
+                                   : std::nullopt;
+   });
+
+   synced_print("Terrain "sv, material_suffix, " modelify timings: "sv, timer.report());
 
    std::string material_name{terrain_material_name};
    material_name += material_suffix;
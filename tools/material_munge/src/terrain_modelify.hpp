@@ -1,6 +1,7 @@
 #pragma once
 
 #include "terrain_map.hpp"
+#include "terrain_model_segment.hpp"
 
 #include <filesystem>
 
@@ -8,6 +9,7 @@ namespace sp {
 
 void terrain_modelify(const Terrain_map& terrain, const std::string_view material_suffix,
                       const bool high_res_far_terrain, const bool keep_static_lighting,
+                      const Terrain_segment_execution segment_execution,
                       const std::filesystem::path& munged_input_terrain_path,
                       const std::filesystem::path& output_path);
 
@@ -280,7 +280,7 @@ auto pack_vertex(const Terrain_vertex& vertex,
    packed.normal |= pack_unorm(vertex.normal.z * 0.5f + 0.5f) << 24;
 
    const auto srgb_color =
-      compress_srgb(pack_lighting ? vertex.diffuse_lighting : glm::vec3{0.0f});
+      compress_srgb_fast(pack_lighting ? vertex.diffuse_lighting : glm::vec3{0.0f});
 
    packed.tangent |= pack_unorm(srgb_color.r) << 16;
    packed.tangent |= pack_unorm(srgb_color.g) << 8;
@@ -296,11 +296,9 @@ auto create_terrain_triangle_list(const Terrain_map& terrain) -> Terrain_triangl
 
    auto triangles = create_terrain_triangles(terrain);
 
-   for (const auto& cut : terrain.cuts) {
-      cut.apply(triangles);
-   }
+   apply_terrain_cuts(terrain.cuts, triangles);
 
-   return create_terrain_triangles(terrain);
+   return triangles;
 }
 
 void output_vertex_buffer(const Terrain_vertex_buffer& vertex_buffer,
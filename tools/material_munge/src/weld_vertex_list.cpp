@@ -1,9 +1,13 @@
 
 #include "weld_vertex_list.hpp"
 
-#include <execution>
-#include <mutex>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/inlined_vector.h>
 #include <gsl/gsl>
 
 namespace sp {
@@ -16,6 +20,66 @@ constexpr auto texcoords_max_diff = 1.f / 2048.f;
 constexpr auto terrain_blend_threshold = (1.f / 255.5f);
 constexpr auto terrain_color_threshold = (1.f / 255.5f);
 
+// Cells are twice as wide as pos_max_diff so that any two positions close
+// enough to be welded are always at most one cell apart on each axis, even
+// after rounding in the quantization.
+constexpr auto weld_grid_cell_size = pos_max_diff * 2.0f;
+
+// Spatial hash of already welded vertices keyed on their quantized position.
+// Lookups visit the 27 cells around a position and return the lowest similar
+// index, giving the exact same result as a linear scan over every vertex.
+class Weld_grid {
+public:
+   template<typename Is_similar>
+   auto find(const glm::vec3 position, Is_similar&& is_similar) const noexcept -> int
+   {
+      const auto center = cell_for(position);
+
+      int result = -1;
+
+      for (auto z = -1; z <= 1; ++z) {
+         for (auto y = -1; y <= 1; ++y) {
+            for (auto x = -1; x <= 1; ++x) {
+               const auto it = _cells.find(
+                  Cell{center[0] + x, center[1] + y, center[2] + z});
+
+               if (it == _cells.end()) continue;
+
+               // Indices in a cell are always ascending.
+               for (const int index : it->second) {
+                  if (result != -1 && index >= result) break;
+
+                  if (is_similar(index)) {
+                     result = index;
+
+                     break;
+                  }
+               }
+            }
+         }
+      }
+
+      return result;
+   }
+
+   void insert(const glm::vec3 position, const int index) noexcept
+   {
+      _cells[cell_for(position)].push_back(index);
+   }
+
+private:
+   using Cell = std::array<std::int64_t, 3>;
+
+   static auto cell_for(const glm::vec3 position) noexcept -> Cell
+   {
+      return {static_cast<std::int64_t>(std::floor(position.x / weld_grid_cell_size)),
+              static_cast<std::int64_t>(std::floor(position.y / weld_grid_cell_size)),
+              static_cast<std::int64_t>(std::floor(position.z / weld_grid_cell_size))};
+   }
+
+   absl::flat_hash_map<Cell, absl::InlinedVector<int, 4>> _cells;
+};
+
 auto init_vertex_buffer(const Vertex_buffer& old_vbuf) noexcept -> Vertex_buffer
 {
    Vertex_buffer vertex_buffer{};
@@ -178,34 +242,25 @@ bool is_vertex_similar(const Terrain_vertex& left, const Terrain_vertex& right)
    return false;
 }
 
-auto find_similar_vertex(const Vertex_buffer& ref_vbuf, const int ref_index,
-                         const Vertex_buffer& in_vbuf) noexcept -> int
+auto vertex_position(const Vertex_buffer& vbuf, const int index) noexcept -> glm::vec3
 {
-   for (auto v = 0; v < in_vbuf.count; ++v) {
-      if (is_vertex_similar(ref_vbuf, ref_index, in_vbuf, v)) return v;
-   }
-
-   return -1;
-}
-
-auto find_similar_vertex(const Terrain_vertex& ref_vertex,
-                         const Terrain_vertex_buffer& vertices) noexcept -> int
-{
-   for (auto v = 0; v < vertices.size(); ++v) {
-      if (is_vertex_similar(ref_vertex, vertices[v])) return v;
-   }
-
-   return -1;
+   // Vertices without positions all share the same cell.
+   return vbuf.positions ? vbuf.positions[index] : glm::vec3{0.0f};
 }
 
-auto add_terrain_vertex(Terrain_vertex_buffer& buffer, const Terrain_vertex& vertex)
-   -> std::uint32_t
+auto add_terrain_vertex(Terrain_vertex_buffer& buffer, Weld_grid& grid,
+                        const Terrain_vertex& vertex) -> std::uint32_t
 {
-   if (const auto index = find_similar_vertex(vertex, buffer); index != -1) {
+   if (const auto index = grid.find(vertex.position,
+                                    [&](const int v) {
+                                       return is_vertex_similar(vertex, buffer[v]);
+                                    });
+       index != -1) {
       return static_cast<std::uint32_t>(index);
    }
    else {
       buffer.push_back(vertex);
+      grid.insert(vertex.position, static_cast<int>(buffer.size() - 1));
 
       return static_cast<std::uint32_t>(buffer.size() - 1);
    }
@@ -219,6 +274,7 @@ auto weld_vertex_list(const Vertex_buffer& vertex_buffer) noexcept
 
    Index_buffer_16 ibuf;
    auto welded_vbuf = init_vertex_buffer(vertex_buffer);
+   Weld_grid grid;
 
    const auto face_count = vertex_buffer.count / 3u;
 
@@ -226,14 +282,24 @@ auto weld_vertex_list(const Vertex_buffer& vertex_buffer) noexcept
       auto& tri_index = ibuf.emplace_back();
 
       for (auto v = 0; v < 3; ++v) {
+         const auto src_index = f * 3 + v;
+         const auto position = vertex_position(vertex_buffer, src_index);
+
          if (const auto index =
-                find_similar_vertex(vertex_buffer, f * 3 + v, welded_vbuf);
+                grid.find(position,
+                          [&](const int welded_index) {
+                             return is_vertex_similar(vertex_buffer, src_index,
+                                                      welded_vbuf, welded_index);
+                          });
              index != -1) {
             tri_index[v] = static_cast<std::uint16_t>(index);
          }
          else {
-            tri_index[v] = static_cast<std::uint16_t>(
-               push_back_vertex(vertex_buffer, f * 3 + v, welded_vbuf));
+            const auto index = push_back_vertex(vertex_buffer, src_index, welded_vbuf);
+
+            grid.insert(position, index);
+
+            tri_index[v] = static_cast<std::uint16_t>(index);
          }
       }
    }
@@ -252,10 +318,12 @@ auto weld_vertex_list(const Terrain_triangle_list& triangles) noexcept
    vertices.reserve(triangles.size() * 3);
    indices.reserve(triangles.size());
 
+   Weld_grid grid;
+
    for (auto& tri : triangles) {
-      indices.push_back({add_terrain_vertex(vertices, tri[0]),
-                         add_terrain_vertex(vertices, tri[1]),
-                         add_terrain_vertex(vertices, tri[2])});
+      indices.push_back({add_terrain_vertex(vertices, grid, tri[0]),
+                         add_terrain_vertex(vertices, grid, tri[1]),
+                         add_terrain_vertex(vertices, grid, tri[2])});
    }
 
    return result;
@@ -9,6 +9,7 @@
 #include "texture_type.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <execution>
 #include <filesystem>
@@ -16,8 +17,10 @@
 #include <iomanip>
 #include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <string_view>
+#include <vector>
 
 #include <DirectXTex.h>
 #include <DirectXTexEXR.h>
@@ -162,13 +165,12 @@ auto remap_roughness_channels(DX::ScratchImage image) -> DirectX::ScratchImage
    remapped_image.Initialize(remapped_metadata);
 
    const auto process_image = [&](Image_span src_image, Image_span dest_image) noexcept {
-      for_each(std::execution::par_unseq, src_image, [&](const glm::ivec2 index) noexcept {
-         auto value = src_image.load(index);
-
-         value = {0.0f, value.r, 0.0f, 0.0f};
-
-         dest_image.store(index, value);
-      });
+      for_each_row(std::execution::par, src_image, dest_image,
+                   [&](const int, std::span<glm::vec4> row) noexcept {
+                      for (auto& value : row) {
+                         value = {0.0f, value.r, 0.0f, 0.0f};
+                      }
+                   });
    };
 
    for (auto index = 0; index < image.GetMetadata().arraySize; ++index) {
@@ -217,20 +219,22 @@ auto specular_anti_alias(DX::ScratchImage source_image, DX::ScratchImage normal_
 
       if (!glm::any(glm::greaterThan(radius, glm::uvec2{1}))) return;
 
-      for_each(std::execution::par_unseq, dest_image, [&](const glm::ivec2 index) noexcept {
-         glm::vec3 average_normal = sample_average_normal(index, radius);
+      for_each_row(std::execution::par, dest_image,
+                   [&](const int y, std::span<glm::vec4> row) noexcept {
+                      for (auto x = 0; x < static_cast<int>(row.size()); ++x) {
+                         glm::vec3 average_normal =
+                            sample_average_normal({x, y}, radius);
 
-         const float r = length(average_normal);
-         float k = 10000.0f;
+                         const float r = length(average_normal);
+                         float k = 10000.0f;
 
-         if (r < 1.f) k = (3.f * r - r * r * r) / (1.f - r * r);
+                         if (r < 1.f) k = (3.f * r - r * r * r) / (1.f - r * r);
 
-         auto value = dest_image.load(index);
+                         auto& value = row[x];
 
-         value.g = glm::sqrt(value.g * value.g + (1.f / k));
-
-         dest_image.store(index, value);
-      });
+                         value.g = glm::sqrt(value.g * value.g + (1.f / k));
+                      }
+                   });
    };
 
    for (auto index = 0; index < source_image.GetMetadata().arraySize; ++index) {
@@ -245,13 +249,12 @@ auto specular_anti_alias(DX::ScratchImage source_image, DX::ScratchImage normal_
 auto premultiply_alpha(DX::ScratchImage image) -> DX::ScratchImage
 {
    const auto process_image = [&](Image_span dest_image) noexcept {
-      for_each(std::execution::par_unseq, dest_image, [&](const glm::ivec2 index) noexcept {
-         auto value = dest_image.load(index);
-
-         value.rgb = value.rgb * value.a;
-
-         dest_image.store(index, value);
-      });
+      for_each_row(std::execution::par, dest_image,
+                   [&](const int, std::span<glm::vec4> row) noexcept {
+                      for (auto& value : row) {
+                         value.rgb = value.rgb * value.a;
+                      }
+                   });
    };
 
    for (auto index = 0; index < image.GetMetadata().arraySize; ++index) {
@@ -341,12 +344,14 @@ auto mipmap_normalmap(DX::ScratchImage image) noexcept
       const auto src_image = Image_span{*image.GetImage(mip, index, 0)};
       auto dest_image = Image_span{*mipped_image.GetImage(mip, index, 0)};
 
-      for_each(std::execution::par_unseq, src_image, [&](const glm::ivec2 index) {
-         const auto value = src_image.load(index);
-         const auto normal = glm::normalize(value.xyz * 2.0f - 1.0f);
+      for_each_row(std::execution::par, src_image, dest_image,
+                   [&](const int, std::span<glm::vec4> row) noexcept {
+                      for (auto& value : row) {
+                         const auto normal = glm::normalize(value.xyz * 2.0f - 1.0f);
 
-         dest_image.store(index, {normal * 0.5f + 0.5f, value.w});
-      });
+                         value = {normal * 0.5f + 0.5f, value.w};
+                      }
+                   });
    };
 
    for (auto index = 0; index < image.GetMetadata().arraySize; ++index) {
@@ -354,30 +359,43 @@ auto mipmap_normalmap(DX::ScratchImage image) noexcept
       copy_and_normalize_image(index, 0);
 
       for (auto mip = 1; mip < mipped_image.GetMetadata().mipLevels; ++mip) {
-         const auto sample_average_normal =
-            [upper_image = Image_span{*mipped_image.GetImage(mip - 1, index, 0)}](
-               const glm::ivec2 offset) noexcept -> glm::vec4 {
-            glm::vec3 normal{};
-            float alpha = 0.0f;
-
-            for (auto y = 0; y < 2; ++y) {
-               for (auto x = 0; x < 2; ++x) {
-                  const auto index = offset + glm::ivec2{x, y};
-                  const auto value = upper_image.load(index);
-
-                  normal += glm::normalize(value.xyz * 2.0f - 1.0f);
-                  alpha = alpha + (value.w / 4.0f);
-               }
-            }
+         const auto upper_image = Image_span{*mipped_image.GetImage(mip - 1, index, 0)};
+         auto dest_image = Image_span{*mipped_image.GetImage(mip, index, 0)};
 
-            return {glm::normalize(normal) * 0.5f + 0.5f, alpha};
-         };
+         // Upper rows are read through load_row as well, texels past the edge of the
+         // upper mip are clamped the same way Image_span::load clamps them.
+         const auto upper_width = static_cast<std::size_t>(upper_image.size().x);
 
-         auto dest_image = Image_span{*mipped_image.GetImage(mip, index, 0)};
+         fill_each_row(std::execution::par, dest_image,
+                       [&](const int y, std::span<glm::vec4> row) noexcept {
+                          thread_local std::vector<glm::vec4> upper_rows;
 
-         for_each(std::execution::par_unseq, dest_image, [&](const glm::ivec2 index) {
-            dest_image.store(index, sample_average_normal(index * 2));
-         });
+                          upper_rows.resize(upper_width * 2);
+
+                          upper_image.load_row(y * 2,
+                                               std::span{upper_rows}.first(upper_width));
+                          upper_image.load_row(y * 2 + 1,
+                                               std::span{upper_rows}.last(upper_width));
+
+                          for (std::size_t x = 0; x < row.size(); ++x) {
+                             glm::vec3 normal{};
+                             float alpha = 0.0f;
+
+                             for (std::size_t upper_y = 0; upper_y < 2; ++upper_y) {
+                                for (std::size_t upper_x = 0; upper_x < 2; ++upper_x) {
+                                   const auto value =
+                                      upper_rows[upper_y * upper_width +
+                                                 std::min(x * 2 + upper_x,
+                                                          upper_width - 1)];
+
+                                   normal += glm::normalize(value.xyz * 2.0f - 1.0f);
+                                   alpha = alpha + (value.w / 4.0f);
+                                }
+                             }
+
+                             row[x] = {glm::normalize(normal) * 0.5f + 0.5f, alpha};
+                          }
+                       });
       }
    }
 